@@ -4,6 +4,7 @@
 
 #include <bench/bench.h>
 #include <coins.h>
+#include <crypto/common.h>
 #include <policy/policy.h>
 #include <wallet/crypter.h>
 
@@ -85,3 +86,33 @@ static void CCoinsCaching(benchmark::State& state)
 }
 
 BENCHMARK(CCoinsCaching, 170 * 1000);
+
+// Fill a cache with the outputs of a few blocks' worth of transactions and
+// look every one up again, the way connecting blocks does. Dominated by the
+// CCoinsMap inserts and lookups rather than by script checks.
+static void CCoinsCacheFill(benchmark::State& state)
+{
+    const int nOutputs = 20000;
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(nOutputs);
+    for (int i = 0; i < nOutputs; i++) {
+        uint256 hash;
+        WriteLE64(hash.begin(), i / 4);
+        outpoints.emplace_back(hash, i % 4);
+    }
+    CTxOut out(50 * CENT, CScript() << OP_1);
+
+    CCoinsView coinsDummy;
+    while (state.KeepRunning()) {
+        CCoinsViewCache coins(&coinsDummy);
+        for (const COutPoint& outpoint : outpoints)
+            coins.AddCoin(outpoint, Coin(out, 1, false), false);
+        CAmount value = 0;
+        for (const COutPoint& outpoint : outpoints)
+            value += coins.AccessCoin(outpoint).out.nValue;
+        assert(value == nOutputs * 50 * CENT);
+        assert(coins.DynamicMemoryUsage() > 0);
+    }
+}
+
+BENCHMARK(CCoinsCacheFill, 20);
@@ -0,0 +1,168 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <arith_uint256.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <checkqueue.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <streams.h>
+#include <version.h>
+#include <PoWCore/src/PoW.h>
+
+#include <vector>
+#include <boost/thread/thread.hpp>
+
+namespace pow_bench {
+#include <bench/data/headers_merit20.raw.h>
+} // namespace pow_bench
+
+static const size_t HEADERS = 64;
+static const unsigned int QUEUE_BATCH_SIZE = 16;
+static const size_t INDEX_ENTRIES = 10000;
+
+// Headers mined the way mainnet blocks are today, at shift 25 and a merit of
+// 20 and up, each on top of the one before
+static std::vector<CBlockHeader> LoadHeaders()
+{
+    CDataStream stream((const char*)pow_bench::headers_merit20,
+            (const char*)&pow_bench::headers_merit20[sizeof(pow_bench::headers_merit20)],
+            SER_NETWORK, PROTOCOL_VERSION);
+    std::vector<CBlockHeader> vHeaders;
+    while (!stream.empty()) {
+        CBlockHeader header;
+        stream >> header;
+        vHeaders.push_back(header);
+    }
+    assert(!vHeaders.empty());
+    return vHeaders;
+}
+
+// Checks a batch of headers on a CCheckQueue the way header sync and
+// -reindex do, with the master plus nThreads - 1 workers, as for -par=nThreads.
+// Compare the per-batch times across thread counts for the headers/s scaling.
+static void CheckPoWQueue(benchmark::State& state, int nThreads)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const std::vector<CBlockHeader> vHeaders = LoadHeaders();
+
+    CCheckQueue<CPoWCheck> queue {QUEUE_BATCH_SIZE};
+    boost::thread_group tg;
+    for (int i = 0; i < nThreads - 1; i++) {
+        tg.create_thread([&]{queue.Thread();});
+    }
+    while (state.KeepRunning()) {
+        std::vector<CPoWCheck> vChecks;
+        vChecks.reserve(HEADERS);
+        for (size_t i = 0; i < HEADERS; i++)
+            vChecks.emplace_back(vHeaders[i % vHeaders.size()], chainParams->GetConsensus());
+
+        CCheckQueueControl<CPoWCheck> control(&queue);
+        control.Add(vChecks);
+        assert(control.Wait());
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+// Full proof of work check of a valid header, the path every header and
+// block takes, one fixture header after the other
+static void CheckPoWValid(benchmark::State& state)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const std::vector<CBlockHeader> vHeaders = LoadHeaders();
+    std::vector<uint256> vHashes;
+    for (const CBlockHeader& header : vHeaders)
+        vHashes.push_back(header.GetHash());
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        const CBlockHeader& header = vHeaders[i];
+        assert(CheckProofOfWork(vHashes[i], header.nShift, &header.nAdd, header.nDifficulty, chainParams->GetConsensus()));
+        i = (i + 1) % vHeaders.size();
+    }
+}
+
+// The testnet genesis header, at the minimum test difficulty
+static void CheckPoWValidTestnet(benchmark::State& state)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::TESTNET);
+    const CBlockHeader header = chainParams->GenesisBlock().GetBlockHeader();
+    const uint256 hash = header.GetHash();
+
+    while (state.KeepRunning()) {
+        assert(CheckProofOfWork(hash, header.nShift, &header.nAdd, header.nDifficulty, chainParams->GetConsensus()));
+    }
+}
+
+// A header whose odd adder doesn't start a gap, what a peer feeding junk costs
+static void CheckPoWInvalid(benchmark::State& state)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    CBlockHeader header = LoadHeaders()[0];
+    header.nAdd[0] ^= 2;
+    const uint256 hash = header.GetHash();
+
+    while (state.KeepRunning()) {
+        CheckProofOfWork(hash, header.nShift, &header.nAdd, header.nDifficulty, chainParams->GetConsensus());
+    }
+}
+
+// The PoW calls the checks above are made of, each on a fresh PoW
+static void PoWHeader(benchmark::State& state, int nCall)
+{
+    const CBlockHeader header = LoadHeaders()[0];
+    const uint256 hash = header.GetHash();
+    const std::vector<uint8_t> vHash(hash.begin(), hash.end());
+
+    std::vector<uint8_t> vStart, vEnd;
+    while (state.KeepRunning()) {
+        PoW pow(&vHash, header.nShift, &header.nAdd, header.nDifficulty);
+        switch (nCall) {
+        case 0: assert(pow.valid()); break;
+        case 1: pow.merit(); break;
+        case 2: pow.get_gap(&vStart, &vEnd); break;
+        }
+    }
+}
+
+// Chain work of a synthetic index as LoadBlockIndex adds it up, with
+// difficulties spread over the range of mainnet merits
+static void GetBlockProofIndex(benchmark::State& state)
+{
+    std::vector<CBlockIndex> vIndex(INDEX_ENTRIES);
+    for (size_t i = 0; i < vIndex.size(); i++)
+        vIndex[i].nDifficulty = (16ULL << 48) + i * ((10ULL << 48) / INDEX_ENTRIES);
+
+    while (state.KeepRunning()) {
+        arith_uint256 nChainWork;
+        for (const CBlockIndex& index : vIndex)
+            nChainWork += GetBlockProof(index);
+        assert(nChainWork > 0);
+    }
+}
+
+static void PoWValid(benchmark::State& state) { PoWHeader(state, 0); }
+static void PoWMerit(benchmark::State& state) { PoWHeader(state, 1); }
+static void PoWGetGap(benchmark::State& state) { PoWHeader(state, 2); }
+
+static void CheckPoWQueue1(benchmark::State& state) { CheckPoWQueue(state, 1); }
+static void CheckPoWQueue2(benchmark::State& state) { CheckPoWQueue(state, 2); }
+static void CheckPoWQueue4(benchmark::State& state) { CheckPoWQueue(state, 4); }
+static void CheckPoWQueue8(benchmark::State& state) { CheckPoWQueue(state, 8); }
+
+BENCHMARK(CheckPoWQueue1, 1);
+BENCHMARK(CheckPoWQueue2, 2);
+BENCHMARK(CheckPoWQueue4, 4);
+BENCHMARK(CheckPoWQueue8, 8);
+BENCHMARK(CheckPoWValid, 100);
+BENCHMARK(CheckPoWValidTestnet, 100);
+BENCHMARK(CheckPoWInvalid, 1000);
+BENCHMARK(PoWValid, 100);
+BENCHMARK(PoWMerit, 100);
+BENCHMARK(PoWGetGap, 100);
+BENCHMARK(GetBlockProofIndex, 20);
@@ -0,0 +1,53 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <chainparams.h>
+#include <fermat.h>
+#include <primitives/block.h>
+
+static const size_t CANDIDATES = 64;
+
+// Fermat tests of a batch of odd gap start candidates from the mainnet genesis
+// hash, about 280 bits at shift 25 and 320 at shift 64, with one backend.
+// Compare the per-batch times of the backends; one the CPU lacks reports zero.
+static void FermatBatch(benchmark::State& state, const char* strName, uint16_t nShift)
+{
+    if (!FermatSelect(strName))
+        return;
+
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const uint256 hash = chainParams->GenesisBlock().GetHash();
+    mpz_t vN[CANDIDATES];
+    for (size_t i = 0; i < CANDIDATES; i++) {
+        mpz_init(vN[i]);
+        mpz_import(vN[i], hash.size(), -1, 1, 0, 0, hash.begin());
+        mpz_mul_2exp(vN[i], vN[i], nShift);
+        mpz_add_ui(vN[i], vN[i], 2 * i * 1009 + 1);
+    }
+
+    bool vPrime[CANDIDATES];
+    while (state.KeepRunning()) {
+        FermatTest(vN, CANDIDATES, vPrime);
+    }
+
+    for (size_t i = 0; i < CANDIDATES; i++)
+        mpz_clear(vN[i]);
+    FermatAutoDetect();
+}
+
+static void FermatBatch_25_GMP(benchmark::State& state) { FermatBatch(state, "gmp", 25); }
+static void FermatBatch_25_AVX2(benchmark::State& state) { FermatBatch(state, "avx2", 25); }
+static void FermatBatch_25_AVX512IFMA(benchmark::State& state) { FermatBatch(state, "avx512ifma", 25); }
+static void FermatBatch_64_GMP(benchmark::State& state) { FermatBatch(state, "gmp", 64); }
+static void FermatBatch_64_AVX2(benchmark::State& state) { FermatBatch(state, "avx2", 64); }
+static void FermatBatch_64_AVX512IFMA(benchmark::State& state) { FermatBatch(state, "avx512ifma", 64); }
+
+BENCHMARK(FermatBatch_25_GMP, 500);
+BENCHMARK(FermatBatch_25_AVX2, 500);
+BENCHMARK(FermatBatch_25_AVX512IFMA, 500);
+BENCHMARK(FermatBatch_64_GMP, 500);
+BENCHMARK(FermatBatch_64_AVX2, 500);
+BENCHMARK(FermatBatch_64_AVX512IFMA, 500);
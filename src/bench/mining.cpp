@@ -0,0 +1,51 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <miner.h>
+#include <script/script.h>
+#include <utiltime.h>
+
+#include <limits>
+#include <thread>
+
+// Time from publishing new work until every miner thread sieves it, i.e. the
+// delay between a new tip and the pool mining on top of it. A small sieve
+// keeps the pass in flight short; with the production sieve that pass
+// dominates, while thread start-up and prime table setup no longer count.
+static void MinerResume(benchmark::State& state, int nThreads)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const CBlock genesis = chainParams->GenesisBlock();
+    CBlockIndex index(genesis);
+
+    CMinerPool pool(*chainParams);
+    pool.SetThreads(nThreads);
+    while (state.KeepRunning()) {
+        std::shared_ptr<CMinerWork> work = std::make_shared<CMinerWork>();
+        work->block = genesis;
+        work->block.nShift = 20;
+        // Nothing found ever qualifies, so no block is submitted
+        work->block.nDifficulty = std::numeric_limits<uint64_t>::max();
+        work->pindexPrev = &index;
+        work->coinbaseScript = std::make_shared<CReserveScript>();
+        work->nCreated = GetTime();
+        work->nSievePrimes = 1000;
+        work->nSieveSize = 1 << 16;
+
+        uint64_t nGeneration = pool.Publish(work);
+        while (pool.CountThreadsOn(nGeneration) < nThreads)
+            std::this_thread::yield();
+    }
+    pool.SetThreads(0);
+}
+
+static void MinerResume1(benchmark::State& state) { MinerResume(state, 1); }
+static void MinerResume4(benchmark::State& state) { MinerResume(state, 4); }
+
+BENCHMARK(MinerResume1, 50);
+BENCHMARK(MinerResume4, 50);
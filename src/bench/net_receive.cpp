@@ -0,0 +1,61 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <chainparams.h>
+#include <hash.h>
+#include <net.h>
+#include <primitives/block.h>
+#include <protocol.h>
+#include <streams.h>
+
+// A flood of large block messages, received the way the socket handler does:
+// straight into the message payload in recv()-sized pieces, checksummed as
+// they arrive, then deserialized from the same buffer.
+static void ReceiveBlockMessages(benchmark::State& state)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+
+    CMutableTransaction tx;
+    tx.vin.resize(2);
+    tx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, 1) << std::vector<unsigned char>(33, 2);
+    tx.vin[1].scriptSig = tx.vin[0].scriptSig;
+    tx.vout.resize(2);
+    tx.vout[0].scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 3) << OP_EQUALVERIFY << OP_CHECKSIG;
+    tx.vout[1].scriptPubKey = tx.vout[0].scriptPubKey;
+    CBlock block;
+    for (uint32_t i = 0; i < 2500; i++) {
+        tx.vin[0].prevout.n = i;
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+    ssBlock << block;
+
+    CMessageHeader hdr(chainParams->MessageStart(), NetMsgType::BLOCK, ssBlock.size());
+    uint256 hash = Hash(ssBlock.begin(), ssBlock.end());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+    ssHeader << hdr;
+
+    while (state.KeepRunning()) {
+        CNetMessage msg(chainParams->MessageStart(), SER_NETWORK, PROTOCOL_VERSION);
+        msg.readHeader(ssHeader.data(), ssHeader.size());
+        size_t nPos = 0;
+        while (!msg.complete()) {
+            unsigned int nSize;
+            char* pch = msg.GetDataBuffer(nSize);
+            nSize = std::min<size_t>(nSize, std::min<size_t>(ssBlock.size() - nPos, 0x10000));
+            memcpy(pch, ssBlock.data() + nPos, nSize);
+            msg.DataReceived(nSize);
+            nPos += nSize;
+        }
+        assert(memcmp(msg.GetMessageHash().begin(), hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) == 0);
+        CBlock blockRecv;
+        msg.vRecv >> blockRecv;
+        assert(blockRecv.vtx.size() == block.vtx.size());
+    }
+}
+
+BENCHMARK(ReceiveBlockMessages, 40);
@@ -0,0 +1,120 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <gapsieve.h>
+#include <primitives/block.h>
+#include <streams.h>
+#include <version.h>
+#include <PoWCore/src/PoW.h>
+#include <PoWCore/src/PoWProcessor.h>
+#include <PoWCore/src/Sieve.h>
+
+#include <vector>
+
+namespace sieve_bench {
+#include <bench/data/headers_merit20.raw.h>
+} // namespace sieve_bench
+
+namespace {
+
+/** Swallows whatever the sieve reports, as if nothing qualified */
+class NullProcessor : public PoWProcessor
+{
+public:
+    bool process(PoW* pow) { return true; }
+};
+
+/** The first fixture header, mined at shift 25 and a merit of 20, as a miner's template */
+CBlockHeader LoadHeader()
+{
+    CDataStream stream((const char*)sieve_bench::headers_merit20,
+            (const char*)&sieve_bench::headers_merit20[sizeof(sieve_bench::headers_merit20)],
+            SER_NETWORK, PROTOCOL_VERSION);
+    CBlockHeader header;
+    stream >> header;
+    return header;
+}
+
+} // namespace
+
+// One sieve pass over a mainnet-like header with a fresh nonce each
+// iteration, prime table setup excluded. Compare the per-pass times over the
+// grid of shift, sieve-primes and sieve-size; with the real miner a pass
+// also ends in Fermat tests of the candidates, which this includes. The
+// header's own difficulty sets how far the gap search jumps; the processor
+// takes any gap found, so the pass always runs to its end.
+static void SieveRun(benchmark::State& state, uint16_t nShift, uint64_t nPrimes, uint64_t nSieveSize)
+{
+    CBlockHeader header = LoadHeader();
+    header.nShift = nShift;
+
+    NullProcessor processor;
+    Sieve sieve(&processor, nPrimes, nSieveSize);
+    while (state.KeepRunning()) {
+        header.nNonce++;
+        uint256 hash = header.GetHash();
+        std::vector<uint8_t> vHash(hash.begin(), hash.end());
+        PoW pow(&vHash, header.nShift, &header.nAdd, header.nDifficulty);
+        sieve.run_sieve(&pow, NULL);
+    }
+}
+
+// Building the prime tables of a sieve, which the miner threads keep across
+// templates
+static void SieveSetup(benchmark::State& state)
+{
+    NullProcessor processor;
+    while (state.KeepRunning()) {
+        Sieve sieve(&processor, 900000, 1 << 25);
+    }
+}
+
+// The sieving alone of CGapSieve, segmented and prime by prime over the
+// whole array, and a full pass of it like SieveRun's
+static void GapSieveSieve(benchmark::State& state, uint64_t nPrimes, uint64_t nSieveSize, bool fSegmented)
+{
+    CBlockHeader header = LoadHeader();
+    CGapSieve sieve(nullptr, nPrimes, nSieveSize);
+    while (state.KeepRunning()) {
+        header.nNonce++;
+        sieve.Sieve(header.GetHash(), header.nShift, fSegmented);
+    }
+}
+
+static void GapSieveRun(benchmark::State& state, uint16_t nShift, uint64_t nPrimes, uint64_t nSieveSize)
+{
+    CBlockHeader header = LoadHeader();
+    NullProcessor processor;
+    CGapSieve sieve(&processor, nPrimes, nSieveSize);
+    while (state.KeepRunning()) {
+        header.nNonce++;
+        sieve.Run(header.GetHash(), nShift, header.nDifficulty);
+    }
+}
+
+static void GapSieveSieve_900k_32M_Plain(benchmark::State& state) { GapSieveSieve(state, 900000, 1 << 25, false); }
+static void GapSieveSieve_900k_32M_Segmented(benchmark::State& state) { GapSieveSieve(state, 900000, 1 << 25, true); }
+static void GapSieveRun_25_900k_32M(benchmark::State& state) { GapSieveRun(state, 25, 900000, 1 << 25); }
+
+static void SieveRun_20_10k_1M(benchmark::State& state) { SieveRun(state, 20, 10000, 1 << 20); }
+static void SieveRun_20_100k_1M(benchmark::State& state) { SieveRun(state, 20, 100000, 1 << 20); }
+static void SieveRun_25_100k_1M(benchmark::State& state) { SieveRun(state, 25, 100000, 1 << 20); }
+static void SieveRun_25_100k_8M(benchmark::State& state) { SieveRun(state, 25, 100000, 1 << 23); }
+static void SieveRun_25_900k_8M(benchmark::State& state) { SieveRun(state, 25, 900000, 1 << 23); }
+static void SieveRun_25_900k_32M(benchmark::State& state) { SieveRun(state, 25, 900000, 1 << 25); }
+static void SieveRun_32_900k_32M(benchmark::State& state) { SieveRun(state, 32, 900000, 1 << 25); }
+
+BENCHMARK(SieveRun_20_10k_1M, 20);
+BENCHMARK(SieveRun_20_100k_1M, 20);
+BENCHMARK(SieveRun_25_100k_1M, 20);
+BENCHMARK(SieveRun_25_100k_8M, 4);
+BENCHMARK(SieveRun_25_900k_8M, 4);
+BENCHMARK(SieveRun_25_900k_32M, 1);
+BENCHMARK(SieveRun_32_900k_32M, 1);
+BENCHMARK(SieveSetup, 1);
+BENCHMARK(GapSieveSieve_900k_32M_Plain, 1);
+BENCHMARK(GapSieveSieve_900k_32M_Segmented, 1);
+BENCHMARK(GapSieveRun_25_900k_32M, 1);
@@ -0,0 +1,281 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bootstrap.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <clientversion.h>
+#include <consensus/consensus.h>
+#include <crypto/common.h>
+#include <primitives/block.h>
+#include <protocol.h>
+#include <streams.h>
+#include <sync.h>
+#include <util.h>
+#include <utiltime.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+//! Message start and block size in front of every block
+const unsigned int RECORD_HEADER_SIZE = CMessageHeader::MESSAGE_START_SIZE + 4;
+
+std::mutex cs_bootstrap;
+CBootstrapDumpStatus bootstrapStatus;
+std::thread threadBootstrap;
+std::atomic<bool> fStopBootstrap(false);
+
+/** Read the record header at nPos, checking it against the network's message start */
+bool ReadRecordHeader(FILE* file, uint64_t nPos, unsigned int& nSize)
+{
+    unsigned char header[RECORD_HEADER_SIZE];
+    if (fseek(file, nPos, SEEK_SET) != 0 || fread(header, 1, sizeof(header), file) != sizeof(header))
+        return false;
+    if (memcmp(header, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0)
+        return false;
+    nSize = ReadLE32(header + CMessageHeader::MESSAGE_START_SIZE);
+    return nSize <= MAX_BLOCK_SERIALIZED_SIZE;
+}
+
+bool CopyRange(FILE* fileIn, uint64_t nBegin, uint64_t nEnd, FILE* fileOut, std::vector<char>& vBuffer)
+{
+    if (fseek(fileIn, nBegin, SEEK_SET) != 0)
+        return false;
+    while (nBegin < nEnd) {
+        size_t nChunk = std::min<uint64_t>(vBuffer.size(), nEnd - nBegin);
+        if (fread(vBuffer.data(), 1, nChunk, fileIn) != nChunk || fwrite(vBuffer.data(), 1, nChunk, fileOut) != nChunk)
+            return false;
+        nBegin += nChunk;
+    }
+    return true;
+}
+
+/**
+ * Count the complete records at the start of an existing dump and the bytes
+ * they take, and get the hash of the last one. A file that does not start
+ * with a record is refused, so that resuming never cuts off anything else.
+ */
+bool ScanBootstrapFile(const fs::path& path, int& nRecords, uint64_t& nLength, uint256& hashLast, std::string& strError)
+{
+    FILE* file = fsbridge::fopen(path, "rb");
+    if (!file) {
+        strError = "Cannot read " + path.string();
+        return false;
+    }
+    const uint64_t nFileSize = fs::file_size(path);
+    nRecords = 0;
+    nLength = 0;
+    uint64_t nLast = 0;
+    unsigned int nSize;
+    if (nFileSize > 0 && !ReadRecordHeader(file, 0, nSize)) {
+        fclose(file);
+        strError = path.string() + " is not a bootstrap file";
+        return false;
+    }
+    while (nLength + RECORD_HEADER_SIZE <= nFileSize && ReadRecordHeader(file, nLength, nSize) &&
+           nLength + RECORD_HEADER_SIZE + nSize <= nFileSize) {
+        nLast = nLength;
+        nLength += RECORD_HEADER_SIZE + nSize;
+        nRecords++;
+    }
+    if (nRecords == 0) {
+        fclose(file);
+        return true;
+    }
+
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    CBlockHeader header;
+    try {
+        if (fseek(filein.Get(), nLast + RECORD_HEADER_SIZE, SEEK_SET) != 0)
+            throw std::ios_base::failure("seek failed");
+        filein >> header;
+    } catch (const std::exception& e) {
+        strError = strprintf("Cannot read the last block of %s: %s", path.string(), e.what());
+        return false;
+    }
+    hashLast = header.GetHash();
+    return true;
+}
+
+/**
+ * Copy the records of the blocks at vPos. Blocks stored back to back, as
+ * they mostly are, are merged into one range and copied together.
+ */
+void ThreadDumpBootstrap(const std::vector<CDiskBlockPos>& vPos, FILE* fileOut)
+{
+    std::vector<char> vBuffer(BOOTSTRAP_COPY_CHUNK);
+    FILE* fileIn = nullptr;
+    int nFileIn = -1;
+    // Records of nPending blocks in [nBegin, nEnd) of block file nFileIn
+    // are still to be copied
+    uint64_t nBegin = 0, nEnd = 0;
+    int nPending = 0;
+    std::string strError;
+
+    auto flush = [&]() {
+        if (nEnd > nBegin && !CopyRange(fileIn, nBegin, nEnd, fileOut, vBuffer))
+            return false;
+        std::lock_guard<std::mutex> lock(cs_bootstrap);
+        bootstrapStatus.nHeight += nPending;
+        bootstrapStatus.nBytes += nEnd - nBegin;
+        nBegin = nEnd;
+        nPending = 0;
+        return true;
+    };
+
+    for (const CDiskBlockPos& pos : vPos) {
+        if (fStopBootstrap) {
+            strError = "Interrupted";
+            break;
+        }
+        const uint64_t nRecord = pos.nPos - RECORD_HEADER_SIZE;
+        if (pos.nFile != nFileIn || nRecord != nEnd) {
+            if (!flush()) {
+                strError = strprintf("Failed to copy from block file %d", nFileIn);
+                break;
+            }
+            if (pos.nFile != nFileIn) {
+                if (fileIn)
+                    fclose(fileIn);
+                nFileIn = pos.nFile;
+                fileIn = OpenBlockFile(pos, true);
+                if (!fileIn) {
+                    strError = strprintf("Failed to open block file %d", nFileIn);
+                    break;
+                }
+            }
+            nBegin = nEnd = nRecord;
+        }
+
+        unsigned int nSize;
+        if (!ReadRecordHeader(fileIn, nRecord, nSize)) {
+            strError = strprintf("Bad block record at %d:%u", pos.nFile, pos.nPos);
+            break;
+        }
+        nEnd = pos.nPos + nSize;
+        nPending++;
+        if (nEnd - nBegin >= BOOTSTRAP_COPY_CHUNK && !flush()) {
+            strError = strprintf("Failed to copy from block file %d", nFileIn);
+            break;
+        }
+    }
+    // Whatever is complete is kept, so that the dump can be resumed
+    if (fileIn && !flush() && strError.empty())
+        strError = strprintf("Failed to copy from block file %d", nFileIn);
+    if (fileIn)
+        fclose(fileIn);
+    if (fflush(fileOut) != 0 && strError.empty())
+        strError = "Failed to write the bootstrap file";
+    FileCommit(fileOut);
+    fclose(fileOut);
+
+    std::lock_guard<std::mutex> lock(cs_bootstrap);
+    bootstrapStatus.fRunning = false;
+    bootstrapStatus.nEndTime = GetTime();
+    bootstrapStatus.strError = strError;
+    if (strError.empty())
+        LogPrintf("Bootstrap dump to %s done, %d blocks, %u bytes\n", bootstrapStatus.path.string(), bootstrapStatus.nHeight - bootstrapStatus.nStartHeight, bootstrapStatus.nBytes);
+    else
+        LogPrintf("Bootstrap dump to %s stopped at height %d: %s\n", bootstrapStatus.path.string(), bootstrapStatus.nHeight, strError);
+}
+
+} // namespace
+
+bool StartBootstrapDump(const fs::path& path, int nStartHeight, int nEndHeight, bool fResume, std::string& strError)
+{
+    std::lock_guard<std::mutex> lock(cs_bootstrap);
+    if (bootstrapStatus.fRunning) {
+        strError = "A bootstrap dump is already running";
+        return false;
+    }
+    if (threadBootstrap.joinable())
+        threadBootstrap.join();
+
+    int nRecords = 0;
+    uint64_t nLength = 0;
+    uint256 hashLast;
+    const bool fAppend = fResume && fs::exists(path);
+    if (fAppend && !ScanBootstrapFile(path, nRecords, nLength, hashLast, strError))
+        return false;
+    if (!fAppend && fs::exists(path)) {
+        strError = path.string() + " already exists";
+        return false;
+    }
+    const int nHeight = nStartHeight + nRecords;
+
+    std::vector<CDiskBlockPos> vPos;
+    {
+        LOCK(cs_main);
+        if (nStartHeight < 0 || nEndHeight > chainActive.Height()) {
+            strError = "Block height out of range";
+            return false;
+        }
+        // The records kept have to be the blocks of the active chain from
+        // nStartHeight on, or the dump would continue on another chain
+        if (nRecords > 0 && (nHeight - 1 > nEndHeight || chainActive[nHeight - 1]->GetBlockHash() != hashLast)) {
+            strError = strprintf("%s does not hold the active chain blocks from height %d", path.string(), nStartHeight);
+            return false;
+        }
+        for (int h = nHeight; h <= nEndHeight; h++) {
+            const CBlockIndex* pindex = chainActive[h];
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+                strError = strprintf("Block %d not available (pruned data)", h);
+                return false;
+            }
+            vPos.push_back(pindex->GetBlockPos());
+        }
+    }
+
+    // Cut off a record left half written
+    if (fAppend && nLength < fs::file_size(path))
+        fs::resize_file(path, nLength);
+    FILE* file = fsbridge::fopen(path, fAppend ? "ab" : "wb");
+    if (!file) {
+        strError = "Could not open " + path.string() + " for writing";
+        return false;
+    }
+
+    bootstrapStatus = CBootstrapDumpStatus();
+    bootstrapStatus.fRunning = true;
+    bootstrapStatus.path = path;
+    bootstrapStatus.nStartHeight = nStartHeight;
+    bootstrapStatus.nEndHeight = nEndHeight;
+    bootstrapStatus.nHeight = nHeight;
+    bootstrapStatus.nBytes = nLength;
+    bootstrapStatus.nStartTime = GetTime();
+    LogPrintf("Dumping blocks %d to %d to %s\n", nHeight, nEndHeight, path.string());
+
+    fStopBootstrap = false;
+    threadBootstrap = std::thread(&TraceThread<std::function<void()>>, "bootstrap",
+                                  std::function<void()>(std::bind(&ThreadDumpBootstrap, std::move(vPos), file)));
+    return true;
+}
+
+CBootstrapDumpStatus GetBootstrapDumpStatus()
+{
+    std::lock_guard<std::mutex> lock(cs_bootstrap);
+    return bootstrapStatus;
+}
+
+void StopBootstrapDump()
+{
+    fStopBootstrap = true;
+    // The thread takes cs_bootstrap on its way out, so join without it
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock(cs_bootstrap);
+        thread = std::move(threadBootstrap);
+    }
+    if (thread.joinable())
+        thread.join();
+}
@@ -0,0 +1,48 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BOOTSTRAP_H
+#define BITCOIN_BOOTSTRAP_H
+
+#include <fs.h>
+
+#include <stdint.h>
+#include <string>
+
+/** Bytes copied from the block files per read */
+static const size_t BOOTSTRAP_COPY_CHUNK = 8 << 20;
+
+/** Progress of the last bootstrap dump */
+struct CBootstrapDumpStatus
+{
+    bool fRunning = false;
+    fs::path path;
+    int nStartHeight = 0;
+    int nEndHeight = 0;
+    //! Next height to be written; the file holds [nStartHeight, nHeight)
+    int nHeight = 0;
+    uint64_t nBytes = 0;
+    int64_t nStartTime = 0;
+    int64_t nEndTime = 0;
+    std::string strError;
+};
+
+/**
+ * Start writing the active chain blocks nStartHeight..nEndHeight to path in
+ * bootstrap.dat format, in the background. The records, message start and
+ * size followed by the block, are laid out exactly as in the blk*.dat files,
+ * so they are copied from there in large sequential reads without
+ * deserializing a block. With fResume an existing file is kept: its complete
+ * records are taken to be the blocks from nStartHeight on, any partial one is
+ * cut off, and the dump continues after them. A file that does not start
+ * with a record, or whose last complete record is not the active chain block
+ * at that height, is refused.
+ * Returns false with strError set if the dump cannot start.
+ */
+bool StartBootstrapDump(const fs::path& path, int nStartHeight, int nEndHeight, bool fResume, std::string& strError);
+CBootstrapDumpStatus GetBootstrapDumpStatus();
+/** Interrupt a running dump and wait for it to stop */
+void StopBootstrapDump();
+
+#endif // BITCOIN_BOOTSTRAP_H
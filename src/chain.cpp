@@ -4,10 +4,12 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
-#include <bignum.h>
 #include <chain.h>
+#include <core_memusage.h>
 #include <util.h>
 
+#include <atomic>
+
 /**
  * CChain implementation
  */
@@ -121,25 +123,126 @@ void CBlockIndex::BuildSkip()
         pskip = pprev->GetAncestor(GetSkipHeight(nHeight));
 }
 
-arith_uint256 GetBlockProof(const CBlockIndex& block)
+/** floor(a * b / 2^62), for a * b below 2^126 */
+static uint64_t MulQ62(uint64_t a, uint64_t b)
 {
-    arith_uint256 bnTarget;
-    CBigNum _bnTarget;
-    bool fNegative;
-    bool fOverflow;
-    std::vector<uint8_t> work;
+    uint64_t aLo = (uint32_t)a, aHi = a >> 32, bLo = (uint32_t)b, bHi = b >> 32;
+    uint64_t nLoLo = aLo * bLo, nHiLo = aHi * bLo, nLoHi = aLo * bHi;
+    uint64_t nCross = (nLoLo >> 32) + (uint32_t)nHiLo + (uint32_t)nLoHi;
+    uint64_t nHi = aHi * bHi + (nHiLo >> 32) + (nLoHi >> 32) + (nCross >> 32);
+    uint64_t nLo = (nCross << 32) | (uint32_t)nLoLo;
+    return (nHi << 2) | (nLo >> 62);
+}
 
-    block.utils->target_work(&work, block.nDifficulty);
-    // insert 0 a the begining to avoid sig problems
-    work.push_back(0);
+/** e^(2^i) as a mantissa in [1, 2) with 62 fractional bits, and its binary exponent */
+static const struct {
+    uint64_t nMantissa;
+    int nExponent;
+} EXP_POW2[8] = {
+    {0x56fc2a2c515da54d, 1},
+    {0x763992e35376b731, 2},
+    {0x6d3240b89ce9619e, 5},
+    {0x5d27a9f51c31b7c3, 11},
+    {0x43cbaf42a0008125, 23},
+    {0x47d0ff312d98b1f6, 46},
+    {0x509660b3d65f3481, 92},
+    {0x6579531775085dfd, 184},
+};
 
-    _bnTarget.setvch(work);
-    bnTarget.SetCompact(_bnTarget.GetCompact(), &fNegative, &fOverflow);
+/**
+ * The work PoWCore's target_work assigns a difficulty, floor(e^merit) with
+ * merit = nDifficulty / 2^48, or 0 past 256 bits. Integer arithmetic only,
+ * so every platform agrees on it: e^fraction comes from its Taylor series
+ * and e^integer from EXP_POW2, in 62 fractional bits. That is about 55
+ * correct bits, well beyond the 24 the compact form keeps.
+ */
+static arith_uint256 TargetWork(uint64_t nDifficulty)
+{
+    const uint64_t nMerit = nDifficulty >> 48;
+    // e^178 is past 2^256
+    if (nMerit >= 178)
+        return 0;
 
-    if (fNegative || fOverflow || bnTarget == 0)
+    const uint64_t nFraction = (nDifficulty & ((1ULL << 48) - 1)) << 14;
+    uint64_t nTerm = 1ULL << 62;
+    uint64_t nMantissa = nTerm;
+    for (uint64_t k = 1; nTerm != 0; k++) {
+        nTerm = MulQ62(nTerm, nFraction) / k;
+        nMantissa += nTerm;
+    }
+
+    int nExponent = 0;
+    // Keep the mantissa in [1, 2)
+    auto normalize = [&] {
+        if (nMantissa >> 63) {
+            nMantissa >>= 1;
+            nExponent++;
+        }
+    };
+    normalize();
+    for (int i = 0; i < 8; i++) {
+        if ((nMerit >> i) & 1) {
+            nMantissa = MulQ62(nMantissa, EXP_POW2[i].nMantissa);
+            nExponent += EXP_POW2[i].nExponent;
+            normalize();
+        }
+    }
+
+    if (nExponent >= 256)
         return 0;
+    if (nExponent >= 62)
+        return arith_uint256(nMantissa) << (nExponent - 62);
+    return arith_uint256(nMantissa >> (62 - nExponent));
+}
+
+arith_uint256 GetBlockProof(const CBlockIndex& block)
+{
+    // Chain work is kept at compact precision, 24 bits of mantissa
+    arith_uint256 bnWork;
+    bnWork.SetCompact(TargetWork(block.nDifficulty).GetCompact());
+    return bnWork;
+}
+
+size_t nPoWSummaryCacheMax = DEFAULT_POWSUMMARY_CACHE << 20;
+static std::atomic<size_t> nPoWSummaryCacheUsage(0);
+
+std::shared_ptr<const CBlockPoWSummary> GetBlockPoWSummary(const CBlockIndex& block)
+{
+    std::shared_ptr<const CBlockPoWSummary> summary = std::atomic_load(&block.powSummary);
+    if (summary)
+        return summary;
+
+    uint256 hash = block.GetBlockHash();
+    std::vector<uint8_t> vHash(hash.begin(), hash.end());
+    std::vector<uint8_t> vAdd(block.nAdd.begin(), block.nAdd.end());
+    PoW pow(&vHash, block.nShift, &vAdd, block.nDifficulty);
+
+    std::shared_ptr<CBlockPoWSummary> computed = std::make_shared<CBlockPoWSummary>();
+    std::vector<uint8_t> vEnd;
+    pow.get_gap(&computed->vGapStart, &vEnd);
+    computed->nGapLen = pow.gap_len();
+    computed->nMerit  = pow.merit();
+    computed->vGapStart.shrink_to_fit();
+    summary = computed;
 
-    return bnTarget;
+    // Attach it if the budget allows; a concurrent caller may have beaten us to it
+    size_t nUsage = RecursiveDynamicUsage(summary);
+    if (nPoWSummaryCacheUsage.load() + nUsage <= nPoWSummaryCacheMax) {
+        std::shared_ptr<const CBlockPoWSummary> expected;
+        if (std::atomic_compare_exchange_strong(&block.powSummary, &expected, summary))
+            nPoWSummaryCacheUsage += nUsage;
+    }
+    return summary;
+}
+
+size_t PoWSummaryCacheUsage()
+{
+    return nPoWSummaryCacheUsage;
+}
+
+void ResetPoWSummaryCacheUsage()
+{
+    nPoWSummaryCacheUsage = 0;
 }
 
 int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& from, const CBlockIndex& tip, const Consensus::Params& params)
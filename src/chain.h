@@ -10,9 +10,11 @@
 #include <arith_uint256.h>
 #include <primitives/block.h>
 #include <pow.h>
+#include <prevector.h>
 #include <tinyformat.h>
 #include <uint256.h>
 
+#include <memory>
 #include <vector>
 
 /**
@@ -163,6 +165,32 @@ enum BlockStatus: uint32_t {
     BLOCK_OPT_WITNESS       =   128, //!< block data in blk*.data was received with a witness-enforcing client
 };
 
+/** Gap values derived from a block's proof of work. Deriving them runs
+ * primality tests, so they are computed once and cached on the CBlockIndex.
+ * The gap end is gap start + gap length.
+ */
+struct CBlockPoWSummary
+{
+    uint64_t nMerit;
+    uint64_t nGapLen;
+    //! Gap start as returned by PoW::get_gap (little-endian, unsigned)
+    std::vector<uint8_t> vGapStart;
+
+    CBlockPoWSummary() : nMerit(0), nGapLen(0) {}
+};
+
+//! -powsummarycache default (MiB)
+static const int64_t DEFAULT_POWSUMMARY_CACHE = 32;
+//! Memory budget for the PoW summaries cached on the block index (bytes)
+extern size_t nPoWSummaryCacheMax;
+
+/**
+ * Adder of a block index entry. Adders for shifts of up to 96 bits, which
+ * covers the blocks mined in practice, fit the inline buffer of the prevector
+ * and need no heap allocation of their own.
+ */
+typedef prevector<12, unsigned char> CIndexAdder;
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -207,8 +235,8 @@ public:
     //! Verification status of this block. See enum BlockStatus
     uint32_t nStatus;
 
-    // pow utils
-    PoWUtils *utils;
+    //! (memory only) Cached gap values, filled by GetBlockPoWSummary. Use atomic access.
+    mutable std::shared_ptr<const CBlockPoWSummary> powSummary;
 
     //! block header
     int32_t nVersion;
@@ -217,7 +245,7 @@ public:
     uint64_t nDifficulty;
     uint32_t nNonce;
     uint16_t nShift;
-    std::vector<unsigned char> nAdd;
+    CIndexAdder nAdd;
 
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     int32_t nSequenceId;
@@ -247,14 +275,13 @@ public:
         nDifficulty    = 0;
         nNonce         = 0;
         nShift         = 0;
-        nAdd.assign(1, 0);
-        utils          = nullptr;
+        nAdd.assign((CIndexAdder::size_type)1, 0);
+        powSummary.reset();
     }
 
     CBlockIndex()
     {
         SetNull();
-        utils = new PoWUtils();
     }
 
     explicit CBlockIndex(const CBlockHeader& block)
@@ -268,7 +295,6 @@ public:
         nNonce         = block.nNonce;
         nShift         = block.nShift;
         nAdd.assign(block.nAdd.begin(), block.nAdd.end());
-        utils          = new PoWUtils();
     }
 
     CDiskBlockPos GetBlockPos() const {
@@ -375,6 +401,12 @@ public:
 };
 
 arith_uint256 GetBlockProof(const CBlockIndex& block);
+/** Return the gap values of a block, computing and caching them on the index within the memory budget. Thread-safe. */
+std::shared_ptr<const CBlockPoWSummary> GetBlockPoWSummary(const CBlockIndex& block);
+/** Memory used by the PoW summaries cached on the block index */
+size_t PoWSummaryCacheUsage();
+/** Forget the cached PoW summary accounting, when the block index is unloaded */
+void ResetPoWSummaryCacheUsage();
 /** Return the time it would take to redo the work difference between from and to, assuming the current hashrate corresponds to the difficulty at tip, in seconds. */
 int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& from, const CBlockIndex& tip, const Consensus::Params&);
 /** Find the forking point between two chain tips. */
@@ -84,6 +84,17 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
     cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
 }
 
+void CCoinsViewCache::CacheCoin(const COutPoint& outpoint, Coin&& coin) {
+    assert(!coin.IsSpent());
+    CCoinsMap::iterator it;
+    bool inserted;
+    std::tie(it, inserted) = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::tuple<>());
+    if (inserted) {
+        it->second.coin = std::move(coin);
+        cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+    }
+}
+
 void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight, bool check) {
     bool fCoinbase = tx.IsCoinBase();
     const uint256& txid = tx.GetHash();
@@ -143,7 +154,7 @@ void CCoinsViewCache::SetBestBlock(const uint256 &hashBlockIn) {
 }
 
 bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn) {
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); it = mapCoins.erase(it)) {
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); ++it) {
         // Ignore non-dirty entries (optimization).
         if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
             continue;
@@ -196,6 +207,8 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
             }
         }
     }
+    // Releasing the child's chunks at once is cheaper than erasing entry by entry
+    mapCoins.clear();
     hashBlock = hashBlockIn;
     return true;
 }
@@ -207,6 +220,71 @@ bool CCoinsViewCache::Flush() {
     return fOk;
 }
 
+bool CCoinsViewCache::Sync(size_t nMaxUsage) {
+    std::vector<CCoinsMap::iterator> vRecent;
+    CCoinsMap mapWrite;
+    size_t nWriteUsage = 0;
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); ) {
+        if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
+            ++it;
+        } else if (it->second.coin.IsSpent()) {
+            // Spent entries are written (unless the base never saw them) and dropped
+            cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+            if (!(it->second.flags & CCoinsCacheEntry::FRESH))
+                mapWrite.emplace(it->first, std::move(it->second));
+            cacheCoins.erase(it++);
+        } else {
+            nWriteUsage += it->second.coin.DynamicMemoryUsage();
+            vRecent.push_back(it);
+            ++it;
+        }
+    }
+    // The batch is held until the base has written it, so the unspent
+    // entries copied to it count against the limit as well.
+    nWriteUsage += memusage::DynamicUsage(mapWrite) + vRecent.size() * (sizeof(CCoinsMap::value_type) + sizeof(void*) + 1);
+
+    if (DynamicMemoryUsage() + nWriteUsage <= nMaxUsage) {
+        for (const CCoinsMap::iterator& it : vRecent) {
+            mapWrite.emplace(it->first, it->second);
+            it->second.flags = 0;
+        }
+    } else {
+        // Erasing would leave the pooled entries allocated, so move the ones
+        // kept to a new map and let the old one go as a whole. The modified
+        // entries that don't fit are moved to the batch instead of copied.
+        const size_t nKeepMax = nMaxUsage > nWriteUsage ? nMaxUsage - nWriteUsage : 0;
+        CCoinsMap mapKeep;
+        size_t nKeepUsage = 0;
+        bool fFull = false;
+        for (const CCoinsMap::iterator& it : vRecent) {
+            const size_t nUsage = it->second.coin.DynamicMemoryUsage();
+            fFull = fFull || memusage::DynamicUsage(mapKeep) + nKeepUsage + nUsage > nKeepMax;
+            if (fFull) {
+                mapWrite.emplace(it->first, std::move(it->second));
+                continue;
+            }
+            mapWrite.emplace(it->first, it->second);
+            it->second.flags = 0;
+            mapKeep.emplace(it->first, std::move(it->second));
+            nKeepUsage += nUsage;
+        }
+        for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end() && !fFull; ++it) {
+            // Skip the modified entries, moved to the batch or kept above
+            if ((it->second.flags & CCoinsCacheEntry::DIRTY) || mapKeep.count(it->first))
+                continue;
+            const size_t nUsage = it->second.coin.DynamicMemoryUsage();
+            if (memusage::DynamicUsage(mapKeep) + nKeepUsage + nUsage > nKeepMax)
+                break;
+            mapKeep.emplace(it->first, std::move(it->second));
+            nKeepUsage += nUsage;
+        }
+        cacheCoins.swap(mapKeep);
+        cachedCoinsUsage = nKeepUsage;
+    }
+
+    return base->BatchWrite(mapWrite, hashBlock);
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
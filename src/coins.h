@@ -9,6 +9,7 @@
 #include <primitives/transaction.h>
 #include <compressor.h>
 #include <core_memusage.h>
+#include <flatmap.h>
 #include <hash.h>
 #include <memusage.h>
 #include <serialize.h>
@@ -119,7 +120,7 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+typedef flatmap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -254,6 +255,13 @@ public:
      */
     void AddCoin(const COutPoint& outpoint, Coin&& coin, bool potential_overwrite);
 
+    /**
+     * Cache a coin read from the base view ahead of its use, unless the
+     * outpoint has an entry already. The caller has to make sure the base
+     * has not been written to since the coin was read.
+     */
+    void CacheCoin(const COutPoint& outpoint, Coin&& coin);
+
     /**
      * Spend a coin. Pass moveto in order to get the deleted data.
      * If no unspent output exists for the passed outpoint, this call
@@ -268,6 +276,15 @@ public:
      */
     bool Flush();
 
+    /**
+     * Push the modifications applied to this cache to its base like Flush(),
+     * but keep the unspent coins cached as unmodified entries. If the cache
+     * and the batch handed to the base would use more than nMaxUsage bytes,
+     * the cache is rebuilt with the entries that fit, the ones modified since
+     * the last flush first, so the coins in recent use stay cached.
+     */
+    bool Sync(size_t nMaxUsage);
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is
      * not modified.
@@ -0,0 +1,217 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coinsprefetch.h>
+
+#include <coins.h>
+#include <consensus/merkle.h>
+#include <primitives/block.h>
+#include <sync.h>
+#include <util.h>
+#include <utiltime.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/** The coins read for one block */
+struct CPrefetchJob
+{
+    uint256 hashBlock;
+    //! nPrefetchSequence before the first read
+    uint64_t nSequence = 0;
+    std::vector<COutPoint> vOutpoints;
+    //! The coins read, spent where the view has none
+    std::vector<Coin> vCoins;
+    //! First outpoint not claimed by a thread yet
+    std::atomic<size_t> nNext{0};
+    std::atomic<size_t> nDone{0};
+    std::atomic<bool> fCancelled{false};
+};
+
+std::mutex cs_prefetch;
+//! Signalled when a job is queued, when one is read completely and on stop
+std::condition_variable condPrefetch;
+std::deque<std::shared_ptr<CPrefetchJob>> vJobs;
+std::vector<std::thread> vPrefetchThreads;
+CCoinsView* pviewPrefetch = nullptr;
+bool fStopPrefetch = false;
+//! Bumped whenever the view read from is written to
+std::atomic<uint64_t> nPrefetchSequence{0};
+
+/** Read batches of the coins of job until all are claimed */
+void ReadCoins(CPrefetchJob& job)
+{
+    const size_t nSize = job.vOutpoints.size();
+    while (!job.fCancelled) {
+        const size_t nBegin = job.nNext.fetch_add(PREFETCH_BATCH_SIZE);
+        if (nBegin >= nSize)
+            return;
+        const size_t nEnd = std::min(nBegin + PREFETCH_BATCH_SIZE, nSize);
+        for (size_t i = nBegin; i < nEnd; i++) {
+            if (!pviewPrefetch->GetCoin(job.vOutpoints[i], job.vCoins[i]))
+                job.vCoins[i].Clear();
+        }
+        if (job.nDone.fetch_add(nEnd - nBegin) + (nEnd - nBegin) == nSize) {
+            std::lock_guard<std::mutex> lock(cs_prefetch);
+            condPrefetch.notify_all();
+        }
+    }
+}
+
+void ThreadPrefetch()
+{
+    std::unique_lock<std::mutex> lock(cs_prefetch);
+    while (!fStopPrefetch) {
+        std::shared_ptr<CPrefetchJob> job;
+        for (const auto& pending : vJobs) {
+            if (pending->nNext < pending->vOutpoints.size()) {
+                job = pending;
+                break;
+            }
+        }
+        if (!job) {
+            condPrefetch.wait(lock);
+            continue;
+        }
+        lock.unlock();
+        ReadCoins(*job);
+        lock.lock();
+    }
+}
+
+} // namespace
+
+void StartCoinsPrefetch(CCoinsView* view, int nThreads)
+{
+    std::lock_guard<std::mutex> lock(cs_prefetch);
+    assert(vPrefetchThreads.empty());
+    pviewPrefetch = view;
+    fStopPrefetch = false;
+    for (int i = 0; i < nThreads; i++) {
+        vPrefetchThreads.emplace_back(&TraceThread<std::function<void()>>, "prefetch",
+            std::function<void()>(&ThreadPrefetch));
+    }
+}
+
+void StopCoinsPrefetch()
+{
+    std::vector<std::thread> vThreads;
+    {
+        std::lock_guard<std::mutex> lock(cs_prefetch);
+        fStopPrefetch = true;
+        for (const auto& job : vJobs)
+            job->fCancelled = true;
+        vJobs.clear();
+        vThreads.swap(vPrefetchThreads);
+        condPrefetch.notify_all();
+    }
+    for (std::thread& thread : vThreads)
+        thread.join();
+    std::lock_guard<std::mutex> lock(cs_prefetch);
+    pviewPrefetch = nullptr;
+}
+
+void PrefetchBlockCoins(const std::shared_ptr<const CBlock>& pblock)
+{
+    {
+        std::lock_guard<std::mutex> lock(cs_prefetch);
+        if (vPrefetchThreads.empty())
+            return;
+    }
+    const CBlock& block = *pblock;
+    bool mutated;
+    if (block.vtx.empty() || BlockMerkleRoot(block, &mutated) != block.hashMerkleRoot || mutated)
+        return;
+
+    std::shared_ptr<CPrefetchJob> job = std::make_shared<CPrefetchJob>();
+    job->hashBlock = block.GetHash();
+    job->nSequence = nPrefetchSequence;
+    std::set<uint256> setTxids;
+    for (const auto& tx : block.vtx)
+        setTxids.insert(tx->GetHash());
+    {
+        // Skipping the coins cached already is only worth it if cs_main is free;
+        // otherwise they are read needlessly and left out when applied
+        TRY_LOCK(cs_main, lockMain);
+        const CCoinsViewCache* pcache = lockMain ? pcoinsTip.get() : nullptr;
+        for (size_t i = 1; i < block.vtx.size(); i++) {
+            for (const CTxIn& txin : block.vtx[i]->vin) {
+                if (setTxids.count(txin.prevout.hash) || (pcache && pcache->HaveCoinInCache(txin.prevout)))
+                    continue;
+                job->vOutpoints.push_back(txin.prevout);
+            }
+        }
+    }
+    if (job->vOutpoints.empty())
+        return;
+    job->vCoins.resize(job->vOutpoints.size());
+
+    std::lock_guard<std::mutex> lock(cs_prefetch);
+    for (const auto& pending : vJobs) {
+        if (pending->hashBlock == job->hashBlock)
+            return;
+    }
+    vJobs.push_back(job);
+    while (vJobs.size() > MAX_PREFETCH_BLOCKS) {
+        vJobs.front()->fCancelled = true;
+        vJobs.pop_front();
+    }
+    condPrefetch.notify_all();
+}
+
+void ApplyPrefetchedCoins(const CBlock& block, CCoinsViewCache& view)
+{
+    AssertLockHeld(cs_main);
+    const uint256 hashBlock = block.GetHash();
+    std::shared_ptr<CPrefetchJob> job;
+    {
+        std::lock_guard<std::mutex> lock(cs_prefetch);
+        for (auto it = vJobs.begin(); it != vJobs.end(); ++it) {
+            if ((*it)->hashBlock == hashBlock) {
+                job = *it;
+                vJobs.erase(it);
+                break;
+            }
+        }
+    }
+    // The sequence is bumped before and after every write to the view, so it
+    // only matches if no write overlapped the reads so far. Writes are made
+    // holding cs_main, so none can overlap the reads still to come.
+    if (!job || job->fCancelled || job->nSequence != nPrefetchSequence)
+        return;
+
+    const int64_t nStart = GetTimeMicros();
+    ReadCoins(*job);
+    {
+        std::unique_lock<std::mutex> lock(cs_prefetch);
+        condPrefetch.wait(lock, [&job]{ return job->nDone == job->vOutpoints.size(); });
+    }
+    size_t nCached = 0;
+    for (size_t i = 0; i < job->vOutpoints.size(); i++) {
+        if (!job->vCoins[i].IsSpent()) {
+            view.CacheCoin(job->vOutpoints[i], std::move(job->vCoins[i]));
+            nCached++;
+        }
+    }
+    LogPrint(BCLog::BENCH, "  - Prefetched coins: %u of %u found, %.2fms waiting\n", nCached, job->vOutpoints.size(), (GetTimeMicros() - nStart) * 0.001);
+}
+
+void InvalidatePrefetchedCoins()
+{
+    nPrefetchSequence++;
+    std::lock_guard<std::mutex> lock(cs_prefetch);
+    for (const auto& job : vJobs)
+        job->fCancelled = true;
+    vJobs.clear();
+}
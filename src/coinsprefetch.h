@@ -0,0 +1,56 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_COINSPREFETCH_H
+#define BITCOIN_COINSPREFETCH_H
+
+#include <memory>
+#include <stddef.h>
+
+class CBlock;
+class CCoinsView;
+class CCoinsViewCache;
+
+/** -prefetchthreads default */
+static const int DEFAULT_PREFETCH_THREADS = 4;
+/** Maximum number of threads reading coins ahead */
+static const int MAX_PREFETCH_THREADS = 16;
+/** Blocks whose coins are held until they are connected; older ones are dropped */
+static const size_t MAX_PREFETCH_BLOCKS = 16;
+/** Coins a thread reads before looking for other work */
+static const size_t PREFETCH_BATCH_SIZE = 64;
+
+/**
+ * Start nThreads threads reading the coins of blocks from view, which has to
+ * be safe to read from any thread, as CCoinsViewFlusher is.
+ */
+void StartCoinsPrefetch(CCoinsView* view, int nThreads);
+/** Stop the threads and drop what they read */
+void StopCoinsPrefetch();
+
+/**
+ * Read the coins spent by block that are neither created by the block itself
+ * nor cached in pcoinsTip already, in the background. Called once the block
+ * structure is checked, so the reads overlap with checking its proof of work.
+ * Does nothing if prefetching is not started.
+ */
+void PrefetchBlockCoins(const std::shared_ptr<const CBlock>& pblock);
+
+/**
+ * Move the coins read for block into view, normally pcoinsTip, before
+ * ConnectBlock looks them up. Reads still running are finished in the
+ * calling thread. Nothing is moved if view was written to its base since
+ * the reads started. Requires cs_main.
+ */
+void ApplyPrefetchedCoins(const CBlock& block, CCoinsViewCache& view);
+
+/**
+ * Drop the coins read so far, as they may be outdated. Called with cs_main
+ * held both before and after pcoinsTip writes to its base: prefetching does
+ * not take cs_main, so reads can start while the write is in progress and
+ * return coins it is about to spend.
+ */
+void InvalidatePrefetchedCoins();
+
+#endif // BITCOIN_COINSPREFETCH_H
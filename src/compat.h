@@ -35,6 +35,7 @@
 #else
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <poll.h>
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -86,8 +87,16 @@ typedef int32_t ssize_t;
 size_t strnlen( const char *start, size_t max_len);
 #endif // HAVE_DECL_STRNLEN
 
+// poll() has no FD_SETSIZE limit, so it is used instead of select() wherever available
+#ifndef WIN32
+#define USE_POLL
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+#define USE_EPOLL
+#endif
+
 bool static inline IsSelectableSocket(const SOCKET& s) {
-#ifdef WIN32
+#if defined(WIN32) || defined(USE_POLL)
     return true;
 #else
     return (s < FD_SETSIZE);
@@ -5,6 +5,7 @@
 #ifndef BITCOIN_CORE_MEMUSAGE_H
 #define BITCOIN_CORE_MEMUSAGE_H
 
+#include <chain.h>
 #include <primitives/transaction.h>
 #include <primitives/block.h>
 #include <memusage.h>
@@ -63,6 +64,10 @@ static inline size_t RecursiveDynamicUsage(const CBlockLocator& locator) {
     return memusage::DynamicUsage(locator.vHave);
 }
 
+static inline size_t RecursiveDynamicUsage(const CBlockPoWSummary& summary) {
+    return memusage::DynamicUsage(summary.vGapStart);
+}
+
 template<typename X>
 static inline size_t RecursiveDynamicUsage(const std::shared_ptr<X>& p) {
     return p ? memusage::DynamicUsage(p) + RecursiveDynamicUsage(*p) : 0;
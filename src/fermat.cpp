@@ -0,0 +1,236 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <fermat.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__amd64__)) && (defined(__clang__) || __GNUC__ >= 5) && GMP_NUMB_BITS == 64
+#define ENABLE_FERMAT_VECTOR 1
+#include <cpuid.h>
+namespace fermat_avx2
+{
+void Test(const uint64_t* pN, const uint64_t* pOne, size_t nLimbs, size_t nBits, bool* pfPrime);
+}
+namespace fermat_avx512
+{
+void Test(const uint64_t* pN, const uint64_t* pOne, size_t nLimbs, size_t nBits, bool* pfPrime);
+}
+#endif
+
+namespace {
+
+/**
+ * A vector backend tests nLanes candidates at once. Its input are the
+ * candidates and R mod n, R = 2^(nLimbs * nLimbBits), split into limbs of
+ * nLimbBits bits, limb-major: limb i of lane j is at i * nLanes + j.
+ */
+typedef void (*TestType)(const uint64_t* pN, const uint64_t* pOne, size_t nLimbs, size_t nBits, bool* pfPrime);
+
+struct Backend
+{
+    const char* name;
+    TestType test;
+    size_t nLanes;
+    unsigned int nLimbBits;
+};
+
+const size_t MAX_LANES = FERMAT_MAX_BATCH_SIZE;
+const size_t MAX_LIMBS = (FERMAT_MAX_VECTOR_BITS + 4 + 31) / 32;
+
+const Backend backendGMP = {"gmp", nullptr, 1, 0};
+#ifdef ENABLE_FERMAT_VECTOR
+const Backend backendAVX2 = {"avx2", fermat_avx2::Test, 4, 32};
+const Backend backendAVX512 = {"avx512ifma", fermat_avx512::Test, 8, 52};
+#endif
+
+const Backend* backend = &backendGMP;
+
+bool TestGMP(mpz_srcptr mpzN)
+{
+    mpz_t mpzExp, mpzResult;
+    mpz_init(mpzExp);
+    mpz_init_set_ui(mpzResult, 2);
+    mpz_sub_ui(mpzExp, mpzN, 1);
+    mpz_powm(mpzResult, mpzResult, mpzExp, mpzN);
+    bool fPrime = mpz_cmp_ui(mpzResult, 1) == 0;
+    mpz_clear(mpzExp);
+    mpz_clear(mpzResult);
+    return fPrime;
+}
+
+uint64_t GetLimb(mpz_srcptr mpz, size_t i)
+{
+    return i < mpz_size(mpz) ? mpz_getlimbn(mpz, i) : 0;
+}
+
+/** Split mpz into nLimbs limbs of nLimbBits bits for lane nLane */
+void ToLimbs(mpz_srcptr mpz, const Backend& b, size_t nLimbs, size_t nLane, uint64_t* pOut)
+{
+    const uint64_t nMask = (1ULL << b.nLimbBits) - 1;
+    for (size_t i = 0; i < nLimbs; i++) {
+        size_t nBit = i * b.nLimbBits;
+        size_t nWord = nBit / 64, nShift = nBit % 64;
+        uint64_t nValue = GetLimb(mpz, nWord) >> nShift;
+        if (nShift + b.nLimbBits > 64)
+            nValue |= GetLimb(mpz, nWord + 1) << (64 - nShift);
+        pOut[i * b.nLanes + nLane] = nValue & nMask;
+    }
+}
+
+void TestBatch(const Backend& b, const mpz_t* pCandidates, size_t nCount, bool* pfPrime)
+{
+    size_t nBits = 0;
+    for (size_t i = 0; i < nCount; i++)
+        nBits = std::max(nBits, mpz_sizeinbase(pCandidates[i], 2));
+    if (!b.test || nBits > FERMAT_MAX_VECTOR_BITS) {
+        for (size_t i = 0; i < nCount; i++)
+            pfPrime[i] = TestGMP(pCandidates[i]);
+        return;
+    }
+
+    // Four bits of headroom keep every intermediate result below R
+    const size_t nLimbs = (nBits + 4 + b.nLimbBits - 1) / b.nLimbBits;
+    uint64_t vN[MAX_LIMBS * MAX_LANES], vOne[MAX_LIMBS * MAX_LANES];
+    bool vPrime[MAX_LANES];
+    mpz_t mpzOne;
+    mpz_init(mpzOne);
+    for (size_t nLane = 0; nLane < b.nLanes; nLane++) {
+        // Spare lanes repeat the last candidate
+        mpz_srcptr mpzN = pCandidates[std::min(nLane, nCount - 1)];
+        mpz_set_ui(mpzOne, 0);
+        mpz_setbit(mpzOne, nLimbs * b.nLimbBits);
+        mpz_mod(mpzOne, mpzOne, mpzN);
+        ToLimbs(mpzN, b, nLimbs, nLane, vN);
+        ToLimbs(mpzOne, b, nLimbs, nLane, vOne);
+    }
+    mpz_clear(mpzOne);
+
+    b.test(vN, vOne, nLimbs, nBits, vPrime);
+    std::copy(vPrime, vPrime + nCount, pfPrime);
+}
+
+/** Compare a backend with GMP on primes, composites and base 2 pseudoprimes of mixed sizes */
+bool SelfTest(const Backend& b)
+{
+    const size_t nCount = 12;
+    mpz_t vN[nCount];
+    for (size_t i = 0; i < nCount; i++)
+        mpz_init(vN[i]);
+    mpz_set_ui(vN[0], 341);                 // 11 * 31, a pseudoprime
+    mpz_set_ui(vN[1], 561);                 // a Carmichael number
+    mpz_set_ui(vN[2], 15);
+    mpz_ui_pow_ui(vN[3], 2, 89);
+    mpz_sub_ui(vN[3], vN[3], 1);            // a Mersenne prime
+    mpz_ui_pow_ui(vN[4], 2, 281);
+    mpz_sub_ui(vN[4], vN[4], 1);            // composite, but a pseudoprime
+    mpz_add_ui(vN[5], vN[4], 2);            // 2^281 + 1, divisible by 3
+    mpz_ui_pow_ui(vN[6], 2, 280);
+    mpz_nextprime(vN[6], vN[6]);
+    mpz_add_ui(vN[7], vN[6], 2);
+    mpz_ui_pow_ui(vN[8], 2, 607);
+    mpz_sub_ui(vN[8], vN[8], 1);            // a Mersenne prime
+    mpz_add_ui(vN[9], vN[8], 2);
+    mpz_ui_pow_ui(vN[10], 2, 1019);
+    mpz_sub_ui(vN[10], vN[10], 1);          // the largest the vector backends take, a pseudoprime
+    mpz_mul(vN[11], vN[6], vN[6]);          // 562 bits
+
+    bool fOk = true;
+    for (size_t nFirst = 0; nFirst < nCount; nFirst++) {
+        for (size_t nBatch = 1; nFirst + nBatch <= nCount && nBatch <= b.nLanes; nBatch++) {
+            bool vPrime[MAX_LANES];
+            TestBatch(b, vN + nFirst, nBatch, vPrime);
+            for (size_t i = 0; i < nBatch; i++)
+                fOk &= vPrime[i] == TestGMP(vN[nFirst + i]);
+        }
+    }
+
+    for (size_t i = 0; i < nCount; i++)
+        mpz_clear(vN[i]);
+    return fOk;
+}
+
+#ifdef ENABLE_FERMAT_VECTOR
+/** Register state the OS saves on context switches */
+uint64_t GetXCR0()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return a | ((uint64_t)d << 32);
+}
+#endif
+
+bool IsSupported(const Backend& b)
+{
+    if (&b == &backendGMP)
+        return true;
+#ifdef ENABLE_FERMAT_VECTOR
+    uint32_t eax, ebx, ecx, edx;
+    // AVX with OSXSAVE, and the OS saving the YMM state
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !((ecx >> 27) & 1) || !((ecx >> 28) & 1) || (GetXCR0() & 0x6) != 0x6)
+        return false;
+    if (__get_cpuid_max(0, nullptr) < 7)
+        return false;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    if (&b == &backendAVX2)
+        return (ebx >> 5) & 1;
+    // AVX-512F and IFMA, and the OS saving the ZMM state
+    if (&b == &backendAVX512)
+        return ((ebx >> 16) & 1) && ((ebx >> 21) & 1) && (GetXCR0() & 0xe6) == 0xe6;
+#endif
+    return false;
+}
+
+} // namespace
+
+void FermatTest(const mpz_t* pCandidates, size_t nCount, bool* pfPrime)
+{
+    const Backend& b = *backend;
+    for (size_t nDone = 0; nDone < nCount; nDone += b.nLanes)
+        TestBatch(b, pCandidates + nDone, std::min(b.nLanes, nCount - nDone), pfPrime + nDone);
+}
+
+bool FermatTest(const mpz_t mpzCandidate)
+{
+    // A lone candidate is not worth a vector pass
+    return TestGMP(mpzCandidate);
+}
+
+size_t FermatBatchSize()
+{
+    return backend->nLanes;
+}
+
+std::string FermatAutoDetect()
+{
+#ifdef ENABLE_FERMAT_VECTOR
+    // AVX2 only beats GMP below the sizes of mined candidates, 256 bits plus
+    // the shift, so it is never picked by default
+    if (IsSupported(backendAVX512)) {
+        assert(SelfTest(backendAVX512));
+        backend = &backendAVX512;
+        return backend->name;
+    }
+#endif
+    backend = &backendGMP;
+    return backend->name;
+}
+
+bool FermatSelect(const std::string& strName)
+{
+    for (const Backend* b : {
+#ifdef ENABLE_FERMAT_VECTOR
+        &backendAVX512, &backendAVX2,
+#endif
+        &backendGMP}) {
+        if (strName == b->name && IsSupported(*b)) {
+            assert(SelfTest(*b));
+            backend = b;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,34 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_FERMAT_H
+#define BITCOIN_FERMAT_H
+
+#include <gmp.h>
+#include <stddef.h>
+#include <string>
+
+/** Largest candidates, in bits, the vector backends take; larger ones go to GMP */
+static const size_t FERMAT_MAX_VECTOR_BITS = 1020;
+/** Upper bound of FermatBatchSize() */
+static const size_t FERMAT_MAX_BATCH_SIZE = 8;
+
+/**
+ * Base 2 Fermat test, 2^(n-1) = 1 (mod n), of nCount odd candidates n > 3.
+ * A composite result is certain, a prime one probable. The vector backends
+ * test a batch of FermatBatchSize() candidates at once, one per lane, with
+ * Montgomery multiplication; GMP tests them one by one.
+ */
+void FermatTest(const mpz_t* pCandidates, size_t nCount, bool* pfPrime);
+bool FermatTest(const mpz_t mpzCandidate);
+
+/** Candidates the selected backend tests in parallel */
+size_t FermatBatchSize();
+
+/** Select the fastest Fermat test backend the CPU supports and return its name */
+std::string FermatAutoDetect();
+/** Select a backend by name ("gmp", "avx2" or "avx512ifma"), if the CPU supports it */
+bool FermatSelect(const std::string& strName);
+
+#endif // BITCOIN_FERMAT_H
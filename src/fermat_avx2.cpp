@@ -0,0 +1,111 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// Base 2 Fermat test of four candidates at once, one per 64-bit lane of an
+// AVX2 register. Numbers are kept in 32-bit limbs so that the 32x32->64 bit
+// vpmuludq products can be accumulated without losing carries.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if (defined(__x86_64__) || defined(__amd64__)) && (defined(__clang__) || __GNUC__ >= 5)
+
+#include <immintrin.h>
+
+namespace fermat_avx2
+{
+namespace
+{
+const size_t MAX_LIMBS = 33;
+
+/** t = a * b / 2^(32 * nLimbs) mod n, word by word (CIOS); a, b < 4n gives t < 2n */
+__attribute__((target("avx2")))
+void MontMul(__m256i* t, const __m256i* a, const __m256i* b, const __m256i* n, __m256i nInv, size_t nLimbs)
+{
+    const __m256i mask = _mm256_set1_epi64x(0xffffffff);
+    __m256i r[MAX_LIMBS + 2];
+    for (size_t j = 0; j < nLimbs + 2; j++)
+        r[j] = _mm256_setzero_si256();
+
+    for (size_t i = 0; i < nLimbs; i++) {
+        // r += a[i] * b
+        __m256i carry = _mm256_setzero_si256();
+        for (size_t j = 0; j < nLimbs; j++) {
+            __m256i s = _mm256_add_epi64(_mm256_add_epi64(r[j], _mm256_mul_epu32(a[i], b[j])), carry);
+            r[j] = _mm256_and_si256(s, mask);
+            carry = _mm256_srli_epi64(s, 32);
+        }
+        __m256i s = _mm256_add_epi64(r[nLimbs], carry);
+        r[nLimbs] = _mm256_and_si256(s, mask);
+        r[nLimbs + 1] = _mm256_srli_epi64(s, 32);
+
+        // r = (r + m * n) / 2^32, with m chosen to clear the low limb
+        __m256i m = _mm256_and_si256(_mm256_mul_epu32(r[0], nInv), mask);
+        carry = _mm256_srli_epi64(_mm256_add_epi64(r[0], _mm256_mul_epu32(m, n[0])), 32);
+        for (size_t j = 1; j < nLimbs; j++) {
+            s = _mm256_add_epi64(_mm256_add_epi64(r[j], _mm256_mul_epu32(m, n[j])), carry);
+            r[j - 1] = _mm256_and_si256(s, mask);
+            carry = _mm256_srli_epi64(s, 32);
+        }
+        s = _mm256_add_epi64(r[nLimbs], carry);
+        r[nLimbs - 1] = _mm256_and_si256(s, mask);
+        r[nLimbs] = _mm256_add_epi64(r[nLimbs + 1], _mm256_srli_epi64(s, 32));
+    }
+
+    for (size_t j = 0; j < nLimbs; j++)
+        t[j] = r[j];
+}
+} // namespace
+
+__attribute__((target("avx2")))
+void Test(const uint64_t* pN, const uint64_t* pOne, size_t nLimbs, size_t nBits, bool* pfPrime)
+{
+    const __m256i mask = _mm256_set1_epi64x(0xffffffff);
+    __m256i n[MAX_LIMBS], x[MAX_LIMBS], unit[MAX_LIMBS];
+    for (size_t j = 0; j < nLimbs; j++) {
+        n[j] = _mm256_loadu_si256((const __m256i*)(pN + 4 * j));
+        x[j] = _mm256_loadu_si256((const __m256i*)(pOne + 4 * j));
+        unit[j] = _mm256_setzero_si256();
+    }
+    unit[0] = _mm256_set1_epi64x(1);
+
+    // -1/n mod 2^32 by Newton iteration, each step doubling the correct bits
+    uint64_t vInv[4];
+    for (int k = 0; k < 4; k++) {
+        uint32_t n0 = (uint32_t)pN[k], inv = n0;
+        for (int i = 0; i < 4; i++)
+            inv *= 2 - n0 * inv;
+        vInv[k] = (uint32_t)-inv;
+    }
+    const __m256i nInv = _mm256_loadu_si256((const __m256i*)vInv);
+
+    // Left to right over the bits of n - 1: square, and double where the bit is set
+    for (size_t nBit = nBits; nBit-- > 0;) {
+        MontMul(x, x, x, n, nInv, nLimbs);
+        if (nBit == 0)
+            break;
+        const __m256i bit = _mm256_set1_epi64x(1ULL << (nBit % 32));
+        const __m256i set = _mm256_cmpeq_epi64(_mm256_and_si256(n[nBit / 32], bit), bit);
+        __m256i carry = _mm256_setzero_si256();
+        for (size_t j = 0; j < nLimbs; j++) {
+            __m256i s = _mm256_add_epi64(_mm256_add_epi64(x[j], _mm256_and_si256(x[j], set)), carry);
+            x[j] = _mm256_and_si256(s, mask);
+            carry = _mm256_srli_epi64(s, 32);
+        }
+    }
+
+    // Out of Montgomery form; x < 4n makes the result fully reduced
+    MontMul(x, x, unit, n, nInv, nLimbs);
+    __m256i diff = _mm256_xor_si256(x[0], unit[0]);
+    for (size_t j = 1; j < nLimbs; j++)
+        diff = _mm256_or_si256(diff, x[j]);
+    uint64_t vDiff[4];
+    _mm256_storeu_si256((__m256i*)vDiff, diff);
+    for (int k = 0; k < 4; k++)
+        pfPrime[k] = vDiff[k] == 0;
+}
+
+} // namespace fermat_avx2
+
+#endif
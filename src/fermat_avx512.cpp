@@ -0,0 +1,114 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// Base 2 Fermat test of eight candidates at once, one per 64-bit lane of an
+// AVX-512 register. Numbers are kept in 52-bit limbs for the IFMA
+// instructions, which add the low or high half of a 52x52 bit product.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if (defined(__x86_64__) || defined(__amd64__)) && (defined(__clang__) || __GNUC__ >= 5)
+
+#include <immintrin.h>
+
+namespace fermat_avx512
+{
+namespace
+{
+const size_t MAX_LIMBS = 20;
+
+/** Propagate carries so that every limb is below 2^52 again */
+__attribute__((target("avx512f,avx512ifma")))
+void Normalize(__m512i* x, size_t nLimbs)
+{
+    const __m512i mask = _mm512_set1_epi64((1ULL << 52) - 1);
+    __m512i carry = _mm512_setzero_si512();
+    for (size_t j = 0; j < nLimbs; j++) {
+        __m512i s = _mm512_add_epi64(x[j], carry);
+        x[j] = _mm512_and_si512(s, mask);
+        carry = _mm512_srli_epi64(s, 52);
+    }
+}
+
+/** t = a * b / 2^(52 * nLimbs) mod n, word by word (CIOS); a, b < 4n gives t < 2n */
+__attribute__((target("avx512f,avx512ifma")))
+void MontMul(__m512i* t, const __m512i* a, const __m512i* b, const __m512i* n, __m512i nInv, size_t nLimbs)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i r[MAX_LIMBS + 1];
+    for (size_t j = 0; j < nLimbs + 1; j++)
+        r[j] = zero;
+
+    // Limbs collect unreduced sums of product halves, at most 4 * 2^52 per
+    // round, which 64 bits hold for every size up to MAX_LIMBS
+    for (size_t i = 0; i < nLimbs; i++) {
+        for (size_t j = 0; j < nLimbs; j++) {
+            r[j] = _mm512_madd52lo_epu64(r[j], a[i], b[j]);
+            r[j + 1] = _mm512_madd52hi_epu64(r[j + 1], a[i], b[j]);
+        }
+        // The multiplier only sees the low 52 bits of r[0], all that matters mod 2^52
+        const __m512i m = _mm512_madd52lo_epu64(zero, r[0], nInv);
+        for (size_t j = 0; j < nLimbs; j++) {
+            r[j] = _mm512_madd52lo_epu64(r[j], m, n[j]);
+            r[j + 1] = _mm512_madd52hi_epu64(r[j + 1], m, n[j]);
+        }
+        // The low 52 bits of r[0] are now zero; shift down a limb
+        const __m512i carry = _mm512_srli_epi64(r[0], 52);
+        for (size_t j = 0; j < nLimbs; j++)
+            r[j] = r[j + 1];
+        r[0] = _mm512_add_epi64(r[0], carry);
+        r[nLimbs] = zero;
+    }
+
+    Normalize(r, nLimbs);
+    for (size_t j = 0; j < nLimbs; j++)
+        t[j] = r[j];
+}
+} // namespace
+
+__attribute__((target("avx512f,avx512ifma")))
+void Test(const uint64_t* pN, const uint64_t* pOne, size_t nLimbs, size_t nBits, bool* pfPrime)
+{
+    __m512i n[MAX_LIMBS], x[MAX_LIMBS], unit[MAX_LIMBS];
+    for (size_t j = 0; j < nLimbs; j++) {
+        n[j] = _mm512_loadu_si512((const void*)(pN + 8 * j));
+        x[j] = _mm512_loadu_si512((const void*)(pOne + 8 * j));
+        unit[j] = _mm512_setzero_si512();
+    }
+    unit[0] = _mm512_set1_epi64(1);
+
+    // -1/n mod 2^52 by Newton iteration, each step doubling the correct bits
+    uint64_t vInv[8];
+    for (int k = 0; k < 8; k++) {
+        uint64_t n0 = pN[k], inv = n0;
+        for (int i = 0; i < 5; i++)
+            inv *= 2 - n0 * inv;
+        vInv[k] = (0 - inv) & ((1ULL << 52) - 1);
+    }
+    const __m512i nInv = _mm512_loadu_si512((const void*)vInv);
+
+    // Left to right over the bits of n - 1: square, and double where the bit is set
+    for (size_t nBit = nBits; nBit-- > 0;) {
+        MontMul(x, x, x, n, nInv, nLimbs);
+        if (nBit == 0)
+            break;
+        const __mmask8 set = _mm512_test_epi64_mask(n[nBit / 52], _mm512_set1_epi64(1ULL << (nBit % 52)));
+        for (size_t j = 0; j < nLimbs; j++)
+            x[j] = _mm512_mask_add_epi64(x[j], set, x[j], x[j]);
+        Normalize(x, nLimbs);
+    }
+
+    // Out of Montgomery form; x < 4n makes the result fully reduced
+    MontMul(x, x, unit, n, nInv, nLimbs);
+    __mmask8 one = _mm512_cmpeq_epi64_mask(x[0], unit[0]);
+    for (size_t j = 1; j < nLimbs; j++)
+        one &= _mm512_cmpeq_epi64_mask(x[j], unit[j]);
+    for (int k = 0; k < 8; k++)
+        pfPrime[k] = (one >> k) & 1;
+}
+
+} // namespace fermat_avx512
+
+#endif
@@ -0,0 +1,361 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_FLATMAP_H
+#define BITCOIN_FLATMAP_H
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* Hash map with open addressing, holding its values in a pool.
+ *
+ * The table is a flat array of one control byte and one value pointer per
+ * slot, probed linearly. The control byte holds 7 bits of the hash, so most
+ * mismatches are ruled out without touching the value. The values are
+ * carved out of chunks that are allocated a few thousand at a time and
+ * recycled through a free list, instead of one heap node each.
+ *
+ * Supports the part of the std::unordered_map interface the coins cache
+ * uses, with the same guarantees: references to values stay valid until
+ * they are erased, iterators until the next insertion. Erasing leaves the
+ * other iterators valid, so erasing while iterating works as usual.
+ */
+template <typename K, typename T, typename Hash>
+class flatmap
+{
+public:
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef std::pair<const K, T> value_type;
+    typedef size_t size_type;
+
+private:
+    enum : uint8_t {
+        CTRL_EMPTY = 0x80,
+        CTRL_DELETED = 0xFE,
+    };
+    enum : size_t {
+        MIN_CAPACITY = 16,
+        MIN_CHUNK = 16,
+        MAX_CHUNK = 4096,
+    };
+
+    union Node {
+        Node* next;
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage;
+    };
+
+    //! Held by pointer, so maps can be swapped even if the hasher cannot
+    std::unique_ptr<Hash> hasher;
+    //! CTRL_EMPTY, CTRL_DELETED or the top 7 bits of the hash of the value in the slot
+    std::vector<uint8_t> ctrl;
+    std::vector<value_type*> slots;
+    size_t nSize;
+    size_t nDeleted;
+
+    std::vector<std::pair<Node*, size_t>> chunks;
+    size_t nChunkBytes;
+    //! Nodes of the last chunk not handed out yet
+    size_t nChunkUsed;
+    Node* freeNodes;
+
+    static uint8_t Tag(size_t hash) { return (hash >> (8 * sizeof(size_t) - 7)) & 0x7F; }
+
+    value_type* AllocateNode()
+    {
+        if (freeNodes) {
+            Node* node = freeNodes;
+            freeNodes = node->next;
+            return reinterpret_cast<value_type*>(&node->storage);
+        }
+        if (chunks.empty() || nChunkUsed == chunks.back().second) {
+            // Chunks grow with the map, so small temporary views stay small
+            size_t nNodes = std::min<size_t>(MAX_CHUNK, std::max<size_t>(MIN_CHUNK, nSize));
+            Node* chunk = static_cast<Node*>(::operator new(nNodes * sizeof(Node)));
+            chunks.emplace_back(chunk, nNodes);
+            nChunkBytes += nNodes * sizeof(Node);
+            nChunkUsed = 0;
+        }
+        return reinterpret_cast<value_type*>(&chunks.back().first[nChunkUsed++].storage);
+    }
+
+    void FreeNode(value_type* value)
+    {
+        value->~value_type();
+        Node* node = reinterpret_cast<Node*>(value);
+        node->next = freeNodes;
+        freeNodes = node;
+    }
+
+    /** Slot holding key, or ctrl.size() */
+    size_t FindSlot(const K& key, size_t hash) const
+    {
+        if (ctrl.empty())
+            return 0;
+        const size_t mask = ctrl.size() - 1;
+        const uint8_t tag = Tag(hash);
+        for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+            if (ctrl[i] == CTRL_EMPTY)
+                return ctrl.size();
+            if (ctrl[i] == tag && slots[i]->first == key)
+                return i;
+        }
+    }
+
+    /** First empty or deleted slot on the probe sequence of hash */
+    size_t FreeSlot(size_t hash) const
+    {
+        const size_t mask = ctrl.size() - 1;
+        size_t i = hash & mask;
+        while (ctrl[i] != CTRL_EMPTY && ctrl[i] != CTRL_DELETED)
+            i = (i + 1) & mask;
+        return i;
+    }
+
+    void Rehash(size_t nCapacity)
+    {
+        std::vector<uint8_t> ctrlOld(nCapacity, uint8_t(CTRL_EMPTY));
+        std::vector<value_type*> slotsOld(nCapacity, nullptr);
+        ctrl.swap(ctrlOld);
+        slots.swap(slotsOld);
+        nDeleted = 0;
+        for (size_t i = 0; i < ctrlOld.size(); i++) {
+            if (ctrlOld[i] & 0x80)
+                continue;
+            const size_t hash = (*hasher)(slotsOld[i]->first);
+            const size_t j = FreeSlot(hash);
+            ctrl[j] = Tag(hash);
+            slots[j] = slotsOld[i];
+        }
+    }
+
+    /** Make room for one more value, keeping the table at most 7/8 full including deleted slots */
+    void Reserve()
+    {
+        if ((nSize + nDeleted + 1) * 8 <= ctrl.size() * 7)
+            return;
+        size_t nCapacity = std::max<size_t>(MIN_CAPACITY, ctrl.size());
+        // Grow unless most of the load is deleted slots
+        while ((nSize + 1) * 16 > nCapacity * 7)
+            nCapacity *= 2;
+        Rehash(nCapacity);
+    }
+
+    void Release()
+    {
+        for (size_t i = 0; i < ctrl.size(); i++) {
+            if (!(ctrl[i] & 0x80))
+                slots[i]->~value_type();
+        }
+        for (const auto& chunk : chunks)
+            ::operator delete(chunk.first);
+    }
+
+    template <typename V, typename M>
+    class iterator_base
+    {
+        friend class flatmap;
+        M* map;
+        size_t i;
+
+        void Skip()
+        {
+            while (i < map->ctrl.size() && (map->ctrl[i] & 0x80))
+                i++;
+        }
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef V value_type;
+        typedef ptrdiff_t difference_type;
+        typedef V* pointer;
+        typedef V& reference;
+
+        iterator_base() : map(nullptr), i(0) {}
+        iterator_base(M* mapIn, size_t iIn) : map(mapIn), i(iIn) {}
+        template <typename V2, typename M2>
+        iterator_base(const iterator_base<V2, M2>& it) : map(it.map), i(it.i) {}
+
+        V& operator*() const { return *map->slots[i]; }
+        V* operator->() const { return map->slots[i]; }
+        iterator_base& operator++() { i++; Skip(); return *this; }
+        iterator_base operator++(int) { iterator_base copy(*this); ++(*this); return copy; }
+        bool operator==(const iterator_base& it) const { return i == it.i; }
+        bool operator!=(const iterator_base& it) const { return i != it.i; }
+
+        template <typename V2, typename M2> friend class iterator_base;
+    };
+
+public:
+    typedef iterator_base<value_type, flatmap> iterator;
+    typedef iterator_base<const value_type, const flatmap> const_iterator;
+
+    flatmap() : hasher(new Hash()), nSize(0), nDeleted(0), nChunkBytes(0), nChunkUsed(0), freeNodes(nullptr) {}
+    ~flatmap() { Release(); }
+
+    flatmap(const flatmap&) = delete;
+    flatmap& operator=(const flatmap&) = delete;
+
+    iterator begin() { iterator it(this, 0); it.Skip(); return it; }
+    iterator end() { return iterator(this, ctrl.size()); }
+    const_iterator begin() const { const_iterator it(this, 0); it.Skip(); return it; }
+    const_iterator end() const { return const_iterator(this, ctrl.size()); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    bool empty() const { return nSize == 0; }
+    size_type size() const { return nSize; }
+    size_type count(const K& key) const { return find(key) != end() ? 1 : 0; }
+
+    iterator find(const K& key) { return iterator(this, FindSlot(key, (*hasher)(key))); }
+    const_iterator find(const K& key) const { return const_iterator(this, FindSlot(key, (*hasher)(key))); }
+
+    template <typename... KArgs, typename... TArgs>
+    std::pair<iterator, bool> emplace(std::piecewise_construct_t, std::tuple<KArgs...> keyArgs, std::tuple<TArgs...> valueArgs)
+    {
+        value_type* value = AllocateNode();
+        try {
+            new (value) value_type(std::piecewise_construct, std::move(keyArgs), std::move(valueArgs));
+        } catch (...) {
+            Node* node = reinterpret_cast<Node*>(value);
+            node->next = freeNodes;
+            freeNodes = node;
+            throw;
+        }
+        return Insert(value);
+    }
+
+    template <typename KArg, typename TArg>
+    std::pair<iterator, bool> emplace(KArg&& key, TArg&& mapped)
+    {
+        return emplace(std::piecewise_construct, std::forward_as_tuple(std::forward<KArg>(key)), std::forward_as_tuple(std::forward<TArg>(mapped)));
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) { return emplace(value.first, value.second); }
+
+    T& operator[](const K& key)
+    {
+        const size_t hash = (*hasher)(key);
+        size_t i = FindSlot(key, hash);
+        if (i == ctrl.size())
+            i = Insert(key, hash);
+        return slots[i]->second;
+    }
+
+    iterator erase(const_iterator it)
+    {
+        const size_t mask = ctrl.size() - 1;
+        FreeNode(slots[it.i]);
+        slots[it.i] = nullptr;
+        // No probe sequence runs past a slot followed by an empty one
+        if (ctrl[(it.i + 1) & mask] == CTRL_EMPTY) {
+            ctrl[it.i] = CTRL_EMPTY;
+        } else {
+            ctrl[it.i] = CTRL_DELETED;
+            nDeleted++;
+        }
+        nSize--;
+        iterator next(this, it.i);
+        next.Skip();
+        return next;
+    }
+
+    iterator erase(iterator it) { return erase(const_iterator(it)); }
+
+    size_type erase(const K& key)
+    {
+        iterator it = find(key);
+        if (it == end())
+            return 0;
+        erase(it);
+        return 1;
+    }
+
+    void clear()
+    {
+        Release();
+        ctrl.clear();
+        ctrl.shrink_to_fit();
+        slots.clear();
+        slots.shrink_to_fit();
+        chunks.clear();
+        chunks.shrink_to_fit();
+        nSize = 0;
+        nDeleted = 0;
+        nChunkBytes = 0;
+        nChunkUsed = 0;
+        freeNodes = nullptr;
+    }
+
+    void swap(flatmap& other)
+    {
+        hasher.swap(other.hasher);
+        ctrl.swap(other.ctrl);
+        slots.swap(other.slots);
+        std::swap(nSize, other.nSize);
+        std::swap(nDeleted, other.nDeleted);
+        chunks.swap(other.chunks);
+        std::swap(nChunkBytes, other.nChunkBytes);
+        std::swap(nChunkUsed, other.nChunkUsed);
+        std::swap(freeNodes, other.freeNodes);
+    }
+
+    //! Bytes of the slot table
+    size_t TableBytes() const { return ctrl.capacity() * sizeof(uint8_t) + slots.capacity() * sizeof(value_type*); }
+    //! Bytes of the value chunks, in use or not
+    size_t ChunkBytes() const { return nChunkBytes; }
+    size_t ChunkCount() const { return chunks.size(); }
+
+private:
+    /** Insert a value constructed by the caller, or drop it if its key is present */
+    std::pair<iterator, bool> Insert(value_type* value)
+    {
+        const size_t hash = (*hasher)(value->first);
+        const size_t i = FindSlot(value->first, hash);
+        if (i != ctrl.size()) {
+            FreeNode(value);
+            return std::make_pair(iterator(this, i), false);
+        }
+        Reserve();
+        const size_t j = FreeSlot(hash);
+        if (ctrl[j] == CTRL_DELETED)
+            nDeleted--;
+        ctrl[j] = Tag(hash);
+        slots[j] = value;
+        nSize++;
+        return std::make_pair(iterator(this, j), true);
+    }
+
+    /** Insert a default value for a key known to be absent */
+    size_t Insert(const K& key, size_t hash)
+    {
+        value_type* value = AllocateNode();
+        try {
+            new (value) value_type(std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>());
+        } catch (...) {
+            Node* node = reinterpret_cast<Node*>(value);
+            node->next = freeNodes;
+            freeNodes = node;
+            throw;
+        }
+        Reserve();
+        const size_t j = FreeSlot(hash);
+        if (ctrl[j] == CTRL_DELETED)
+            nDeleted--;
+        ctrl[j] = Tag(hash);
+        slots[j] = value;
+        nSize++;
+        return j;
+    }
+};
+
+#endif // BITCOIN_FLATMAP_H
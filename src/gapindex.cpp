@@ -0,0 +1,236 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gapindex.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <util.h>
+#include <utiltime.h>
+#include <validation.h>
+
+#include <algorithm>
+
+#include <boost/thread.hpp>
+
+static const char DB_GAP_MERIT = 'm';
+static const char DB_GAP_BLOCK = 'b';
+static const char DB_BEST_BLOCK = 'B';
+
+std::unique_ptr<CGapIndex> g_gapindex;
+
+namespace {
+
+/**
+ * Key of a record in the merit-ordered part of the index. Merits are stored
+ * inverted and big-endian so a forward iteration yields the best gaps first.
+ */
+struct GapMeritKey {
+    char key;
+    uint64_t nMerit;
+    uint256 hash;
+
+    GapMeritKey() : key(DB_GAP_MERIT), nMerit(0) {}
+    GapMeritKey(uint64_t nMeritIn, const uint256& hashIn) : key(DB_GAP_MERIT), nMerit(nMeritIn), hash(hashIn) {}
+
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        s << key;
+        ser_writedata64be(s, ~nMerit);
+        s << hash;
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        s >> key;
+        nMerit = ~ser_readdata64be(s);
+        s >> hash;
+    }
+};
+
+}
+
+CGapIndex::CGapIndex(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "gapindex", nCacheSize, fMemory, fWipe), fSynced(false)
+{
+}
+
+CGapRecord CGapIndex::MakeRecord(const CBlock& block, const CBlockIndex* pindex)
+{
+    CGapRecord record;
+
+    uint256 hash = block.GetHash();
+    std::vector<uint8_t> vHash(hash.begin(), hash.end());
+    PoW pow(&vHash, block.nShift, &block.nAdd, block.nDifficulty);
+
+    record.hashBlock = hash;
+    record.nHeight   = pindex->nHeight;
+    record.nTime     = block.GetBlockTime();
+    record.nMerit    = pow.merit();
+    record.nGapLen   = pow.gap_len();
+    record.nShift    = block.nShift;
+    record.vAdd.assign(block.nAdd.begin(), block.nAdd.end());
+    pow.get_gap(&record.vGapStart, &record.vGapEnd);
+
+    if (!block.vtx.empty() && !block.vtx[0]->vout.empty()) {
+        record.txoutCoinbase = block.vtx[0]->vout[0];
+        record.nCoinbaseOutputs = block.vtx[0]->vout.size();
+    }
+    return record;
+}
+
+uint256 CGapIndex::ReadBestBlock() const
+{
+    uint256 hashBest;
+    if (!db.Read(DB_BEST_BLOCK, hashBest))
+        return uint256();
+    return hashBest;
+}
+
+bool CGapIndex::WriteRecord(const CGapRecord& record)
+{
+    CDBBatch batch(db);
+    batch.Write(GapMeritKey(record.nMerit, record.hashBlock), record);
+    batch.Write(std::make_pair(DB_GAP_BLOCK, record.hashBlock), record.nMerit);
+    batch.Write(DB_BEST_BLOCK, record.hashBlock);
+    return db.WriteBatch(batch);
+}
+
+bool CGapIndex::EraseRecords(const std::vector<uint256>& vHashes, const uint256& hashBest)
+{
+    CDBBatch batch(db);
+    for (const uint256& hash : vHashes) {
+        uint64_t nMerit;
+        if (!db.Read(std::make_pair(DB_GAP_BLOCK, hash), nMerit))
+            continue;
+        batch.Erase(GapMeritKey(nMerit, hash));
+        batch.Erase(std::make_pair(DB_GAP_BLOCK, hash));
+    }
+    // Blocks off the indexed chain leave its tip where it is
+    if (std::find(vHashes.begin(), vHashes.end(), ReadBestBlock()) != vHashes.end())
+        batch.Write(DB_BEST_BLOCK, hashBest);
+    return db.WriteBatch(batch);
+}
+
+bool CGapIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    return WriteRecord(MakeRecord(block, pindex));
+}
+
+bool CGapIndex::EraseBlock(const uint256& hash, const uint256& hashBest)
+{
+    return EraseRecords(std::vector<uint256>(1, hash), hashBest);
+}
+
+void CGapIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted)
+{
+    if (!fSynced)
+        return;
+
+    // Sync() may already have recorded blocks connected while it was catching up
+    if (db.Exists(std::make_pair(DB_GAP_BLOCK, pindex->GetBlockHash())))
+        return;
+
+    if (!WriteBlock(*block, pindex))
+        LogPrintf("%s: failed to write block %s to the gap index\n", __func__, pindex->GetBlockHash().ToString());
+}
+
+void CGapIndex::BlockDisconnected(const std::shared_ptr<const CBlock>& block)
+{
+    if (!fSynced)
+        return;
+
+    if (!EraseBlock(block->GetHash(), block->hashPrevBlock))
+        LogPrintf("%s: failed to erase block %s from the gap index\n", __func__, block->GetHash().ToString());
+}
+
+void CGapIndex::Sync()
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    const CBlockIndex* pindex = nullptr;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator mi = mapBlockIndex.find(ReadBestBlock());
+        if (mi != mapBlockIndex.end())
+            pindex = mi->second;
+    }
+
+    int64_t nLastLog = GetTime();
+    while (true) {
+        boost::this_thread::interruption_point();
+
+        std::vector<uint256> vStale;
+        const CBlockIndex* pindexNext = nullptr;
+        {
+            LOCK(cs_main);
+            // Roll back blocks a reorg disconnected before the callbacks took over
+            while (pindex && !chainActive.Contains(pindex)) {
+                vStale.push_back(pindex->GetBlockHash());
+                pindex = pindex->pprev;
+            }
+            if (vStale.empty()) {
+                pindexNext = pindex ? chainActive.Next(pindex) : chainActive.Genesis();
+                if (!pindexNext) {
+                    // Caught up: from here on BlockConnected/BlockDisconnected keep us in step
+                    fSynced = true;
+                    break;
+                }
+            }
+        }
+
+        if (!vStale.empty()) {
+            if (!EraseRecords(vStale, pindex ? pindex->GetBlockHash() : uint256())) {
+                LogPrintf("%s: failed to roll back the gap index\n", __func__);
+                return;
+            }
+            continue;
+        }
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindexNext, consensusParams, false)) {
+            LogPrintf("%s: failed to read block %s from disk\n", __func__, pindexNext->GetBlockHash().ToString());
+            return;
+        }
+        if (!WriteBlock(block, pindexNext)) {
+            LogPrintf("%s: failed to write block %s to the gap index\n", __func__, pindexNext->GetBlockHash().ToString());
+            return;
+        }
+        pindex = pindexNext;
+
+        if (GetTime() - nLastLog > 30) {
+            LogPrintf("Syncing gap index with block chain from height %d\n", pindex->nHeight);
+            nLastLog = GetTime();
+        }
+    }
+
+    LogPrintf("%s: gap index is synced at height %d\n", __func__, pindex ? pindex->nHeight : -1);
+}
+
+bool CGapIndex::FindRecords(uint64_t nMinMerit, uint64_t nMaxMerit, size_t nMaxCount, std::vector<CGapRecord>& vRecords)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+
+    pcursor->Seek(GapMeritKey(nMaxMerit, uint256()));
+
+    while (pcursor->Valid() && vRecords.size() < nMaxCount) {
+        GapMeritKey key;
+        if (!pcursor->GetKey(key) || key.key != DB_GAP_MERIT || key.nMerit < nMinMerit)
+            break;
+
+        CGapRecord record;
+        if (!pcursor->GetValue(record))
+            return error("%s: failed to read value", __func__);
+        vRecords.push_back(record);
+        pcursor->Next();
+    }
+    return true;
+}
+
+void ThreadGapIndexSync()
+{
+    RenameThread("gapcoin-gapindex");
+    if (g_gapindex)
+        g_gapindex->Sync();
+}
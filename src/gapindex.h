@@ -0,0 +1,138 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_GAPINDEX_H
+#define BITCOIN_GAPINDEX_H
+
+#include <dbwrapper.h>
+#include <primitives/transaction.h>
+#include <serialize.h>
+#include <uint256.h>
+#include <validationinterface.h>
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+
+//! -gapindex default
+static const bool DEFAULT_GAPINDEX = false;
+//! Max memory allocated to the gap index database cache (MiB)
+static const int64_t nMaxGapIndexDBCache = 8;
+
+/** The prime gap proven by a block on the active chain, as stored in the gap index */
+struct CGapRecord
+{
+    uint256 hashBlock;
+    int nHeight;
+    int64_t nTime;
+    uint64_t nMerit;
+    uint64_t nGapLen;
+    uint16_t nShift;
+    std::vector<unsigned char> vAdd;
+    std::vector<unsigned char> vGapStart;
+    std::vector<unsigned char> vGapEnd;
+    //! First coinbase output and the number of coinbase outputs, for the miner address
+    CTxOut txoutCoinbase;
+    uint32_t nCoinbaseOutputs;
+
+    CGapRecord()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        hashBlock.SetNull();
+        nHeight = 0;
+        nTime = 0;
+        nMerit = 0;
+        nGapLen = 0;
+        nShift = 0;
+        vAdd.clear();
+        vGapStart.clear();
+        vGapEnd.clear();
+        txoutCoinbase.SetNull();
+        nCoinbaseOutputs = 0;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashBlock);
+        READWRITE(VARINT(nHeight));
+        READWRITE(nTime);
+        READWRITE(nMerit);
+        READWRITE(VARINT(nGapLen));
+        READWRITE(nShift);
+        READWRITE(vAdd);
+        READWRITE(vGapStart);
+        READWRITE(vGapEnd);
+        READWRITE(txoutCoinbase);
+        READWRITE(VARINT(nCoinbaseOutputs));
+    }
+};
+
+/**
+ * Optional index of the prime gaps found on the active chain (-gapindex),
+ * keyed by merit so listbestprimes and listprimerecords can answer with a
+ * range scan instead of re-deriving every gap from the block index.
+ *
+ * The index follows chainActive through BlockConnected/BlockDisconnected
+ * once it has caught up with the tip; until then Sync() fills it in from
+ * the blocks on disk without holding cs_main for the whole walk.
+ */
+class CGapIndex final : public CValidationInterface
+{
+private:
+    CDBWrapper db;
+
+    //! Whether the index has caught up with chainActive and follows validation callbacks
+    std::atomic<bool> fSynced;
+
+    bool WriteRecord(const CGapRecord& record);
+    bool EraseRecords(const std::vector<uint256>& vHashes, const uint256& hashBest);
+
+protected:
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block) override;
+
+public:
+    explicit CGapIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    CGapIndex(const CGapIndex&) = delete;
+    CGapIndex& operator=(const CGapIndex&) = delete;
+
+    /** Build the record for a block; only the header and the coinbase are used */
+    static CGapRecord MakeRecord(const CBlock& block, const CBlockIndex* pindex);
+
+    /** Add a block to the index, replacing any record already stored for it */
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex);
+    /** Remove a block from the index; if it was the indexed tip, hashBest becomes the tip */
+    bool EraseBlock(const uint256& hash, const uint256& hashBest);
+    /** The last block of the chain the index holds, null if it is empty */
+    uint256 ReadBestBlock() const;
+
+    /** Catch up with chainActive, rolling back blocks that were reorganized away. Interruptible. */
+    void Sync();
+    bool IsSynced() const { return fSynced; }
+
+    /**
+     * Collect up to nMaxCount records with nMinMerit <= merit <= nMaxMerit
+     * (merits in the PoWUtils fixed-point format), best merit first.
+     */
+    bool FindRecords(uint64_t nMinMerit, uint64_t nMaxMerit, size_t nMaxCount, std::vector<CGapRecord>& vRecords);
+};
+
+/** The global gap index, used by the prime gap RPCs. May be null. */
+extern std::unique_ptr<CGapIndex> g_gapindex;
+
+/** Entry point of the thread catching the gap index up at startup */
+void ThreadGapIndexSync();
+
+#endif // BITCOIN_GAPINDEX_H
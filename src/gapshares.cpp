@@ -0,0 +1,114 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gapshares.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <hash.h>
+#include <pow.h>
+#include <sync.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <exception>
+#include <system_error>
+#include <thread>
+
+CGapShareValidator::CGapShareValidator() : filterSeen(SHARE_FILTER_ELEMENTS, 0.000001)
+{
+}
+
+uint256 CGapShareValidator::ShareKey(const CBlockHeader& header)
+{
+    // Zeros at the most significant end leave the adder the same, so an
+    // adder padded with them is the same gap and has to get the same key
+    std::vector<unsigned char> vAdd(header.nAdd);
+    while (!vAdd.empty() && vAdd.back() == 0)
+        vAdd.pop_back();
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << header.GetHash() << header.nShift << vAdd;
+    return ss.GetHash();
+}
+
+std::vector<CGapShareResult> CGapShareValidator::Validate(const std::vector<CGapShare>& vShares, int nThreads)
+{
+    std::vector<CGapShareResult> vResults(vShares.size());
+    std::vector<size_t> vCheck;
+    {
+        // Resubmissions are turned away up front, also within the batch
+        std::lock_guard<std::mutex> lock(cs);
+        for (size_t i = 0; i < vShares.size(); i++) {
+            const CBlockHeader& header = vShares[i].header;
+            CGapShareResult& result = vResults[i];
+            result.hash = header.GetHash();
+            if (header.nShift > MAX_SHARE_SHIFT) {
+                result.strReject = "high-shift";
+                continue;
+            }
+            const uint256 key = ShareKey(header);
+            if (filterSeen.contains(key)) {
+                result.fDuplicate = true;
+                result.strReject = "duplicate";
+                continue;
+            }
+            filterSeen.insert(key);
+            vCheck.push_back(i);
+        }
+    }
+
+    nThreads = std::max<int>(1, std::min<size_t>(nThreads, vCheck.size() / MIN_SHARES_PER_THREAD));
+    // An exception is passed on to the caller once all slices are done,
+    // instead of escaping a thread
+    std::vector<std::exception_ptr> vErrors(nThreads);
+    auto check = [&](int t) {
+        try {
+            for (size_t n = vCheck.size() * t / nThreads; n < vCheck.size() * (t + 1) / nThreads; n++) {
+                const CGapShare& share = vShares[vCheck[n]];
+                CGapShareResult& result = vResults[vCheck[n]];
+                result.fValid = CheckShareProofOfWork(result.hash, share.header.nShift, share.header.nAdd, share.nShareDifficulty, result.nMerit);
+                if (!result.fValid)
+                    result.strReject = "low-merit";
+            }
+        } catch (...) {
+            vErrors[t] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> vThreads;
+    for (int t = 1; t < nThreads; t++) {
+        try {
+            vThreads.emplace_back(check, t);
+        } catch (const std::system_error&) {
+            // Out of threads, so this slice is checked here
+            check(t);
+        }
+    }
+    check(0);
+    for (std::thread& thread : vThreads)
+        thread.join();
+    for (const std::exception_ptr& error : vErrors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    // Only gaps that reach the difficulty in their header can be blocks
+    for (size_t i : vCheck) {
+        const CBlockHeader& header = vShares[i].header;
+        CGapShareResult& result = vResults[i];
+        if (!result.fValid || header.nDifficulty == 0 || result.nMerit < header.nDifficulty)
+            continue;
+        LOCK(cs_main);
+        const CBlockIndex* pindexTip = chainActive.Tip();
+        result.fBlock = pindexTip && header.hashPrevBlock == pindexTip->GetBlockHash() &&
+                        header.nDifficulty >= GetNextWorkRequired(pindexTip, &header, Params().GetConsensus());
+    }
+    return vResults;
+}
+
+CGapShareValidator& GetGapShareValidator()
+{
+    // Not a global: the filter draws on the randomizer when it is created
+    static CGapShareValidator validator;
+    return validator;
+}
@@ -0,0 +1,67 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_GAPSHARES_H
+#define BITCOIN_GAPSHARES_H
+
+#include <bloom.h>
+#include <primitives/block.h>
+#include <uint256.h>
+
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** Shares remembered to turn away resubmissions */
+static const unsigned int SHARE_FILTER_ELEMENTS = 1000000;
+/** Largest nShift accepted in a share, bounding the cost of one check */
+static const uint16_t MAX_SHARE_SHIFT = 1024;
+/** Shares checked per validation thread at least */
+static const size_t MIN_SHARES_PER_THREAD = 8;
+
+/** A gap submitted to a pool: a header with its nShift and nAdd, and the difficulty it has to reach */
+struct CGapShare
+{
+    CBlockHeader header;
+    uint64_t nShareDifficulty;
+};
+
+struct CGapShareResult
+{
+    uint256 hash;
+    bool fValid = false;
+    //! The share was seen before; it is not checked again
+    bool fDuplicate = false;
+    //! The gap also meets the network difficulty on top of the active chain
+    bool fBlock = false;
+    uint64_t nMerit = 0;
+    std::string strReject;
+};
+
+/**
+ * Validates pool shares in parallel batches. Only shares whose gap also
+ * reaches the difficulty in their header are checked against the chain, so
+ * the others never take cs_main.
+ */
+class CGapShareValidator
+{
+private:
+    std::mutex cs;
+    CRollingBloomFilter filterSeen;
+
+    /** Hash identifying a share: its header hash, nShift and the value of nAdd */
+    static uint256 ShareKey(const CBlockHeader& header);
+
+public:
+    CGapShareValidator();
+
+    /** Check the shares on nThreads threads. Rethrows an exception thrown by a check, once all are done. */
+    std::vector<CGapShareResult> Validate(const std::vector<CGapShare>& vShares, int nThreads);
+};
+
+/** The validator used by the validateshares RPC, created on first use */
+CGapShareValidator& GetGapShareValidator();
+
+#endif // BITCOIN_GAPSHARES_H
@@ -0,0 +1,229 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gapsieve.h>
+
+#include <arith_uint256.h>
+#include <utiltime.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string.h>
+
+CGapSieve::CGapSieve(PoWProcessor* pprocessorIn, uint64_t nPrimes, uint64_t nSieveSize) :
+    pprocessor(pprocessorIn), nBitsUsed(0), nTests(0), nPrimesFound(0), dPrimesPerSec(0), dTestsPerSec(0)
+{
+    // The first nPrimes odd primes, from a plain sieve up to a bound on the
+    // (nPrimes + 1)th prime
+    double n = nPrimes + 1;
+    uint64_t nLimit = n < 6 ? 15 : (uint64_t)(n * (std::log(n) + std::log(std::log(n)))) + 1;
+    std::vector<bool> vComposite(nLimit / 2 + 1, false);
+    vPrimes.reserve(nPrimes);
+    for (uint64_t i = 1; i < vComposite.size() && vPrimes.size() < nPrimes; i++) {
+        if (vComposite[i])
+            continue;
+        uint64_t p = 2 * i + 1;
+        vPrimes.push_back(p);
+        for (uint64_t j = p * p / 2; j < vComposite.size(); j += p)
+            vComposite[j] = true;
+    }
+    nFirstLarge = std::lower_bound(vPrimes.begin(), vPrimes.end(), GAPSIEVE_SEGMENT_BITS) - vPrimes.begin();
+
+    // One bit per odd candidate, whole words, offsets small enough for mpz_add_ui
+    nBits = std::min<uint64_t>(nSieveSize / 2, 1ULL << 31) & ~63ULL;
+    vBits.assign(nBits / 64, 0);
+
+    uint64_t nWheel = 1;
+    for (size_t i = 0; i < std::min<size_t>(GAPSIEVE_WHEEL_PRIMES, vPrimes.size()); i++)
+        nWheel *= vPrimes[i];
+    vWheel.assign(nWheel, 0);
+}
+
+uint64_t CGapSieve::FirstMultiple(uint64_t nStartMod, uint64_t nPrime)
+{
+    // start + 2 * i + 1 = 0 (mod p)  <=>  i = (p - start - 1) / 2 (mod p)
+    uint64_t nHalf = (nPrime + 1) / 2;
+    return ((2 * nPrime - nStartMod - 1) % nPrime) * nHalf % nPrime;
+}
+
+void CGapSieve::Sieve(const uint256& hash, uint16_t nShift, bool fSegmented)
+{
+    // Every adder has to stay below 2^nShift
+    nBitsUsed = nShift >= 32 ? nBits : std::min<uint64_t>(nBits, (1ULL << nShift) / 2 & ~63ULL);
+
+    mpz_t mpzStart;
+    mpz_init(mpzStart);
+    mpz_import(mpzStart, hash.size(), -1, 1, 0, 0, hash.begin());
+    mpz_mul_2exp(mpzStart, mpzStart, nShift);
+
+    std::vector<uint64_t> vFirst(vPrimes.size());
+    for (size_t i = 0; i < vPrimes.size(); i++)
+        vFirst[i] = FirstMultiple(mpz_fdiv_ui(mpzStart, vPrimes[i]), vPrimes[i]);
+    mpz_clear(mpzStart);
+
+    if (!fSegmented) {
+        std::fill(vBits.begin(), vBits.end(), 0);
+        for (size_t i = 0; i < vPrimes.size(); i++)
+            for (uint64_t j = vFirst[i]; j < nBitsUsed; j += vPrimes[i])
+                vBits[j >> 6] |= 1ULL << (j & 63);
+        return;
+    }
+
+    // The wheel repeats every product of its primes in bits, and so every
+    // as many words
+    const size_t nWheelPrimes = std::min<size_t>(GAPSIEVE_WHEEL_PRIMES, vPrimes.size());
+    const uint64_t nWheelBits = vWheel.size() * 64;
+    std::fill(vWheel.begin(), vWheel.end(), 0);
+    for (size_t i = 0; i < nWheelPrimes; i++)
+        for (uint64_t j = vFirst[i]; j < nWheelBits; j += vPrimes[i])
+            vWheel[j >> 6] |= 1ULL << (j & 63);
+
+    vNext.assign(vFirst.begin() + nWheelPrimes, vFirst.begin() + std::max(nWheelPrimes, nFirstLarge));
+
+    const uint64_t nSegments = (nBitsUsed + GAPSIEVE_SEGMENT_BITS - 1) / GAPSIEVE_SEGMENT_BITS;
+    if (vBuckets.size() < nSegments)
+        vBuckets.resize(nSegments);
+    for (std::vector<BucketEntry>& bucket : vBuckets)
+        bucket.clear();
+    for (size_t i = std::max(nWheelPrimes, nFirstLarge); i < vPrimes.size(); i++) {
+        if (vFirst[i] < nBitsUsed)
+            vBuckets[vFirst[i] / GAPSIEVE_SEGMENT_BITS].push_back(BucketEntry{vPrimes[i], (uint32_t)vFirst[i]});
+    }
+
+    for (uint64_t nSegment = 0; nSegment < nSegments; nSegment++) {
+        const uint64_t nLow = nSegment * GAPSIEVE_SEGMENT_BITS;
+        const uint64_t nHigh = std::min<uint64_t>(nLow + GAPSIEVE_SEGMENT_BITS, nBitsUsed);
+
+        // Small primes: copy the wheel in, wrapping around at its end
+        uint64_t* pWord = &vBits[nLow / 64];
+        uint64_t nWords = (nHigh - nLow) / 64;
+        size_t nWheelPos = (nLow / 64) % vWheel.size();
+        while (nWords > 0) {
+            size_t nCopy = std::min<uint64_t>(nWords, vWheel.size() - nWheelPos);
+            memcpy(pWord, &vWheel[nWheelPos], nCopy * sizeof(uint64_t));
+            pWord += nCopy;
+            nWords -= nCopy;
+            nWheelPos = 0;
+        }
+
+        // Primes below the segment size hit it at least once
+        for (size_t i = 0; i < vNext.size(); i++) {
+            const uint64_t nPrime = vPrimes[nWheelPrimes + i];
+            uint64_t j = vNext[i];
+            for (; j < nHigh; j += nPrime)
+                vBits[j >> 6] |= 1ULL << (j & 63);
+            vNext[i] = j;
+        }
+
+        // Larger ones at most once, then move on to the bucket of their next hit
+        std::vector<BucketEntry>& bucket = vBuckets[nSegment];
+        for (const BucketEntry& entry : bucket) {
+            vBits[entry.nBit >> 6] |= 1ULL << (entry.nBit & 63);
+            uint64_t nNext = (uint64_t)entry.nBit + entry.nPrime;
+            if (nNext < nBitsUsed)
+                vBuckets[nNext / GAPSIEVE_SEGMENT_BITS].push_back(BucketEntry{entry.nPrime, (uint32_t)nNext});
+        }
+        bucket.clear();
+    }
+}
+
+uint64_t CGapSieve::FindPrime(const mpz_t mpzStart, uint64_t nOffset, uint64_t nEnd, mpz_t* pCandidates)
+{
+    const int64_t nStep = nEnd > nOffset ? 2 : -2;
+    const size_t nBatch = FermatBatchSize();
+    const uint64_t nRange = GetSieveRange();
+    uint64_t vOffsets[FERMAT_MAX_BATCH_SIZE];
+    bool vPrime[FERMAT_MAX_BATCH_SIZE];
+
+    while (nOffset != nEnd) {
+        size_t nCount = 0;
+        for (; nCount < nBatch && nOffset != nEnd; nOffset += nStep) {
+            if (nOffset < nRange && IsComposite(nOffset))
+                continue;
+            vOffsets[nCount] = nOffset;
+            mpz_add_ui(pCandidates[nCount], mpzStart, (unsigned long)nOffset);
+            nCount++;
+        }
+        if (nCount == 0)
+            break;
+
+        FermatTest(pCandidates, nCount, vPrime);
+        nTests += nCount;
+        size_t nFirst = nCount;
+        for (size_t i = 0; i < nCount; i++) {
+            if (vPrime[i]) {
+                nPrimesFound++;
+                nFirst = std::min(nFirst, i);
+            }
+        }
+        if (nFirst < nCount)
+            return vOffsets[nFirst];
+    }
+    return 0;
+}
+
+void CGapSieve::Run(const uint256& hash, uint16_t nShift, uint64_t nDifficulty)
+{
+    int64_t nStart = GetTimeMicros();
+    nTests = 0;
+    nPrimesFound = 0;
+
+    Sieve(hash, nShift);
+    const uint64_t nRange = GetSieveRange();
+
+    // Shortest gap with a merit of nDifficulty at this size
+    double dLogStart = std::log(UintToArith256(hash).getdouble()) + nShift * std::log(2.0);
+    double dLength = std::ceil((double)nDifficulty / (1ULL << 48) * dLogStart);
+    const uint64_t nLength = dLength < nRange ? std::max<uint64_t>((uint64_t)dLength, 2) : nRange;
+
+    std::vector<uint8_t> vHash(hash.begin(), hash.end());
+    mpz_t mpzStart, vCandidates[FERMAT_MAX_BATCH_SIZE];
+    mpz_init(mpzStart);
+    for (mpz_t& mpz : vCandidates)
+        mpz_init(mpz);
+    mpz_import(mpzStart, hash.size(), -1, 1, 0, 0, hash.begin());
+    mpz_mul_2exp(mpzStart, mpzStart, nShift);
+
+    // The odd offsets below nRange, which is even
+    uint64_t nPrime = FindPrime(mpzStart, 1, nRange + 1, vCandidates);
+    if (nPrime == 0)
+        nPrime = nRange;
+
+    // Everything in (nPrime, nCleared] is known to be composite
+    uint64_t nCleared = nPrime;
+    while (nPrime + nLength < nRange) {
+        // Any prime before the end of a long enough gap spoils it, and the
+        // last one found is where the next gap may start
+        uint64_t nTop = (nPrime + nLength - 1) | 1;
+        if (nTop > nPrime + nLength - 1)
+            nTop -= 2;
+        uint64_t nFound = nTop > nCleared ? FindPrime(mpzStart, nTop, nCleared, vCandidates) : 0;
+        if (nFound) {
+            nCleared = std::max(nFound, nTop);
+            nPrime = nFound;
+            continue;
+        }
+
+        uint64_t nNext = FindPrime(mpzStart, nTop + 2, std::numeric_limits<uint64_t>::max(), vCandidates);
+
+        std::vector<uint8_t> vAdd;
+        for (uint64_t nAdd = nPrime; nAdd != 0; nAdd >>= 8)
+            vAdd.push_back(nAdd & 0xff);
+        PoW pow(&vHash, nShift, &vAdd, nDifficulty);
+        if (pow.valid() && pprocessor && !pprocessor->process(&pow))
+            break;
+
+        nPrime = nNext;
+        nCleared = nNext;
+    }
+
+    mpz_clear(mpzStart);
+    for (mpz_t& mpz : vCandidates)
+        mpz_clear(mpz);
+
+    double dSeconds = std::max<int64_t>(GetTimeMicros() - nStart, 1) / 1000000.0;
+    dPrimesPerSec = nPrimesFound / dSeconds;
+    dTestsPerSec = nTests / dSeconds;
+}
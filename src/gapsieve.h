@@ -0,0 +1,105 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_GAPSIEVE_H
+#define BITCOIN_GAPSIEVE_H
+
+#include <fermat.h>
+#include <uint256.h>
+#include <PoWCore/src/PoW.h>
+#include <PoWCore/src/PoWProcessor.h>
+
+#include <stdint.h>
+#include <vector>
+
+/** Candidates per sieve segment, 32 KiB of bits so a segment stays in L1 */
+static const uint32_t GAPSIEVE_SEGMENT_BITS = 32 * 1024 * 8;
+/** Primes whose multiples are copied in from the pre-sieved wheel pattern */
+static const unsigned int GAPSIEVE_WHEEL_PRIMES = 4;
+
+/**
+ * Segmented sieve for the gap miner (-gensegmented), an alternative to
+ * PoWCore's Sieve that keeps its working set in cache.
+ *
+ * For start = hash * 2^nShift it marks the composites among the odd numbers
+ * start + [1, nSieveSize), one segment of GAPSIEVE_SEGMENT_BITS candidates at
+ * a time. The multiples of 3, 5, 7 and 11 are copied in from a pre-sieved
+ * wheel pattern, the primes below the segment size cross off their multiples
+ * directly, and the larger primes, which hit a segment at most once, wait in
+ * a bucket for the segment of their next multiple.
+ *
+ * Run() then looks for gaps in the result the way PoWCore does: from each
+ * prime it Fermat tests the candidates backwards from where a gap of the
+ * required length would end, and jumps to the first prime found. The sieve
+ * survivors are tested FermatBatchSize() at a time, so a vector backend
+ * finds the next prime in one pass over as many candidates.
+ */
+class CGapSieve
+{
+public:
+    CGapSieve(PoWProcessor* pprocessorIn, uint64_t nPrimes, uint64_t nSieveSize);
+
+    /**
+     * Sieve one hash and hand every gap that meets nDifficulty to the
+     * processor, until it returns false or the sieve range is used up.
+     */
+    void Run(const uint256& hash, uint16_t nShift, uint64_t nDifficulty);
+
+    /**
+     * Mark the composites for start = hash * 2^nShift. fSegmented = false
+     * crosses off prime by prime over the whole array instead, which gives
+     * the same result.
+     */
+    void Sieve(const uint256& hash, uint16_t nShift, bool fSegmented = true);
+    /** Whether start + nOffset, for an odd nOffset sieved by the last Sieve(), has a small factor */
+    bool IsComposite(uint64_t nOffset) const
+    {
+        uint64_t nBit = nOffset >> 1;
+        return (vBits[nBit >> 6] >> (nBit & 63)) & 1;
+    }
+    /** Odd offsets covered by the last Sieve() */
+    uint64_t GetSieveRange() const { return nBitsUsed << 1; }
+
+    void SetProcessor(PoWProcessor* pprocessorIn) { pprocessor = pprocessorIn; }
+    /** Rates of the last Run(), as reported by PoWCore's Sieve */
+    double PrimesPerSec() const { return dPrimesPerSec; }
+    double TestsPerSec() const { return dTestsPerSec; }
+
+private:
+    /** A prime larger than a segment and the candidate it crosses off next */
+    struct BucketEntry {
+        uint32_t nPrime;
+        uint32_t nBit;
+    };
+
+    PoWProcessor* pprocessor;
+    //! Odd sieving primes, 3 upwards
+    std::vector<uint32_t> vPrimes;
+    //! Index in vPrimes of the first prime sieved by buckets
+    size_t nFirstLarge;
+    //! Composite bits, one per odd candidate
+    std::vector<uint64_t> vBits;
+    uint64_t nBits;
+    uint64_t nBitsUsed;
+    //! Multiples of the wheel primes, GAPSIEVE_WHEEL_PRIMES primes' product words long
+    std::vector<uint64_t> vWheel;
+    //! Next candidate to cross off for each prime below the segment size
+    std::vector<uint64_t> vNext;
+    std::vector<std::vector<BucketEntry>> vBuckets;
+    uint64_t nTests;
+    uint64_t nPrimesFound;
+    double dPrimesPerSec;
+    double dTestsPerSec;
+
+    /** Index of the first odd candidate start + 2 * i + 1 divisible by nPrime */
+    static uint64_t FirstMultiple(uint64_t nStartMod, uint64_t nPrime);
+    /**
+     * First prime among the sieve survivors start + nOffset, stepping by 2
+     * towards nEnd (exclusive), or 0 if there is none. pCandidates is
+     * scratch space for FERMAT_MAX_BATCH_SIZE numbers.
+     */
+    uint64_t FindPrime(const mpz_t mpzStart, uint64_t nOffset, uint64_t nEnd, mpz_t* pCandidates);
+};
+
+#endif // BITCOIN_GAPSIEVE_H
@@ -17,6 +17,7 @@
 #include <crypto/hmac_sha256.h>
 #include <stdio.h>
 
+#include <list>
 #include <memory>
 
 #include <boost/algorithm/string.hpp> // boost::trim
@@ -144,6 +145,98 @@ static bool RPCAuthorized(const std::string& strAuth, std::string& strAuthUserna
     return multiUserAuthorized(strUserPass);
 }
 
+/** A request parked by its method, with the function that drops it again */
+struct HTTPParkedRequest
+{
+    std::shared_ptr<HTTPRequest> req;
+    std::function<bool()> cancel;
+};
+
+/** Seconds between checks for parked requests whose client went away */
+static const int PARKED_REQUEST_CHECK_INTERVAL = 10;
+
+static CCriticalSection cs_parkedRequests;
+static std::list<HTTPParkedRequest> parkedRequests;
+//! Runs CheckParkedRequests on the event thread while any request is parked
+static std::unique_ptr<HTTPEvent> parkedRequestsCheck;
+
+static void ScheduleParkedRequestsCheck()
+{
+    AssertLockHeld(cs_parkedRequests);
+    if (parkedRequestsCheck) {
+        struct timeval tv = {PARKED_REQUEST_CHECK_INTERVAL, 0};
+        parkedRequestsCheck->trigger(&tv);
+    }
+}
+
+/** Drop the parked requests whose client disconnected, before they are resumed */
+static void CheckParkedRequests()
+{
+    LOCK(cs_parkedRequests);
+    for (std::list<HTTPParkedRequest>::iterator it = parkedRequests.begin(); it != parkedRequests.end(); ) {
+        // Requests are taken off the list before they are resumed, so none of these is in use
+        if (it->cancel && !it->req->IsConnected() && it->cancel()) {
+            LogPrint(BCLog::RPC, "Dropping parked request, its client disconnected\n");
+            // The reply goes nowhere, but lets libevent free the request
+            it->req->WriteReply(HTTP_SERVICE_UNAVAILABLE);
+            it = parkedRequests.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (!parkedRequests.empty())
+        ScheduleParkedRequestsCheck();
+}
+
+/**
+ * Execute a single, parsed request and send its reply. A long-poll method may
+ * park the request instead (JSONRPCDeferred): it is then run again from the
+ * work queue once the method resumes it, so waiting holds no worker thread.
+ */
+static bool ExecuteJSONRPC(HTTPRequest* req, const JSONRPCRequest& jreq)
+{
+    try {
+        UniValue result = tableRPC.execute(jreq);
+
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, JSONRPCReply(result, NullUniValue, jreq.id));
+    } catch (const JSONRPCDeferred& deferred) {
+        std::shared_ptr<HTTPRequest> parked(req->Detach());
+        JSONRPCRequest jreqResumed = jreq;
+        jreqResumed.fResumed = true;
+        {
+            // Listed before parking, as the method may resume it right away
+            LOCK(cs_parkedRequests);
+            if (parkedRequests.empty())
+                ScheduleParkedRequestsCheck();
+            parkedRequests.push_back(HTTPParkedRequest{parked, nullptr});
+        }
+        std::function<bool()> cancel = deferred.park([parked, jreqResumed] {
+            {
+                LOCK(cs_parkedRequests);
+                parkedRequests.remove_if([&parked](const HTTPParkedRequest& p) { return p.req == parked; });
+            }
+            if (!IsRPCRunning()) {
+                JSONErrorReply(parked.get(), JSONRPCError(RPC_CLIENT_NOT_CONNECTED, "Shutting down"), jreqResumed.id);
+            } else if (!QueueHTTPWork([parked, jreqResumed] { ExecuteJSONRPC(parked.get(), jreqResumed); })) {
+                parked->WriteReply(HTTP_INTERNAL_SERVER_ERROR, "Work queue depth exceeded");
+            }
+        });
+        LOCK(cs_parkedRequests);
+        for (HTTPParkedRequest& p : parkedRequests) {
+            if (p.req == parked)
+                p.cancel = cancel;
+        }
+    } catch (const UniValue& objError) {
+        JSONErrorReply(req, objError, jreq.id);
+        return false;
+    } catch (const std::exception& e) {
+        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        return false;
+    }
+    return true;
+}
+
 static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 {
     // JSONRPC handles only POST
@@ -182,21 +275,18 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         // Set the URI
         jreq.URI = req->GetURI();
 
-        std::string strReply;
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
-
-            UniValue result = tableRPC.execute(jreq);
-
-            // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            // Batches are answered as a whole, so only a singleton can be parked
+            jreq.fCanDefer = true;
+            return ExecuteJSONRPC(req, jreq);
+        }
 
         // array of requests
-        } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(jreq, valRequest.get_array());
-        else
+        if (!valRequest.isArray())
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
+        std::string strReply = JSONRPCExecBatch(jreq, valRequest.get_array());
 
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strReply);
@@ -242,6 +332,10 @@ bool StartHTTPRPC()
     assert(EventBase());
     httpRPCTimerInterface = MakeUnique<HTTPRPCTimerInterface>(EventBase());
     RPCSetTimerInterface(httpRPCTimerInterface.get());
+    {
+        LOCK(cs_parkedRequests);
+        parkedRequestsCheck.reset(new HTTPEvent(EventBase(), false, CheckParkedRequests));
+    }
     return true;
 }
 
@@ -258,4 +352,7 @@ void StopHTTPRPC()
         RPCUnsetTimerInterface(httpRPCTimerInterface.get());
         httpRPCTimerInterface.reset();
     }
+    // Parked requests are answered when RPC stops and resumes them all
+    LOCK(cs_parkedRequests);
+    parkedRequestsCheck.reset();
 }
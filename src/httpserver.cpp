@@ -61,6 +61,22 @@ private:
     HTTPRequestHandler func;
 };
 
+/** Closure running a plain function, for work queued outside a request callback */
+class HTTPFunctionItem final : public HTTPClosure
+{
+public:
+    explicit HTTPFunctionItem(const std::function<void(void)>& _func): func(_func)
+    {
+    }
+    void operator()() override
+    {
+        func();
+    }
+
+private:
+    std::function<void(void)> func;
+};
+
 /** Simple work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
  */
@@ -497,6 +513,19 @@ struct event_base* EventBase()
     return eventBase;
 }
 
+bool QueueHTTPWork(const std::function<void(void)>& func)
+{
+    if (!workQueue)
+        return false;
+    std::unique_ptr<HTTPFunctionItem> item(new HTTPFunctionItem(func));
+    if (!workQueue->Enqueue(item.get())) {
+        LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
+        return false;
+    }
+    item.release(); /* queue took ownership */
+    return true;
+}
+
 static void httpevent_callback_fn(evutil_socket_t, short, void* data)
 {
     // Static handler: simply call inner handler
@@ -607,6 +636,39 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = nullptr; // transferred back to main thread
 }
 
+std::unique_ptr<HTTPRequest> HTTPRequest::Detach()
+{
+    assert(!replySent && req);
+    std::unique_ptr<HTTPRequest> detached(new HTTPRequest(req));
+    replySent = true;
+    req = nullptr;
+    return detached;
+}
+
+bool HTTPRequest::IsConnected()
+{
+    assert(req);
+    // Without a connection libevent saw the client go away itself
+    evhttp_connection* conn = evhttp_request_get_connection(req);
+    bufferevent* bev = conn ? evhttp_connection_get_bufferevent(conn) : nullptr;
+    if (!bev)
+        return false;
+    // Reading may be disabled (see http_request_cb), so look at the socket
+    // directly: an orderly close reads as end of file
+    evutil_socket_t fd = bufferevent_getfd(bev);
+    if (fd == -1)
+        return false;
+    char ch;
+    int nBytes = recv(fd, &ch, 1, MSG_PEEK);
+    if (nBytes == 0)
+        return false;
+    if (nBytes < 0) {
+        int nErr = WSAGetLastError();
+        return nErr == WSAEWOULDBLOCK || nErr == WSAEINTR;
+    }
+    return true;
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
@@ -8,6 +8,7 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <memory>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
@@ -51,6 +52,12 @@ void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
  */
 struct event_base* EventBase();
 
+/** Run func on an HTTP worker thread, such as a parked long poll that is
+ * resumed. Like any request it counts against the -rpcworkqueue limit;
+ * returns false when the queue is full or the server is not running.
+ */
+bool QueueHTTPWork(const std::function<void(void)>& func);
+
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
  */
@@ -114,6 +121,19 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Hand the request over to a new owner that replies later, from outside
+     * the handler. This object is left as if the reply had been sent.
+     */
+    std::unique_ptr<HTTPRequest> Detach();
+
+    /**
+     * Whether the client is still connected, for a detached request that
+     * waits for its reply. Only call this from the HTTP event thread, with no
+     * worker using the request.
+     */
+    bool IsConnected();
 };
 
 /** Event handler closure.
@@ -12,12 +12,17 @@
 
 #include <addrman.h>
 #include <amount.h>
+#include <base58.h>
+#include <bootstrap.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
+#include <coinsprefetch.h>
 #include <compat/sanity.h>
 #include <consensus/validation.h>
+#include <fermat.h>
 #include <fs.h>
+#include <gapindex.h>
 #include <httpserver.h>
 #include <httprpc.h>
 #include <key.h>
@@ -27,6 +32,7 @@
 #include <net.h>
 #include <net_processing.h>
 #include <policy/feerate.h>
+#include <primegaplist.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <rpc/server.h>
@@ -38,18 +44,21 @@
 #include <script/sigcache.h>
 #include <scheduler.h>
 #include <timedata.h>
+#include <triples.h>
 #include <txdb.h>
 #include <txmempool.h>
 #include <torcontrol.h>
 #include <ui_interface.h>
 #include <util.h>
 #include <utilmoneystr.h>
+#include <utilstrencodings.h>
 #include <validationinterface.h>
 #ifdef ENABLE_WALLET
 #include <rpc/mining.h>
 #include <wallet/init.h>
 #endif
 #include <warnings.h>
+#include <workserver.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <memory>
@@ -161,6 +170,9 @@ static std::unique_ptr<ECCVerifyHandle> globalVerifyHandle;
 static boost::thread_group threadGroup;
 static CScheduler scheduler;
 
+//! Number of recent blocks whose proofs of work are re-verified after startup, or -1 for the whole index before it
+static int nCheckIndexPoWDepth = DEFAULT_CHECKINDEXPOW;
+
 void Interrupt()
 {
     InterruptHTTPServer();
@@ -187,6 +199,7 @@ void Shutdown()
     RenameThread("gapcoin-shutoff");
     mempool.AddTransactionsUpdated(1);
     ShutdownRPCMining();
+    StopWorkServer();
     StopHTTPRPC();
     StopREST();
     StopRPC();
@@ -195,6 +208,9 @@ void Shutdown()
     FlushWallets();
 #endif
     GenerateGapcoins(false, 0, Params());
+    StopBootstrapDump();
+    StopTriplesDump();
+    StopCoinsPrefetch();
 
     MapPort(false);
 
@@ -237,6 +253,11 @@ void Shutdown()
     // CValidationInterface callbacks, flush them...
     GetMainSignals().FlushBackgroundCallbacks();
 
+    if (g_gapindex) {
+        UnregisterValidationInterface(g_gapindex.get());
+        g_gapindex.reset();
+    }
+
     // Any future callbacks will be dropped. This should absolutely be safe - if
     // missing a callback results in an unrecoverable situation, unclean shutdown
     // would too. The only reason to do the above flushes is to let the wallet catch
@@ -249,6 +270,7 @@ void Shutdown()
             FlushStateToDisk();
         }
         pcoinsTip.reset();
+        pcoinsflusher.reset();
         pcoinscatcher.reset();
         pcoinsdbview.reset();
         pblocktree.reset();
@@ -321,6 +343,7 @@ static void registerSignalHandler(int signal, void(*handler)(int))
 void OnRPCStarted()
 {
     uiInterface.NotifyBlockTip.connect(&RPCNotifyBlockChange);
+    StartRPCLongPoll();
 }
 
 void OnRPCStopped()
@@ -328,6 +351,7 @@ void OnRPCStopped()
     uiInterface.NotifyBlockTip.disconnect(&RPCNotifyBlockChange);
     RPCNotifyBlockChange(false, nullptr);
     cvBlockChange.notify_all();
+    StopRPCLongPoll();
     LogPrint(BCLog::RPC, "RPC stopped.\n");
 }
 
@@ -361,6 +385,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize));
     }
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-powsummarycache=<n>", strprintf(_("Keep up to <n> megabytes of derived gap data (merit, gap length, gap start) cached on the block index for the block RPCs (default: %u)"), DEFAULT_POWSUMMARY_CACHE));
     if (showDebug)
         strUsage += HelpMessageOpt("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
@@ -373,11 +398,13 @@ std::string HelpMessage(HelpMessageMode mode)
     }
     strUsage += HelpMessageOpt("-persistmempool", strprintf(_("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
-    strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+    strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script and proof of work verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
+    strUsage += HelpMessageOpt("-prefetchthreads=<n>", strprintf(_("Set the number of threads reading the coins spent by a block while it is checked (0 to %d, default: %d)"), MAX_PREFETCH_THREADS, DEFAULT_PREFETCH_THREADS));
+    strUsage += HelpMessageOpt("-primegaplist=<file>", strprintf(_("Prime gap records used by the checkprimegaplist rpc call, relative to the data directory (default: %s)"), DEFAULT_PRIMEGAPLIST_FILE));
     strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
@@ -387,6 +414,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), DEFAULT_TXINDEX));
+    strUsage += HelpMessageOpt("-gapindex", strprintf(_("Maintain an index of prime gaps ordered by merit, used by the listbestprimes and listprimerecords rpc calls (default: %u)"), DEFAULT_GAPINDEX));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open (see the `addnode` RPC command help for more info)"));
@@ -402,6 +430,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-listen", _("Accept connections from outside (default: 1 if no -proxy or -connect)"));
     strUsage += HelpMessageOpt("-listenonion", strprintf(_("Automatically create Tor hidden service (default: %d)"), DEFAULT_LISTEN_ONION));
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
+    strUsage += HelpMessageOpt("-maxpowchecktime=<n>", strprintf(_("Disconnect peers whose invalid headers and blocks take more than <n> milliseconds per minute to verify (default: %u)"), DEFAULT_MAX_POW_CHECK_TIME));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
     strUsage += HelpMessageOpt("-maxtimeadjustment", strprintf(_("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)"), DEFAULT_MAX_TIME_ADJUSTMENT));
@@ -413,6 +442,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), DEFAULT_PROXYRANDOMIZE));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of: %s (default: %s)"), GetSupportedSocketEventsModes(), GetSocketEventsModeName(DEFAULT_SOCKETEVENTS)));
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
@@ -446,6 +476,7 @@ std::string HelpMessage(HelpMessageMode mode)
     {
         strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), DEFAULT_CHECKBLOCKS));
         strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
+        strUsage += HelpMessageOpt("-checkindexpow=<n>", strprintf(_("Re-verify the proofs of work of the last <n> blocks of the block index in the background after startup, or of the whole index during startup with \"all\" (0 = off, default: %u)"), DEFAULT_CHECKINDEXPOW));
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
@@ -507,6 +538,11 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blockmintxfee=<amt>", strprintf(_("Set lowest fee rate (in %s/kB) for transactions to be included in block creation. (default: %s)"), CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)));
     strUsage += HelpMessageOpt("-gen", strprintf(_("Generate coins (default: %u)"), DEFAULT_GENERATE));
     strUsage += HelpMessageOpt("-genproclimit=<n>", strprintf(_("Set the number of threads for coin generation if enabled (-1 = all cores, default: %d)"), DEFAULT_GENERATE_THREADS));
+    strUsage += HelpMessageOpt("-genpin", strprintf(_("Pin coin generation threads to CPUs, spread over NUMA nodes, and keep each thread's sieve on its own node (Linux only, default: %u)"), DEFAULT_GENPIN));
+    strUsage += HelpMessageOpt("-gensegmented", strprintf(_("Sieve in cache-sized segments instead of with PoWCore's sieve when generating coins (default: %u)"), DEFAULT_GENSEGMENTED));
+    strUsage += HelpMessageOpt("-workport=<port>", _("Push work to external miners and accept their solutions on <port> (requires -server and -workaddress, default: disabled)"));
+    strUsage += HelpMessageOpt("-workbind=<addr>", strprintf(_("Bind the work server to the given address (default: %s)"), DEFAULT_WORKBIND));
+    strUsage += HelpMessageOpt("-workaddress=<addr>", _("Pay blocks found through the work server to <addr>"));
     if (showDebug)
         strUsage += HelpMessageOpt("-blockversion=<n>", "Override block version to test forking scenarios");
 
@@ -916,6 +952,8 @@ bool AppInitParameterInteraction()
     if (gArgs.GetArg("-prune", 0)) {
         if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (gArgs.GetBoolArg("-gapindex", DEFAULT_GAPINDEX))
+            return InitError(_("Prune mode is incompatible with -gapindex."));
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -930,7 +968,10 @@ bool AppInitParameterInteraction()
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
     // Trim requested connection counts, to fit into system limitations
+#ifndef USE_POLL
+    // select() cannot watch sockets beyond FD_SETSIZE
     nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
+#endif
     nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1038,6 +1079,12 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    const std::string strCheckIndexPoW = gArgs.GetArg("-checkindexpow", std::to_string(DEFAULT_CHECKINDEXPOW));
+    if (strCheckIndexPoW == "all")
+        nCheckIndexPoWDepth = -1;
+    else if (!ParseInt32(strCheckIndexPoW, &nCheckIndexPoWDepth) || nCheckIndexPoWDepth < 0)
+        return InitError(strprintf(_("Invalid -checkindexpow value: '%s' (expected a block count or \"all\")"), strCheckIndexPoW));
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = gArgs.GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1182,6 +1229,8 @@ bool AppInitSanityChecks()
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string fermat_algo = FermatAutoDetect();
+    LogPrintf("Using the '%s' Fermat test implementation\n", fermat_algo);
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1246,10 +1295,12 @@ bool AppInitMain()
     InitSignatureCache();
     InitScriptExecutionCache();
 
-    LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
+    LogPrintf("Using %u threads for script and proof of work verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i=0; i<nScriptCheckThreads-1; i++)
+        for (int i=0; i<nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadPoWCheck);
+        }
     }
 
     // Start the lightweight task scheduler thread
@@ -1416,15 +1467,25 @@ bool AppInitMain()
     int64_t nBlockTreeDBCache = nTotalCache / 8;
     nBlockTreeDBCache = std::min(nBlockTreeDBCache, (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
     nTotalCache -= nBlockTreeDBCache;
+    int64_t nGapIndexDBCache = 0;
+    if (gArgs.GetBoolArg("-gapindex", DEFAULT_GAPINDEX)) {
+        nGapIndexDBCache = std::min(nTotalCache / 16, nMaxGapIndexDBCache << 20);
+        nTotalCache -= nGapIndexDBCache;
+    }
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
+    nPoWSummaryCacheMax = std::max<int64_t>(0, gArgs.GetArg("-powsummarycache", DEFAULT_POWSUMMARY_CACHE)) << 20;
     int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    if (nGapIndexDBCache > 0) {
+        LogPrintf("* Using %.1fMiB for gap index database\n", nGapIndexDBCache * (1.0 / 1024 / 1024));
+    }
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
+    LogPrintf("* Using up to %.1fMiB for cached block gap data\n", nPoWSummaryCacheMax * (1.0 / 1024 / 1024));
 
     bool fLoaded = false;
     while (!fLoaded && !fRequestShutdown) {
@@ -1438,6 +1499,7 @@ bool AppInitMain()
             try {
                 UnloadBlockIndex();
                 pcoinsTip.reset();
+                pcoinsflusher.reset();
                 pcoinsdbview.reset();
                 pcoinscatcher.reset();
                 // new CBlockTreeDB tries to delete the existing file, which
@@ -1511,7 +1573,8 @@ bool AppInitMain()
                 }
 
                 // The on-disk coinsdb is now in a good state, create the cache
-                pcoinsTip.reset(new CCoinsViewCache(pcoinscatcher.get()));
+                pcoinsflusher.reset(new CCoinsViewFlusher(pcoinscatcher.get()));
+                pcoinsTip.reset(new CCoinsViewCache(pcoinsflusher.get()));
 
                 bool is_coinsview_empty = fReset || fReindexChainState || pcoinsTip->GetBestBlock().IsNull();
                 if (!is_coinsview_empty) {
@@ -1559,6 +1622,15 @@ bool AppInitMain()
                         break;
                     }
                 }
+
+                // -checkindexpow=all: the stored proofs of work are checked before anything relies on them
+                if (nCheckIndexPoWDepth < 0) {
+                    uiInterface.InitMessage(_("Verifying block index..."));
+                    if (!CheckBlockIndexPoW(chainparams, -1, true)) {
+                        strLoadError = _("Corrupted block database detected");
+                        break;
+                    }
+                }
             } catch (const std::exception& e) {
                 LogPrintf("%s\n", e.what());
                 strLoadError = _("Error opening block database");
@@ -1600,6 +1672,16 @@ bool AppInitMain()
         LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
     }
 
+    int nPrefetchThreads = std::min<int>(gArgs.GetArg("-prefetchthreads", DEFAULT_PREFETCH_THREADS), MAX_PREFETCH_THREADS);
+    if (nPrefetchThreads > 0)
+        StartCoinsPrefetch(pcoinsflusher.get(), nPrefetchThreads);
+
+    if (gArgs.GetBoolArg("-gapindex", DEFAULT_GAPINDEX)) {
+        g_gapindex.reset(new CGapIndex(nGapIndexDBCache, false, fReindex));
+        RegisterValidationInterface(g_gapindex.get());
+        threadGroup.create_thread(&ThreadGapIndexSync);
+    }
+
     fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
@@ -1709,6 +1791,13 @@ bool AppInitMain()
     connOptions.nReceiveFloodSize = 1000*gArgs.GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
     connOptions.m_added_nodes = gArgs.GetArgs("-addnode");
 
+    if (gArgs.IsArgSet("-socketevents")) {
+        std::string strSocketEvents = gArgs.GetArg("-socketevents", "");
+        if (!ParseSocketEventsMode(strSocketEvents, connOptions.socketEventsMode)) {
+            return InitError(strprintf(_("Unsupported -socketevents mode '%s' (supported: %s)"), strSocketEvents, GetSupportedSocketEventsModes()));
+        }
+    }
+
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
 
@@ -1754,6 +1843,21 @@ bool AppInitMain()
 
     // ********************************************************* Step 12: finished
 
+    // A reindex verifies every proof as it rebuilds the index; otherwise check
+    // the most recent ones while the node is already serving
+    if (nCheckIndexPoWDepth > 0 && !fReindex)
+        threadGroup.create_thread(boost::bind(&ThreadCheckBlockIndexPoW, nCheckIndexPoWDepth));
+
+    if (gArgs.IsArgSet("-workport")) {
+        if (!gArgs.GetBoolArg("-server", false))
+            return InitError(_("-workport requires -server"));
+        CTxDestination dest = DecodeDestination(gArgs.GetArg("-workaddress", ""));
+        if (!IsValidDestination(dest))
+            return InitError(strprintf(_("Invalid or missing -workaddress: '%s'"), gArgs.GetArg("-workaddress", "")));
+        if (!StartWorkServer(chainparams, GetScriptForDestination(dest)))
+            return InitError(_("Unable to start the work server. See debug log for details."));
+    }
+
     SetRPCWarmupFinished();
     uiInterface.InitMessage(_("Done loading"));
 
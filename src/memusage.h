@@ -5,6 +5,7 @@
 #ifndef BITCOIN_MEMUSAGE_H
 #define BITCOIN_MEMUSAGE_H
 
+#include <flatmap.h>
 #include <indirectmap.h>
 
 #include <stdlib.h>
@@ -165,6 +166,14 @@ static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+// flatmap values live in chunks shared by many, including the free ones
+
+template<typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const flatmap<X, Y, Z>& m)
+{
+    return MallocUsage(m.TableBytes()) + m.ChunkBytes();
+}
+
 }
 
 #endif // BITCOIN_MEMUSAGE_H
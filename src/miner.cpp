@@ -17,6 +17,7 @@
 #include <consensus/tx_verify.h>
 #include <consensus/merkle.h>
 #include <consensus/validation.h>
+#include <gapsieve.h>
 #include <hash.h>
 #include <validation.h>
 #include <net.h>
@@ -38,6 +39,8 @@
 
 #include <boost/thread.hpp>
 #include <algorithm>
+#include <functional>
+#include <map>
 #include <memory>
 #include <queue>
 #include <utility>
@@ -67,18 +70,60 @@ uint64_t nLastBlockWeight = 0;
 uint64_t nMiningTimeStart = 0;
 uint64_t nHashesPerSec = 0;
 uint64_t nHashesDone = 0;
-int64_t nHPSTimerStart = 0;
+
+/**
+ * Counters of one miner thread. Only that thread writes them, GetMiningStats
+ * reads them. Padded on both sides since operator new ignores alignas before
+ * C++17, so no two threads ever write to the same cache line.
+ */
+struct CMinerThreadStats
+{
+    char padBefore[64];
+    std::atomic<double> dPrimesPerSec{0.0};
+    std::atomic<double> dTestsPerSec{0.0};
+    std::atomic<uint64_t> nPasses{0};
+    std::atomic<int64_t> nPassMicros{0};
+    std::atomic<uint64_t> nTests{0};
+    std::atomic<int64_t> nLastPass{0};
+    std::atomic<int> nCore{-1};
+    std::atomic<int> nNode{-1};
+    std::atomic<uint64_t> vGapsByMerit[MINING_MERIT_BUCKETS];
+    char padAfter[64];
+
+    CMinerThreadStats()
+    {
+        for (std::atomic<uint64_t>& nGaps : vGapsByMerit)
+            nGaps = 0;
+    }
+};
 
 class BlockProcessor : public PoWProcessor {
 
   public:
 
-    BlockProcessor(CBlock *pblock, std::shared_ptr<CReserveScript> coinbase_script) : PoWProcessor() {
+    BlockProcessor(CBlock *pblock, std::shared_ptr<CReserveScript> coinbase_script,
+                   const std::atomic<uint64_t>* pgeneration = nullptr, uint64_t generation = 0,
+                   CMinerThreadStats* pstats = nullptr) : PoWProcessor() {
       this->pblock = pblock;
       this->coinbasescript = coinbase_script;
+      this->pgeneration = pgeneration;
+      this->generation = generation;
+      this->pstats = pstats;
     }
 
     bool process(PoW *pow) {
+      // Once newer work was published, end the sieve pass at the next gap it
+      // reports instead of submitting a stale block; the sieve itself only
+      // hands over control here, so a pass without gaps runs to its end
+      if (pgeneration && *pgeneration != generation)
+        return false;
+
+      if (pstats) {
+        // merit is fixed point with 48 fractional bits, like nDifficulty
+        uint64_t merit = std::min<uint64_t>(pow->merit() >> 48, MINING_MERIT_BUCKETS - 1);
+        pstats->vGapsByMerit[merit].fetch_add(1, std::memory_order_relaxed);
+      }
+
       // SetThreadPriority(THREAD_PRIORITY_NORMAL);
 
       pow->get_adder(&pblock->nAdd);
@@ -92,6 +137,9 @@ class BlockProcessor : public PoWProcessor {
 
     CBlock *pblock;
     std::shared_ptr<CReserveScript> coinbasescript;
+    const std::atomic<uint64_t>* pgeneration;
+    uint64_t generation;
+    CMinerThreadStats* pstats;
 
 };
 
@@ -522,15 +570,49 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
 //
 // Internal miner
 //
-double dHashesPerSec = 0.0;
 bool isMining = false;
-double dTestsPerSec = 0.0;
 double d15GapsPerHour = 0.0;
-uint64_t nMiningSieveSize = 33554432;
-uint64_t nMiningPrimes = 900000;
-uint16_t nMiningShift = 25;
-static std::vector<double> dThreadHashesPerSec;
-static std::vector<double> dThreadTestsPerSec;
+std::atomic<uint64_t> nMiningSieveSize{33554432};
+std::atomic<uint64_t> nMiningPrimes{900000};
+std::atomic<uint16_t> nMiningShift{25};
+//! Counters of the running miner threads, in thread order
+static CCriticalSection cs_minerstats;
+static std::vector<std::shared_ptr<CMinerThreadStats>> vMinerStats;
+
+CMiningStats GetMiningStats(std::vector<CMiningStats>* pvPerThread)
+{
+    CMiningStats total;
+
+    LOCK(cs_minerstats);
+    for (const std::shared_ptr<CMinerThreadStats>& pstats : vMinerStats) {
+        CMiningStats stats;
+        stats.nThreads = 1;
+        stats.dPrimesPerSec = pstats->dPrimesPerSec.load(std::memory_order_relaxed);
+        stats.dTestsPerSec = pstats->dTestsPerSec.load(std::memory_order_relaxed);
+        stats.nPasses = pstats->nPasses.load(std::memory_order_relaxed);
+        stats.nPassMicros = pstats->nPassMicros.load(std::memory_order_relaxed);
+        stats.nTests = pstats->nTests.load(std::memory_order_relaxed);
+        stats.nLastPass = pstats->nLastPass.load(std::memory_order_relaxed);
+        stats.nCore = pstats->nCore.load(std::memory_order_relaxed);
+        stats.nNode = pstats->nNode.load(std::memory_order_relaxed);
+        for (unsigned int i = 0; i < MINING_MERIT_BUCKETS; i++)
+            stats.vGapsByMerit[i] = pstats->vGapsByMerit[i].load(std::memory_order_relaxed);
+
+        total.nThreads++;
+        total.dPrimesPerSec += stats.dPrimesPerSec;
+        total.dTestsPerSec += stats.dTestsPerSec;
+        total.nPasses += stats.nPasses;
+        total.nPassMicros += stats.nPassMicros;
+        total.nTests += stats.nTests;
+        total.nLastPass = std::max(total.nLastPass, stats.nLastPass);
+        for (unsigned int i = 0; i < MINING_MERIT_BUCKETS; i++)
+            total.vGapsByMerit[i] += stats.vGapsByMerit[i];
+
+        if (pvPerThread)
+            pvPerThread->push_back(stats);
+    }
+    return total;
+}
 
 bool CheckWork(const CBlock* pblock, std::shared_ptr<CReserveScript> coinbaseScript)
 {
@@ -595,181 +677,506 @@ CWallet *GetFirstWallet() {
     return(vpwallets[0]);
 }
 
-void static GapcoinMiner(int nThread, int numThreads, const CChainParams& chainparams)
+CMinerPool::CMinerPool(const CChainParams& chainparamsIn) : chainparams(chainparamsIn)
 {
-    LogPrintf("GapcoinMiner %s started, shift %s, sieve-primes %s, sieve-size %s\n", nThread, nMiningShift, nMiningPrimes, nMiningSieveSize);
-    // SetThreadPriority(20); //THREAD_PRIORITY_LOWEST
-    RenameThread(strprintf("gapcoin-miner %s", nThread).c_str());
+}
 
-    unsigned int nExtraNonce = 0;
-    arith_uint256 hashTarget = UintToArith256(uint256S("7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF"));
-    Sieve sieve(NULL, nMiningPrimes, nMiningSieveSize);
+CMinerPool::~CMinerPool()
+{
+    SetThreads(0);
+}
 
+void CMinerPool::SetThreads(int nThreads)
+{
+    nThreads = std::max(nThreads, 0);
+    nStride = std::max(nThreads, 1);
 
-    CWallet *  pWallet = GetFirstWallet();
+    // Threads beyond the new count finish their current sieve pass and exit
+    if ((size_t)nThreads < vThreads.size()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = nThreads; i < vThreads.size(); i++)
+                vThreads[i]->fStop = true;
+        }
+        cond.notify_all();
+        for (size_t i = nThreads; i < vThreads.size(); i++)
+            vThreads[i]->thread.join();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            vThreads.resize(nThreads);
+        }
 
+        LOCK(cs_minerstats);
+        vMinerStats.resize(nThreads);
+    }
 
-    if (!EnsureWalletIsAvailable(pWallet, false) || pWallet == NULL)
-        throw std::runtime_error(strprintf("Gapcoin miner %s wallet unavailable (mining requires a wallet)", nThread));
+    while (vThreads.size() < (size_t)nThreads) {
+        int nThread = vThreads.size();
+        std::unique_ptr<MinerThread> thread(new MinerThread);
+        MinerThread& self = *thread;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            vThreads.push_back(std::move(thread));
+        }
+        self.stats = std::make_shared<CMinerThreadStats>();
+        {
+            LOCK(cs_minerstats);
+            vMinerStats.push_back(self.stats);
+        }
+        int nCore = vCores.empty() ? -1 : vCores[nThread % vCores.size()];
+        self.thread = std::thread(&CMinerPool::ThreadMiner, this, nThread, nCore, std::ref(self));
+    }
+}
 
-    std::shared_ptr<CReserveScript> coinbaseScript;
+uint64_t CMinerPool::Publish(std::shared_ptr<CMinerWork> workIn)
+{
+    uint64_t nNew;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        nNew = nGeneration + 1;
+        if (workIn)
+            workIn->nGeneration = nNew;
+        workCurrent = std::move(workIn);
+        fRefresh = false;
+        // Threads compare against the counter between sieve passes, so it is
+        // bumped only once the new work is in place
+        nGeneration = nNew;
+    }
+    cond.notify_all();
+    return nNew;
+}
 
-    pWallet->GetScriptForMining(coinbaseScript);
+std::shared_ptr<const CMinerWork> CMinerPool::GetWork() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return workCurrent;
+}
 
-    // Throw an error if no script was provided.  This can happen
-    // due to some internal error but also if the keypool is empty.
-    // In the latter case, already the pointer is NULL.
-    if (!coinbaseScript || coinbaseScript->reserveScript.empty())
-        throw std::runtime_error(strprintf("Gapcoin miner %s no coinbase script available (mining requires a wallet)", nThread));
+int CMinerPool::CountThreadsOn(uint64_t nGenerationIn) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    int nCount = 0;
+    for (const auto& thread : vThreads)
+        if (thread->nGeneration == nGenerationIn)
+            nCount++;
+    return nCount;
+}
 
-    try {
-        while (true) {
+std::shared_ptr<const CMinerWork> CMinerPool::WaitForWork(const MinerThread& self, uint64_t nDone)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto ready = [&]{ return self.fStop || (workCurrent && workCurrent->nGeneration != nDone); };
+    if (!ready()) {
+        // A parked thread doesn't mine, so its last rates no longer count
+        self.stats->dPrimesPerSec.store(0.0, std::memory_order_relaxed);
+        self.stats->dTestsPerSec.store(0.0, std::memory_order_relaxed);
+        cond.wait(lock, ready);
+    }
+    if (self.fStop)
+        return nullptr;
+    return workCurrent;
+}
 
-            if (chainparams.MiningRequiresPeers()) {
-                // Busy-wait for the network to come online so we don't waste time mining
-                // on an obsolete chain. In regtest mode we expect to fly solo.
-                do {
-                    if ((g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) > 0) && !IsInitialBlockDownload()) {
-                        break;
-                    }
+void CMinerPool::ThreadMiner(int nThread, int nCore, MinerThread& self)
+{
+    static const arith_uint256 hashTarget = UintToArith256(uint256S("7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF"));
 
-                    MilliSleep(1000);
-                } while (true);
-            }
+    const bool fSegmented = gArgs.GetBoolArg("-gensegmented", DEFAULT_GENSEGMENTED);
+    std::unique_ptr<Sieve> sieve;
+    std::unique_ptr<CGapSieve> gapsieve;
+    uint64_t nSievePrimes = 0, nSieveSize = 0;
+    uint64_t nDone = 0;
+    int64_t nLogTime = 0;
+    CMinerThreadStats& stats = *self.stats;
 
+    LogPrintf("GapcoinMiner %s started\n", nThread);
+    RenameThread(strprintf("gapcoin-miner %s", nThread).c_str());
 
-            //
-            // Create new block
-            //
-            unsigned int nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-            CBlockIndex* pindexPrev = chainActive.Tip();
-            if(!pindexPrev) break;
+    // Pin before the sieve is built so its pages are first touched, and
+    // thereby allocated, on this CPU's NUMA node
+    if (nCore >= 0) {
+        if (PinThreadToCore(nCore)) {
+            stats.nCore = nCore;
+            stats.nNode = GetCoreNumaNode(nCore);
+            LogPrintf("GapcoinMiner %s pinned to cpu %d, node %d\n", nThread, nCore, stats.nNode);
+        } else {
+            LogPrintf("GapcoinMiner %s could not be pinned to cpu %d\n", nThread, nCore);
+        }
+    }
+
+    std::shared_ptr<const CMinerWork> pwork;
+    while ((pwork = WaitForWork(self, nDone))) {
+        const CMinerWork& work = *pwork;
+        nDone = work.nGeneration;
+
+        // The prime tables are the expensive part of a sieve, keep them as
+        // long as the parameters stay the same
+        if ((!sieve && !gapsieve) || nSievePrimes != work.nSievePrimes || nSieveSize != work.nSieveSize) {
+            int64_t nTime = GetTimeMicros();
+            sieve.reset();
+            gapsieve.reset();
+            if (fSegmented)
+                gapsieve.reset(new CGapSieve(NULL, work.nSievePrimes, work.nSieveSize));
+            else
+                sieve.reset(new Sieve(NULL, work.nSievePrimes, work.nSieveSize));
+            nSievePrimes = work.nSievePrimes;
+            nSieveSize = work.nSieveSize;
+            LogPrintf("GapcoinMiner %s built %ssieve, sieve-primes %s, sieve-size %s (%.2fms)\n", nThread, fSegmented ? "segmented " : "", nSievePrimes, nSieveSize, 0.001 * (GetTimeMicros() - nTime));
+        }
+
+        CBlock block = work.block;
+        BlockProcessor processor(&block, work.coinbaseScript, &nGeneration, work.nGeneration, &stats);
+        if (gapsieve)
+            gapsieve->SetProcessor(&processor);
+        else
+            sieve->set_pprocessor(&processor);
+        self.nGeneration = work.nGeneration;
+
+        // provide unique hashes for each thread
+        const int nThreads = nStride;
+        block.nNonce = nThread;
+
+        try {
+            while (!self.fStop && nGeneration == work.nGeneration) {
+                // header hash has to be greater than 2^255 - 1
+                while (UintToArith256(block.GetHash()) <= hashTarget)
+                    block.nNonce += nThreads;
+
+                // re-get the hash for the block but as uint256
+                uint256 hash = block.GetHash();
+                int64_t nPassStart = GetTimeMicros();
+                double dPrimesPerSec, dTestsPerSec;
+                if (gapsieve) {
+                    gapsieve->Run(hash, block.nShift, block.nDifficulty);
+                    dPrimesPerSec = gapsieve->PrimesPerSec();
+                    dTestsPerSec = gapsieve->TestsPerSec();
+                } else {
+                    std::vector<uint8_t> vHash(hash.begin(), hash.end());
+                    PoW pow(&vHash, block.nShift, &block.nAdd, block.nDifficulty);
+                    sieve->run_sieve(&pow, NULL);
+                    dPrimesPerSec = sieve->primes_per_sec();
+                    dTestsPerSec = sieve->tests_per_second();
+                }
+                int64_t nPassMicros = GetTimeMicros() - nPassStart;
+
+                stats.dPrimesPerSec.store(dPrimesPerSec, std::memory_order_relaxed);
+                stats.dTestsPerSec.store(dTestsPerSec, std::memory_order_relaxed);
+                stats.nPasses.fetch_add(1, std::memory_order_relaxed);
+                stats.nPassMicros.fetch_add(nPassMicros, std::memory_order_relaxed);
+                stats.nTests.fetch_add((uint64_t)(dTestsPerSec * nPassMicros / 1000000), std::memory_order_relaxed);
+                stats.nLastPass.store(GetTimeMillis(), std::memory_order_relaxed);
 
-            std::unique_ptr<CBlockTemplate> pblocktemplate(BlockAssembler(Params()).CreateNewBlock(coinbaseScript->reserveScript));
+                if (nThread == 0 && GetTime() - nLogTime > 30 * 60)
+                {
+                    nLogTime = GetTime();
+                    LogPrintf("Gapcoin miner primemeter %6.0f primes/s.\n", GetMiningStats().dPrimesPerSec);
+                }
 
-            if (!pblocktemplate.get())
-            {
-                LogPrintf("GapcoinMiner -- Keypool ran out for miner %s, please call keypoolrefill before restarting the mining thread.\n", nThread);
-                return;
+                // Out of nonces or the clock ran backwards: ask for a new
+                // template and wait for it
+                if (block.nNonce >= 0xffff0000 || UpdateTime(&block, chainparams.GetConsensus(), work.pindexPrev) < 0) {
+                    fRefresh = true;
+                    break;
+                }
             }
+        } catch (const std::runtime_error& e) {
+            LogPrintf("GapcoinMiner %s runtime error: %s.\n", nThread, e.what());
+        }
+        self.nGeneration = 0;
+        if (gapsieve)
+            gapsieve->SetProcessor(NULL);
+        else
+            sieve->set_pprocessor(NULL);
+    }
+
+    LogPrintf("GapcoinMiner %s terminated.\n", nThread);
+}
+
+CMinerTuner::CMinerTuner(int64_t nSliceMillisIn) : nSliceMillis(nSliceMillisIn), powUtils(new PoWUtils())
+{
+}
+
+CMinerTuner::~CMinerTuner()
+{
+}
+
+void CMinerTuner::SetEnabled(bool fEnabledIn)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    report = CMiningTuneReport();
+    report.fEnabled = fEnabledIn;
+    vCandidates.clear();
+}
 
-            CBlock *pblock = &pblocktemplate->block;
-            IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
+CMiningTuneReport CMinerTuner::GetReport()
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return report;
+}
 
-            LogPrintf("Gapcoin miner %s searching for a valid hash with %u transactions in block (%u bytes).\n", nThread, pblock->vtx.size(),
-                ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION));
+void CMinerTuner::Step(const CMinerPool& pool)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    std::shared_ptr<const CMinerWork> work = pool.GetWork();
+    if (!report.fEnabled || !work)
+        return;
 
-            //
-            // Search
-            //
-            BlockProcessor processor(pblock, coinbaseScript);
+    // The shift is the operator's; a new one starts the tuning over
+    const uint16_t nShift = nMiningShift;
+    uint64_t nDifficulty = work->block.nDifficulty;
+    if (!report.fTuning || nShift != nTuneShift) {
+        if (!report.fTuning && nShift == nTuneShift && report.nBest >= 0 &&
+            std::max(nDifficulty, report.nDifficulty) - std::min(nDifficulty, report.nDifficulty) < MINING_RETUNE_DRIFT)
+            return;
+        LogPrintf("GapcoinMiner -- tuning sieve parameters at shift %u, difficulty %.4f\n", nShift, (double)nDifficulty / (1ULL << 48));
+        report.fTuning = true;
+        report.nDifficulty = nDifficulty;
+        report.vResults.clear();
+        report.nBest = -1;
+        nTuneShift = nShift;
+        // The sieve can't be larger than 2^shift
+        vCandidates.clear();
+        const int nMaxBits = std::min<int>(nShift, MINING_TUNE_MAX_SIZE_BITS);
+        for (int nBits = std::min<int>(nMaxBits, MINING_TUNE_MIN_SIZE_BITS); nBits <= nMaxBits; nBits++)
+            vCandidates.push_back(Candidate(nShift, 1ULL << nBits, DEFAULT_MINING_TUNE_PRIMES));
+        nSizeCandidates = vCandidates.size();
+        Apply(vCandidates.front());
+        return;
+    }
 
-            sieve.set_pprocessor(&processor);
-            int64_t nStart = GetTime();
+    // Wait for the candidate's work to be out, then for every thread to
+    // finish two passes with it, the first one may have started earlier
+    const CMiningTuneResult& candidate = vCandidates[report.vResults.size()];
+    if (work->block.nShift != candidate.nShift || work->nSievePrimes != candidate.nSievePrimes || work->nSieveSize != candidate.nSieveSize)
+        return;
 
-            // provide unique hashes for each thread
-            pblock->nNonce = nThread;
+    std::vector<CMiningStats> vThreads;
+    GetMiningStats(&vThreads);
+    if (nStart == 0) {
+        nStart = GetTimeMillis();
+        vBasePasses.clear();
+        for (const CMiningStats& thread : vThreads)
+            vBasePasses.push_back(thread.nPasses);
+        return;
+    }
 
-            while (true)
-            {
+    bool fMeasured = vThreads.size() == vBasePasses.size();
+    for (size_t i = 0; fMeasured && i < vThreads.size(); i++)
+        fMeasured = vThreads[i].nPasses >= vBasePasses[i] + 2;
+    int64_t nElapsed = GetTimeMillis() - nStart;
+    if (nElapsed < nSliceMillis || (!fMeasured && nElapsed < 3 * nSliceMillis))
+        return;
 
-                // header hash has to be greater than 2^255 - 1
-                while (UintToArith256(pblock->GetHash()) <= hashTarget)
-                    pblock->nNonce += numThreads;
+    // A configuration too slow to finish two passes counts as zero
+    CMiningTuneResult result = candidate;
+    if (fMeasured) {
+        for (const CMiningStats& thread : vThreads) {
+            result.dPrimesPerSec += thread.dPrimesPerSec;
+            result.dTestsPerSec += thread.dTestsPerSec;
+        }
+        result.dGapsPerDay = powUtils->gaps_per_day(result.dPrimesPerSec, nDifficulty);
+    }
+    report.vResults.push_back(result);
+    LogPrintf("GapcoinMiner -- shift %u, sieve-primes %u, sieve-size %u: %.0f primes/s, %.0f tests/s, %.4f gaps/day\n",
+        result.nShift, result.nSievePrimes, result.nSieveSize, result.dPrimesPerSec, result.dTestsPerSec, result.dGapsPerDay);
+
+    // After the sizes, try fewer and more primes at the best one
+    int nBest = Best();
+    if (report.vResults.size() == vCandidates.size() && vCandidates.size() == nSizeCandidates) {
+        const CMiningTuneResult& best = report.vResults[nBest];
+        for (uint64_t nPrimes : {250000, 500000, 1500000, 3000000})
+            vCandidates.push_back(Candidate(best.nShift, best.nSieveSize, nPrimes));
+    }
 
-                // re-get the hash for the block but as uint256
-                uint256 hash = pblock->GetHash();
-                std::vector<uint8_t> vHash(hash.begin(), hash.end());
+    if (report.vResults.size() < vCandidates.size()) {
+        Apply(vCandidates[report.vResults.size()]);
+        return;
+    }
 
-                PoW pow(&vHash, pblock->nShift, &pblock->nAdd, pblock->nDifficulty);
-                sieve.run_sieve(&pow, NULL);
+    report.fTuning = false;
+    report.nBest = nBest;
+    Apply(report.vResults[nBest]);
+    LogPrintf("GapcoinMiner -- tuned to shift %u, sieve-primes %u, sieve-size %u\n", nMiningShift.load(), nMiningPrimes.load(), nMiningSieveSize.load());
+}
 
-                static CCriticalSection cs;
-                {
-                    LOCK(cs);
+CMiningTuneResult CMinerTuner::Candidate(uint16_t nShift, uint64_t nSieveSize, uint64_t nPrimes)
+{
+    CMiningTuneResult candidate;
+    candidate.nShift = nShift;
+    candidate.nSievePrimes = nPrimes;
+    candidate.nSieveSize = nSieveSize;
+    return candidate;
+}
 
-                    dThreadHashesPerSec[nThread] = sieve.primes_per_sec();
-                    dThreadTestsPerSec[nThread] = sieve.tests_per_second();
-                    dHashesPerSec = 0.0;
-                    dTestsPerSec  = 0.0;
+void CMinerTuner::Apply(const CMiningTuneResult& candidate)
+{
+    nMiningPrimes = candidate.nSievePrimes;
+    nMiningSieveSize = candidate.nSieveSize;
+    nStart = 0;
+}
 
-                    for (uint32_t i = 0; i < dThreadHashesPerSec.size(); i++) {
-                        dHashesPerSec += dThreadHashesPerSec[i];
-                        dTestsPerSec  += dThreadTestsPerSec[i];
-                    }
+int CMinerTuner::Best() const
+{
+    int nBest = 0;
+    for (size_t i = 1; i < report.vResults.size(); i++) {
+        if (report.vResults[i].dGapsPerDay > report.vResults[nBest].dGapsPerDay)
+            nBest = i;
+    }
+    return nBest;
+}
 
-                    nHPSTimerStart = GetTimeMillis();
+static CMinerTuner minerTuner;
 
-                    static int64_t nLogTime = 0;
-                    if (GetTime() - nLogTime > 30 * 60)
-                    {
-                        nLogTime = GetTime();
-                        LogPrintf("Gapcoin miner %s primemeter %6.0f primes/s.\n", nThread, dHashesPerSec);
-                    }
+void SetMiningAutoTune(bool fEnabled)
+{
+    minerTuner.SetEnabled(fEnabled);
+}
 
-                }
+CMiningTuneReport GetMiningTuneReport()
+{
+    return minerTuner.GetReport();
+}
 
-                // Check for stop or if block needs to be rebuilt
-                boost::this_thread::interruption_point();
-                // Regtest mode doesn't require peers
-                if ((g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0) && chainparams.MiningRequiresPeers())
-                    break;
-                if (pblock->nNonce >= 0xffff0000)
-                    break;
-                if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 60)
-                    break;
-                if (pindexPrev != chainActive.Tip())
-                    break;
+/**
+ * Builds the one template all miner threads work on and publishes a new one
+ * as soon as the tip changes, the mempool changed for more than a minute or
+ * a thread asks for it.
+ */
+static void GapcoinTemplateBuilder(CMinerPool& pool, const std::atomic<bool>& fStop, const CChainParams& chainparams)
+{
+    while (vpwallets.empty()) {
+        if (fStop)
+            return;
+        MilliSleep(100);
+    }
+    CWallet* pWallet = GetFirstWallet();
+
+    std::shared_ptr<CReserveScript> coinbaseScript;
+    if (EnsureWalletIsAvailable(pWallet, false))
+        pWallet->GetScriptForMining(coinbaseScript);
+
+    // This can happen due to some internal error but also if the keypool
+    // is empty. In the latter case, already the pointer is NULL.
+    if (!coinbaseScript || coinbaseScript->reserveScript.empty()) {
+        LogPrintf("GapcoinMiner -- no coinbase script available (mining requires a wallet)\n");
+        return;
+    }
+
+    unsigned int nExtraNonce = 0;
+    while (!fStop) {
+        // Don't waste time mining on an obsolete chain while the network comes
+        // online. In regtest mode we expect to fly solo.
+        if (chainparams.MiningRequiresPeers() &&
+            (g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0 || IsInitialBlockDownload())) {
+            if (pool.GetWork())
+                pool.Publish(nullptr);
+            MilliSleep(1000);
+            continue;
+        }
 
-                // Update nTime every few seconds
-                if (UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev) < 0)
-                    break; // Recreate the block if the clock has run backwards,
-                           // so that we can use the correct time.
+        minerTuner.Step(pool);
+
+        std::shared_ptr<const CMinerWork> current = pool.GetWork();
+        uint256 hashWatched;
+        try {
+            LOCK(cs_main);
+            CBlockIndex* pindexPrev = chainActive.Tip();
+            if (pindexPrev)
+                hashWatched = pindexPrev->GetBlockHash();
+            if (pindexPrev && (!current || current->pindexPrev != pindexPrev || pool.RefreshRequested() ||
+                current->block.nShift != nMiningShift ||
+                current->nSievePrimes != nMiningPrimes || current->nSieveSize != nMiningSieveSize ||
+                (mempool.GetTransactionsUpdated() != current->nTransactionsUpdated && GetTime() - current->nCreated > 60))) {
+
+                std::shared_ptr<CMinerWork> work = std::make_shared<CMinerWork>();
+                work->nTransactionsUpdated = mempool.GetTransactionsUpdated();
+                std::unique_ptr<CBlockTemplate> pblocktemplate(BlockAssembler(chainparams).CreateNewBlock(coinbaseScript->reserveScript));
+                if (!pblocktemplate) {
+                    LogPrintf("GapcoinMiner -- Keypool ran out, please call keypoolrefill before restarting the miner.\n");
+                    pool.Publish(nullptr);
+                    return;
+                }
+                work->block = std::move(pblocktemplate->block);
+                IncrementExtraNonce(&work->block, pindexPrev, nExtraNonce);
+                work->pindexPrev = pindexPrev;
+                work->coinbaseScript = coinbaseScript;
+                work->nCreated = GetTime();
+                work->nSievePrimes = nMiningPrimes;
+                work->nSieveSize = nMiningSieveSize;
+
+                LogPrintf("Gapcoin miner searching for a valid hash with %u transactions in block (%u bytes).\n", work->block.vtx.size(),
+                    ::GetSerializeSize(work->block, SER_NETWORK, PROTOCOL_VERSION));
+                pool.Publish(std::move(work));
             }
+        } catch (const std::runtime_error& e) {
+            LogPrintf("GapcoinMiner -- template error: %s\n", e.what());
         }
+
+        // Woken right away when the tip moves; the timeout covers the mempool
+        // rule and refresh requests from the miner threads
+        WaitableLock lock(csBestBlock);
+        if (!fStop && hashBestBlock == hashWatched)
+            cvBlockChange.wait_for(lock, std::chrono::seconds(1));
     }
-    catch (const boost::thread_interrupted&)
-    {
-        LogPrintf("GapcoinMiner %s terminated.\n", nThread);
+}
 
-        static CCriticalSection cs;
-        {
-            LOCK(cs);
-            dHashesPerSec = 0.0;
+/**
+ * The CPUs to pin miner threads to, taking one CPU of every NUMA node in
+ * turn so that fewer threads than CPUs still spread over all nodes.
+ */
+static std::vector<int> GetMinerCores()
+{
+    std::map<int, std::vector<int>> mapNodeCores;
+    for (int nCore : GetAvailableCores())
+        mapNodeCores[GetCoreNumaNode(nCore)].push_back(nCore);
+
+    std::vector<int> vCores;
+    for (size_t i = 0; !mapNodeCores.empty(); i++) {
+        for (auto it = mapNodeCores.begin(); it != mapNodeCores.end(); ) {
+            if (i < it->second.size()) {
+                vCores.push_back(it->second[i]);
+                ++it;
+            } else {
+                it = mapNodeCores.erase(it);
+            }
         }
-        throw;
-    }
-    catch (const std::runtime_error &e)
-    {
-        LogPrintf("GapcoinMiner %s runtime error: %s.\n", nThread, e.what());
-        return;
     }
+    return vCores;
 }
 
 int GenerateGapcoins(bool fGenerate, int nThreads, const CChainParams& chainparams)
 {
+    static std::mutex cs_generate;
+    static std::unique_ptr<CMinerPool> minerPool;
+    static std::thread templateBuilder;
+    static std::atomic<bool> fStopBuilder(false);
 
-    static boost::thread_group* minerThreads = NULL;
+    std::lock_guard<std::mutex> lock(cs_generate);
 
     // int nThreads = gArgs.GetArg("genproclimit", -1);
     int numCores = GetNumCores();
     if (nThreads < 0)
         nThreads = numCores;
 
-    if (minerThreads != NULL)
-    {
-        minerThreads->interrupt_all();
-        delete minerThreads;
-        minerThreads = NULL;
+    if (templateBuilder.joinable()) {
+        {
+            WaitableLock lockBest(csBestBlock);
+            fStopBuilder = true;
+        }
+        cvBlockChange.notify_all();
+        templateBuilder.join();
+        fStopBuilder = false;
     }
 
-    if (nThreads == 0 || !fGenerate)
+    if (nThreads == 0 || !fGenerate) {
+        if (minerPool) {
+            minerPool->Publish(nullptr);
+            if (nThreads == 0)
+                minerPool.reset();
+        }
+        isMining = false;
         return numCores;
-
-    dThreadHashesPerSec.clear();
-    dThreadTestsPerSec.clear();
-
-    minerThreads = new boost::thread_group();
+    }
 
     //Reset metrics
     nMiningTimeStart = GetTimeMicros();
@@ -777,12 +1184,17 @@ int GenerateGapcoins(bool fGenerate, int nThreads, const CChainParams& chainpara
     nHashesPerSec = 0;
     isMining = fGenerate;
 
-    for (int i = 0; i < nThreads; i++)
-    {
-        dThreadHashesPerSec.push_back(0.0);
-        dThreadTestsPerSec.push_back(0.0);
-        minerThreads->create_thread(boost::bind(&GapcoinMiner, i, nThreads, boost::cref(chainparams)));
-    }
+    if (!minerPool)
+        minerPool.reset(new CMinerPool(chainparams));
+    minerPool->SetCores(gArgs.GetBoolArg("-genpin", DEFAULT_GENPIN) ? GetMinerCores() : std::vector<int>());
+    // New threads pick up the current work; drop it so the builder hands out
+    // a template with the nonce space split over the new thread count
+    if (nThreads != minerPool->GetThreads())
+        minerPool->Publish(nullptr);
+    minerPool->SetThreads(nThreads);
+
+    templateBuilder = std::thread(&TraceThread<std::function<void()>>, "minertmpl",
+                                  std::function<void()>(std::bind(&GapcoinTemplateBuilder, std::ref(*minerPool), std::cref(fStopBuilder), std::cref(chainparams))));
 
     return(numCores);
 }
@@ -11,18 +11,29 @@
 #include <txmempool.h>
 
 #include <stdint.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 
 class CBlockIndex;
 class CChainParams;
+class CReserveScript;
 class CScript;
 class CWallet;
+class PoWUtils;
 
 namespace Consensus { struct Params; };
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+//! Default for -genpin
+static const bool DEFAULT_GENPIN = false;
+//! Default for -gensegmented
+static const bool DEFAULT_GENSEGMENTED = false;
 
 struct CBlockTemplate
 {
@@ -199,13 +210,196 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
 bool CheckWork(const CBlock* pblock, std::shared_ptr<CReserveScript> coinbase_script);
 
-extern double dTestsPerSec;
-extern double dHashesPerSec;
 extern bool isMining;
-extern int64_t nHPSTimerStart;
-extern uint64_t nMiningSieveSize;
-extern uint64_t nMiningPrimes;
-extern uint16_t nMiningShift;
+//! Sieve parameters of the internal miner, set by setgenerate, the GUI and the auto-tuner
+extern std::atomic<uint64_t> nMiningSieveSize;
+extern std::atomic<uint64_t> nMiningPrimes;
+extern std::atomic<uint16_t> nMiningShift;
 
+//! Merit buckets of the gaps reported by the sieve; the last one also counts every larger merit
+static const unsigned int MINING_MERIT_BUCKETS = 64;
+
+struct CMinerThreadStats;
+
+/** Internal miner counters, of one thread or summed over all of them */
+struct CMiningStats
+{
+    int nThreads = 0;
+    double dPrimesPerSec = 0.0;
+    double dTestsPerSec = 0.0;
+    //! Sieve passes and the time spent in them
+    uint64_t nPasses = 0;
+    int64_t nPassMicros = 0;
+    //! Prime tests of those passes, estimated from the sieve's test rate
+    uint64_t nTests = 0;
+    //! GetTimeMillis() at the end of the most recent pass
+    int64_t nLastPass = 0;
+    //! CPU and NUMA node the thread is pinned to, -1 if it isn't
+    int nCore = -1;
+    int nNode = -1;
+    std::array<uint64_t, MINING_MERIT_BUCKETS> vGapsByMerit{};
+};
+
+/**
+ * Sum the counters of all miner threads. The threads never synchronize on
+ * them, the sum is only formed here, when someone asks.
+ */
+CMiningStats GetMiningStats(std::vector<CMiningStats>* pvPerThread = nullptr);
+
+//! Time each candidate sieve configuration is measured for while auto-tuning, in seconds
+static const int64_t MINING_TUNE_SLICE = 10;
+//! Re-tune once the difficulty moved this far from the one tuned for (one merit)
+static const uint64_t MINING_RETUNE_DRIFT = 1ULL << 48;
+//! Sieve sizes tried by the auto-tuner, as powers of two, as far as the shift allows
+static const int MINING_TUNE_MIN_SIZE_BITS = 21;
+static const int MINING_TUNE_MAX_SIZE_BITS = 25;
+//! Sieve-primes the sieve sizes are measured at
+static const uint64_t DEFAULT_MINING_TUNE_PRIMES = 900000;
+
+/** One sieve configuration measured by the auto-tuner */
+struct CMiningTuneResult
+{
+    uint16_t nShift = 0;
+    uint64_t nSievePrimes = 0;
+    uint64_t nSieveSize = 0;
+    double dPrimesPerSec = 0.0;
+    double dTestsPerSec = 0.0;
+    double dGapsPerDay = 0.0;
+};
+
+/** State of the auto-tuner (setgenerate with autotune) */
+struct CMiningTuneReport
+{
+    bool fEnabled = false;
+    bool fTuning = false;
+    //! Difficulty the measurements were made at
+    uint64_t nDifficulty = 0;
+    std::vector<CMiningTuneResult> vResults;
+    //! Index into vResults of the configuration in use, -1 while none was picked
+    int nBest = -1;
+};
+
+/**
+ * Switch the auto-tuner on or off. While on, the miner measures candidate
+ * sieve configurations at the shift set on live work for MINING_TUNE_SLICE
+ * seconds each, keeps the one with the best expected gaps per day and
+ * starts over once the difficulty drifted by MINING_RETUNE_DRIFT or the
+ * shift changed.
+ */
+void SetMiningAutoTune(bool fEnabled);
+CMiningTuneReport GetMiningTuneReport();
+
+/** Work shared by all internal miner threads, replaced as a whole whenever the template is rebuilt */
+struct CMinerWork
+{
+    //! Template with the coinbase extranonce already applied
+    CBlock block;
+    const CBlockIndex* pindexPrev = nullptr;
+    std::shared_ptr<CReserveScript> coinbaseScript;
+    unsigned int nTransactionsUpdated = 0;
+    int64_t nCreated = 0;
+    uint64_t nSievePrimes = 0;
+    uint64_t nSieveSize = 0;
+    //! Assigned by CMinerPool::Publish
+    uint64_t nGeneration = 0;
+};
+
+/**
+ * Persistent pool of internal miner threads. Every thread keeps its sieve,
+ * prime tables included, across templates and setgenerate calls and only
+ * rebuilds it when the sieve parameters of the work change. New work is
+ * published once for all threads, which switch to it as soon as their
+ * current sieve pass ends.
+ */
+class CMinerPool
+{
+public:
+    explicit CMinerPool(const CChainParams& chainparams);
+    ~CMinerPool();
+
+    /**
+     * CPUs to pin threads started from now on to, thread i to vCores[i % size].
+     * Pinning happens before a thread builds its sieve, so the sieve is
+     * allocated on the thread's NUMA node. Empty leaves threads unpinned.
+     */
+    void SetCores(const std::vector<int>& vCoresIn) { vCores = vCoresIn; }
+    /** Start or join threads until exactly nThreads are running */
+    void SetThreads(int nThreads);
+    int GetThreads() const { return vThreads.size(); }
+
+    /** Hand work to all threads, or park them with nullptr. Returns the new generation. */
+    uint64_t Publish(std::shared_ptr<CMinerWork> work);
+    std::shared_ptr<const CMinerWork> GetWork() const;
+    /** Whether a thread ran out of nonces or saw the clock go back since the last Publish */
+    bool RefreshRequested() const { return fRefresh; }
+    /** Number of threads currently sieving work of the given generation */
+    int CountThreadsOn(uint64_t nGeneration) const;
+
+private:
+    struct MinerThread {
+        std::thread thread;
+        std::atomic<bool> fStop{false};
+        std::atomic<uint64_t> nGeneration{0};
+        std::shared_ptr<CMinerThreadStats> stats;
+    };
+
+    void ThreadMiner(int nThread, int nCore, MinerThread& self);
+    std::shared_ptr<const CMinerWork> WaitForWork(const MinerThread& self, uint64_t nDone);
+
+    const CChainParams& chainparams;
+    mutable std::mutex mutex;
+    std::condition_variable cond;
+    std::shared_ptr<const CMinerWork> workCurrent;
+    std::atomic<uint64_t> nGeneration{0};
+    std::atomic<bool> fRefresh{false};
+    std::atomic<int> nStride{1};
+    //! Changed only by the thread calling SetThreads, under mutex
+    std::vector<std::unique_ptr<MinerThread>> vThreads;
+    std::vector<int> vCores;
+};
+
+/**
+ * Measures sieve configurations one after the other on the live miner
+ * threads, driven from the template builder: applying a candidate changes
+ * nMiningPrimes and nMiningSieveSize, which makes the builder publish work
+ * with it. The shift stays the one set by the operator. First the sieve
+ * size is picked among those that fit the shift, at the default
+ * sieve-primes, then sieve-primes at that size.
+ */
+class CMinerTuner
+{
+public:
+    explicit CMinerTuner(int64_t nSliceMillisIn = MINING_TUNE_SLICE * 1000);
+    ~CMinerTuner();
+
+    void SetEnabled(bool fEnabledIn);
+    CMiningTuneReport GetReport();
+    /** Start tuning, or measure and move to the next candidate once the current one ran long enough */
+    void Step(const CMinerPool& pool);
+
+private:
+    std::mutex cs;
+    //! Time each candidate is measured for at least
+    const int64_t nSliceMillis;
+    std::unique_ptr<PoWUtils> powUtils;
+    CMiningTuneReport report;
+    std::vector<CMiningTuneResult> vCandidates;
+    //! The first candidates, of the sieve sizes; those of sieve-primes follow
+    size_t nSizeCandidates = 0;
+    //! The shift the candidates are for
+    uint16_t nTuneShift = 0;
+    std::vector<uint64_t> vBasePasses;
+    int64_t nStart = 0;
+
+    static CMiningTuneResult Candidate(uint16_t nShift, uint64_t nSieveSize, uint64_t nPrimes);
+    void Apply(const CMiningTuneResult& candidate);
+    int Best() const;
+};
+
+/**
+ * Start, resize or stop the internal miner. Turning generation off parks
+ * the miner threads, keeping their sieves for a quick restart; nThreads 0
+ * releases them.
+ */
 int GenerateGapcoins(bool fGenerate, int nThreads, const CChainParams& chainparams);
 #endif // BITCOIN_MINER_H
@@ -26,6 +26,9 @@
 #else
 #include <fcntl.h>
 #endif
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
 
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
@@ -747,7 +750,7 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
         // get current incomplete message, or create a new one
         if (vRecvMsg.empty() ||
             vRecvMsg.back().complete())
-            vRecvMsg.push_back(CNetMessage(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION));
+            vRecvMsg.emplace_back(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
 
         CNetMessage& msg = vRecvMsg.back();
 
@@ -770,16 +773,7 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
         nBytes -= handled;
 
         if (msg.complete()) {
-
-            //store received bytes per message command
-            //to prevent a memory DOS, only allow valid commands
-            mapMsgCmdSize::iterator i = mapRecvBytesPerMsgCmd.find(msg.hdr.pchCommand);
-            if (i == mapRecvBytesPerMsgCmd.end())
-                i = mapRecvBytesPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
-            assert(i != mapRecvBytesPerMsgCmd.end());
-            i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
-
-            msg.nTime = nTimeMicros;
+            MessageReceived(msg, nTimeMicros);
             complete = true;
         }
     }
@@ -787,6 +781,46 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
     return true;
 }
 
+char* CNode::GetRecvBuffer(unsigned int& nSize)
+{
+    LOCK(cs_vRecv);
+    if (vRecvMsg.empty())
+        return nullptr;
+    CNetMessage& msg = vRecvMsg.back();
+    // Smaller remainders are read along with the messages following them
+    if (!msg.in_data || msg.hdr.nMessageSize - msg.nDataPos < nSize)
+        return nullptr;
+    return msg.GetDataBuffer(nSize);
+}
+
+void CNode::ReceiveMsgBytesInPlace(unsigned int nBytes, bool& complete)
+{
+    complete = false;
+    int64_t nTimeMicros = GetTimeMicros();
+    LOCK(cs_vRecv);
+    nLastRecv = nTimeMicros / 1000000;
+    nRecvBytes += nBytes;
+    CNetMessage& msg = vRecvMsg.back();
+    msg.DataReceived(nBytes);
+    if (msg.complete()) {
+        MessageReceived(msg, nTimeMicros);
+        complete = true;
+    }
+}
+
+void CNode::MessageReceived(CNetMessage& msg, int64_t nTimeMicros)
+{
+    //store received bytes per message command
+    //to prevent a memory DOS, only allow valid commands
+    mapMsgCmdSize::iterator i = mapRecvBytesPerMsgCmd.find(msg.hdr.pchCommand);
+    if (i == mapRecvBytesPerMsgCmd.end())
+        i = mapRecvBytesPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
+    assert(i != mapRecvBytesPerMsgCmd.end());
+    i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
+
+    msg.nTime = nTimeMicros;
+}
+
 void CNode::SetSendVersion(int nVersionIn)
 {
     // Send version may only be changed in the version message, and
@@ -814,6 +848,56 @@ int CNode::GetSendVersion() const
 }
 
 
+/** Payload buffers of processed messages, kept for reuse by large messages */
+static std::mutex cs_recvBufferPool;
+static std::vector<CDataStream> vRecvBufferPool;
+static size_t nRecvBufferPoolSize = 0;
+
+/** Swap the pooled buffer best suited to a payload of nMessageSize bytes into vRecv */
+static void TakePooledRecvBuffer(CDataStream& vRecv, unsigned int nMessageSize)
+{
+    std::lock_guard<std::mutex> lock(cs_recvBufferPool);
+    // The smallest buffer the payload fits in, else the largest one
+    auto best = vRecvBufferPool.end();
+    for (auto it = vRecvBufferPool.begin(); it != vRecvBufferPool.end(); ++it) {
+        if (best == vRecvBufferPool.end()) {
+            best = it;
+            continue;
+        }
+        const bool fFits = it->capacity() >= nMessageSize;
+        const bool fBestFits = best->capacity() >= nMessageSize;
+        if (fFits != fBestFits ? fFits : (fFits ? it->capacity() < best->capacity() : it->capacity() > best->capacity()))
+            best = it;
+    }
+    if (best == vRecvBufferPool.end())
+        return;
+
+    const int nType = vRecv.GetType();
+    const int nVersion = vRecv.GetVersion();
+    nRecvBufferPoolSize -= best->capacity();
+    vRecv = std::move(*best);
+    vRecv.Init(nType, nVersion);
+    vRecvBufferPool.erase(best);
+}
+
+/** Keep the allocation of vRecv for the next large message, if the pool has room */
+static void ReturnPooledRecvBuffer(CDataStream& vRecv)
+{
+    vRecv.clear();
+    std::lock_guard<std::mutex> lock(cs_recvBufferPool);
+    if (nRecvBufferPoolSize + vRecv.capacity() > MAX_RECV_BUFFER_POOL)
+        return;
+    nRecvBufferPoolSize += vRecv.capacity();
+    vRecvBufferPool.push_back(std::move(vRecv));
+}
+
+void ClearRecvBufferPool()
+{
+    std::lock_guard<std::mutex> lock(cs_recvBufferPool);
+    vRecvBufferPool.clear();
+    nRecvBufferPoolSize = 0;
+}
+
 int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
@@ -842,24 +926,51 @@ int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
     // switch state to reading message data
     in_data = true;
 
+    if (hdr.nMessageSize >= MIN_POOLED_RECV_BUFFER)
+        TakePooledRecvBuffer(vRecv, hdr.nMessageSize);
+
     return nCopy;
 }
 
 int CNetMessage::readData(const char *pch, unsigned int nBytes)
 {
-    unsigned int nRemaining = hdr.nMessageSize - nDataPos;
-    unsigned int nCopy = std::min(nRemaining, nBytes);
+    unsigned int nSpace;
+    char* pchData = GetDataBuffer(nSpace);
+    unsigned int nCopy = std::min(nSpace, nBytes);
+
+    memcpy(pchData, pch, nCopy);
+    DataReceived(nCopy);
 
-    if (vRecv.size() < nDataPos + nCopy) {
-        // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
+    return nCopy;
+}
+
+char* CNetMessage::GetDataBuffer(unsigned int& nSize)
+{
+    assert(in_data && !complete());
+    // Allocate up to 256 KiB ahead, but never more than the total message size.
+    const unsigned int nAhead = std::min(hdr.nMessageSize, nDataPos + RECV_ALLOCATE_AHEAD);
+    if (vRecv.size() < nAhead) {
+        // Grow geometrically, but not beyond the message size as resize() would
+        if (vRecv.capacity() < nAhead)
+            vRecv.reserve(std::min<size_t>(hdr.nMessageSize, std::max<size_t>(2 * vRecv.capacity(), nAhead)));
+        vRecv.resize(nAhead);
     }
+    nSize = vRecv.size() - nDataPos;
+    return &vRecv[nDataPos];
+}
 
-    hasher.Write((const unsigned char*)pch, nCopy);
-    memcpy(&vRecv[nDataPos], pch, nCopy);
-    nDataPos += nCopy;
+void CNetMessage::DataReceived(unsigned int nBytes)
+{
+    assert(nDataPos + nBytes <= vRecv.size());
+    // The checksum is computed as the data arrives, while it is still in cache
+    hasher.Write((const unsigned char*)&vRecv[nDataPos], nBytes);
+    nDataPos += nBytes;
+}
 
-    return nCopy;
+CNetMessage::~CNetMessage()
+{
+    if (vRecv.capacity() >= MIN_POOLED_RECV_BUFFER)
+        ReturnPooledRecvBuffer(vRecv);
 }
 
 const uint256& CNetMessage::GetMessageHash() const
@@ -906,6 +1017,7 @@ size_t CConnman::SocketSendData(CNode *pnode) const
                 it++;
             } else {
                 // could not send full message; stop sending more
+                pnode->fCanSendData = false;
                 break;
             }
         } else {
@@ -919,6 +1031,7 @@ size_t CConnman::SocketSendData(CNode *pnode) const
                 }
             }
             // couldn't send anything at all
+            pnode->fCanSendData = false;
             break;
         }
     }
@@ -1143,15 +1256,322 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
 
     LogPrint(BCLog::NET, "connection from %s accepted\n", addr.ToString());
 
+    AddSocketEvents(pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
 }
 
+bool ParseSocketEventsMode(const std::string& str, SocketEventsMode& mode)
+{
+#ifdef USE_POLL
+    if (str == "poll") {
+        mode = SocketEventsMode::POLL;
+        return true;
+    }
+#else
+    if (str == "select") {
+        mode = SocketEventsMode::SELECT;
+        return true;
+    }
+#endif
+#ifdef USE_EPOLL
+    if (str == "epoll") {
+        mode = SocketEventsMode::EPOLL;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::string GetSocketEventsModeName(SocketEventsMode mode)
+{
+    switch (mode) {
+    case SocketEventsMode::SELECT: return "select";
+    case SocketEventsMode::POLL: return "poll";
+    case SocketEventsMode::EPOLL: return "epoll";
+    }
+    assert(false);
+}
+
+std::string GetSupportedSocketEventsModes()
+{
+#ifdef USE_POLL
+    std::string strModes = "poll";
+#else
+    std::string strModes = "select";
+#endif
+#ifdef USE_EPOLL
+    strModes += ", epoll";
+#endif
+    return strModes;
+}
+
+void CConnman::AddSocketEvents(CNode* pnode)
+{
+#ifdef USE_EPOLL
+    if (socketEventsMode != SocketEventsMode::EPOLL)
+        return;
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET)
+        return;
+    // Edge-triggered: an event is only reported when the socket becomes
+    // readable or writable again, so the flags it sets stay until a recv or
+    // send comes up short. Closing the socket removes it from the set.
+    struct epoll_event event = {};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = pnode;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &event) == SOCKET_ERROR) {
+        LogPrintf("socket epoll_ctl error %s\n", NetworkErrorString(WSAGetLastError()));
+        pnode->fDisconnect = true;
+    }
+#endif
+}
+
+void CConnman::SocketEvents(std::vector<const ListenSocket*>& vListenReady, int nTimeout)
+{
+    switch (socketEventsMode) {
+#ifdef USE_EPOLL
+    case SocketEventsMode::EPOLL:
+        SocketEventsEpoll(vListenReady, nTimeout);
+        return;
+#endif
+#ifdef USE_POLL
+    case SocketEventsMode::POLL:
+        SocketEventsPoll(vListenReady, nTimeout);
+        return;
+#endif
+    default:
+        SocketEventsSelect(vListenReady, nTimeout);
+        return;
+    }
+}
+
+void CConnman::SocketEventsSelect(std::vector<const ListenSocket*>& vListenReady, int nTimeout)
+{
+    struct timeval timeout = MillisToTimeval(nTimeout);
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds = false;
+
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        FD_SET(hListenSocket.socket, &fdsetRecv);
+        hSocketMax = std::max(hSocketMax, hListenSocket.socket);
+        have_fds = true;
+    }
+
+    {
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodes)
+        {
+            // Implement the following logic:
+            // * If there is data to send, select() for sending data. As this only
+            //   happens when optimistic write failed, we choose to first drain the
+            //   write buffer in this case before receiving more. This avoids
+            //   needlessly queueing received data, if the remote peer is not themselves
+            //   receiving data. This means properly utilizing TCP flow control signalling.
+            // * Otherwise, if there is space left in the receive buffer, select() for
+            //   receiving data.
+            // * Hand off all complete messages to the processor, to be handled without
+            //   blocking here.
+
+            bool select_recv = !pnode->fPauseRecv;
+            bool select_send;
+            {
+                LOCK(pnode->cs_vSend);
+                select_send = !pnode->vSendMsg.empty();
+            }
+
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+
+            FD_SET(pnode->hSocket, &fdsetError);
+            hSocketMax = std::max(hSocketMax, pnode->hSocket);
+            have_fds = true;
+
+            if (select_send) {
+                FD_SET(pnode->hSocket, &fdsetSend);
+                continue;
+            }
+            if (select_recv) {
+                FD_SET(pnode->hSocket, &fdsetRecv);
+            }
+        }
+    }
+
+    int nSelect = select(have_fds ? hSocketMax + 1 : 0,
+                         &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (interruptNet)
+        return;
+
+    if (nSelect == SOCKET_ERROR)
+    {
+        if (have_fds)
+        {
+            int nErr = WSAGetLastError();
+            LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+            for (unsigned int i = 0; i <= hSocketMax; i++)
+                FD_SET(i, &fdsetRecv);
+        }
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        if (!interruptNet.sleep_for(std::chrono::milliseconds(SOCKET_EVENTS_TIMEOUT)))
+            return;
+    }
+
+    for (const ListenSocket& hListenSocket : vhListenSocket)
+    {
+        if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            vListenReady.push_back(&hListenSocket);
+    }
+
+    LOCK(cs_vNodes);
+    for (CNode* pnode : vNodes)
+    {
+        bool recvSet = false;
+        bool sendSet = false;
+        {
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+            recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError);
+            sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
+        }
+        pnode->fHasRecvData = recvSet;
+        LOCK(pnode->cs_vSend);
+        pnode->fCanSendData = sendSet;
+    }
+}
+
+#ifdef USE_POLL
+void CConnman::SocketEventsPoll(std::vector<const ListenSocket*>& vListenReady, int nTimeout)
+{
+    std::vector<struct pollfd> vPollFds;
+    // Nodes are only deleted by this thread, so these outlive the wait
+    std::vector<CNode*> vPollNodes;
+
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        struct pollfd pollfd = {};
+        pollfd.fd = hListenSocket.socket;
+        pollfd.events = POLLIN;
+        vPollFds.push_back(pollfd);
+    }
+
+    {
+        LOCK(cs_vNodes);
+        vPollFds.reserve(vPollFds.size() + vNodes.size());
+        vPollNodes.reserve(vNodes.size());
+        for (CNode* pnode : vNodes)
+        {
+            // As with select(), pending sends are drained before receiving more
+            bool poll_recv = !pnode->fPauseRecv;
+            bool poll_send;
+            {
+                LOCK(pnode->cs_vSend);
+                poll_send = !pnode->vSendMsg.empty();
+            }
+
+            struct pollfd pollfd = {};
+            {
+                LOCK(pnode->cs_hSocket);
+                if (pnode->hSocket == INVALID_SOCKET)
+                    continue;
+                pollfd.fd = pnode->hSocket;
+            }
+            // Errors and hangups are reported whatever is asked for
+            pollfd.events = poll_send ? POLLOUT : (poll_recv ? POLLIN : 0);
+            vPollFds.push_back(pollfd);
+            vPollNodes.push_back(pnode);
+        }
+    }
+
+    int nPoll = poll(vPollFds.data(), vPollFds.size(), nTimeout);
+    if (interruptNet)
+        return;
+
+    if (nPoll == SOCKET_ERROR)
+    {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR) {
+            LogPrintf("socket poll error %s\n", NetworkErrorString(nErr));
+            interruptNet.sleep_for(std::chrono::milliseconds(SOCKET_EVENTS_TIMEOUT));
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < vhListenSocket.size(); i++) {
+        if (vPollFds[i].revents & POLLIN)
+            vListenReady.push_back(&vhListenSocket[i]);
+    }
+    for (size_t i = 0; i < vPollNodes.size(); i++) {
+        CNode* pnode = vPollNodes[i];
+        const short revents = vPollFds[vhListenSocket.size() + i].revents;
+        pnode->fHasRecvData = revents & (POLLIN | POLLERR | POLLHUP);
+        LOCK(pnode->cs_vSend);
+        pnode->fCanSendData = revents & POLLOUT;
+    }
+}
+#endif
+
+#ifdef USE_EPOLL
+void CConnman::SocketEventsEpoll(std::vector<const ListenSocket*>& vListenReady, int nTimeout)
+{
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int nEvents = epoll_wait(epollfd, events, MAX_EPOLL_EVENTS, nTimeout);
+    if (interruptNet)
+        return;
+
+    if (nEvents == SOCKET_ERROR)
+    {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR) {
+            LogPrintf("socket epoll error %s\n", NetworkErrorString(nErr));
+            interruptNet.sleep_for(std::chrono::milliseconds(SOCKET_EVENTS_TIMEOUT));
+        }
+        return;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+        const struct epoll_event& event = events[i];
+        const ListenSocket* pListenSocket = nullptr;
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            if (event.data.ptr == &hListenSocket) {
+                pListenSocket = &hListenSocket;
+                break;
+            }
+        }
+        if (pListenSocket) {
+            vListenReady.push_back(pListenSocket);
+            continue;
+        }
+
+        // A node's socket is closed, and so no longer reported, before this
+        // thread deletes the node
+        CNode* pnode = static_cast<CNode*>(event.data.ptr);
+        if (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            pnode->fHasRecvData = true;
+        if (event.events & (EPOLLOUT | EPOLLERR)) {
+            LOCK(pnode->cs_vSend);
+            pnode->fCanSendData = true;
+        }
+    }
+}
+#endif
+
 void CConnman::ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+    // Set when a node may have more to read right away, so the next wait must not block
+    bool fMoreWork = false;
+    std::vector<const ListenSocket*> vListenReady;
     while (!interruptNet)
     {
         //
@@ -1216,96 +1636,20 @@ void CConnman::ThreadSocketHandler()
         }
 
         //
-        // Find which sockets have data to receive
+        // Wait for sockets to become readable or writable
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        for (const ListenSocket& hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
-
-        {
-            LOCK(cs_vNodes);
-            for (CNode* pnode : vNodes)
-            {
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
-                //   receiving data.
-                // * Hand off all complete messages to the processor, to be handled without
-                //   blocking here.
-
-                bool select_recv = !pnode->fPauseRecv;
-                bool select_send;
-                {
-                    LOCK(pnode->cs_vSend);
-                    select_send = !pnode->vSendMsg.empty();
-                }
-
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
-            }
-        }
-
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        vListenReady.clear();
+        SocketEvents(vListenReady, fMoreWork ? 0 : SOCKET_EVENTS_TIMEOUT);
         if (interruptNet)
             return;
-
-        if (nSelect == SOCKET_ERROR)
-        {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
-                return;
-        }
+        fMoreWork = false;
 
         //
         // Accept new connections
         //
-        for (const ListenSocket& hListenSocket : vhListenSocket)
+        for (const ListenSocket* pListenSocket : vListenReady)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
-            {
-                AcceptConnection(hListenSocket);
-            }
+            AcceptConnection(*pListenSocket);
         }
 
         //
@@ -1328,30 +1672,43 @@ void CConnman::ThreadSocketHandler()
             //
             bool recvSet = false;
             bool sendSet = false;
-            bool errorSet = false;
             {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+                LOCK(pnode->cs_vSend);
+                // As when waiting, a pending send is drained before receiving more
+                recvSet = pnode->vSendMsg.empty() && pnode->fHasRecvData && !pnode->fPauseRecv;
+                sendSet = !pnode->vSendMsg.empty() && pnode->fCanSendData;
             }
-            if (recvSet || errorSet)
+            if (recvSet)
             {
                 // typical socket buffer is 8K-64K
                 char pchBuf[0x10000];
+                // The bulk of a large payload is read straight into its message
+                unsigned int nRecvSize = sizeof(pchBuf);
+                char* pchRecv = pnode->GetRecvBuffer(nRecvSize);
+                const bool fInPlace = pchRecv != nullptr;
+                if (!fInPlace) {
+                    pchRecv = pchBuf;
+                    nRecvSize = sizeof(pchBuf);
+                }
                 int nBytes = 0;
                 {
                     LOCK(pnode->cs_hSocket);
                     if (pnode->hSocket == INVALID_SOCKET)
                         continue;
-                    nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+                    nBytes = recv(pnode->hSocket, pchRecv, nRecvSize, MSG_DONTWAIT);
                 }
                 if (nBytes > 0)
                 {
+                    // A short read drained the socket. After a full one there
+                    // may be more, which epoll will not report again.
+                    if ((unsigned int)nBytes < nRecvSize)
+                        pnode->fHasRecvData = false;
+                    else
+                        fMoreWork = true;
                     bool notify = false;
-                    if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
+                    if (fInPlace)
+                        pnode->ReceiveMsgBytesInPlace(nBytes, notify);
+                    else if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
                         pnode->CloseSocketDisconnect();
                     RecordBytesRecv(nBytes);
                     if (notify) {
@@ -1382,6 +1739,7 @@ void CConnman::ThreadSocketHandler()
                 else if (nBytes < 0)
                 {
                     // error
+                    pnode->fHasRecvData = false;
                     int nErr = WSAGetLastError();
                     if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
                     {
@@ -1987,6 +2345,7 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         pnode->m_manual_connection = true;
 
     m_msgproc->InitializeNode(pnode);
+    AddSocketEvents(pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
@@ -2203,6 +2562,7 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
     nLastNodeId = 0;
     nSendBufferMaxSize = 0;
     nReceiveFloodSize = 0;
+    epollfd = -1;
     flagInterruptMsgProc = false;
     SetTryNewOutboundPeer(false);
 
@@ -2270,6 +2630,29 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         return false;
     }
 
+#ifdef USE_EPOLL
+    if (socketEventsMode == SocketEventsMode::EPOLL) {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1) {
+            LogPrintf("epoll_create1 failed: %s, falling back to poll\n", NetworkErrorString(WSAGetLastError()));
+            socketEventsMode = SocketEventsMode::POLL;
+        }
+    }
+    if (socketEventsMode == SocketEventsMode::EPOLL) {
+        // Listening sockets stay level-triggered, one connection is accepted per wait
+        for (ListenSocket& hListenSocket : vhListenSocket) {
+            struct epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.ptr = &hListenSocket;
+            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hListenSocket.socket, &event) == SOCKET_ERROR) {
+                LogPrintf("socket epoll_ctl error %s\n", NetworkErrorString(WSAGetLastError()));
+                return false;
+            }
+        }
+    }
+#endif
+    LogPrintf("Using %s for socket events\n", GetSocketEventsModeName(socketEventsMode));
+
     for (const auto& strDest : connOptions.vSeedNodes) {
         AddOneShot(strDest);
     }
@@ -2430,6 +2813,12 @@ void CConnman::Stop()
         if (hListenSocket.socket != INVALID_SOCKET)
             if (!CloseSocket(hListenSocket.socket))
                 LogPrintf("CloseSocket(hListenSocket) failed with error %s\n", NetworkErrorString(WSAGetLastError()));
+#ifdef USE_EPOLL
+    if (epollfd != -1) {
+        close(epollfd);
+        epollfd = -1;
+    }
+#endif
 
     // clean up some globals (to help leak detection)
     for (CNode *pnode : vNodes) {
@@ -2742,6 +3131,8 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nextSendTimeFeeFilter = 0;
     fPauseRecv = false;
     fPauseSend = false;
+    fHasRecvData = false;
+    fCanSendData = true;
     nProcessQueueSize = 0;
 
     for (const std::string &msg : getAllNetMessageTypes())
@@ -83,6 +83,37 @@ static const bool DEFAULT_BLOCKSONLY = false;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Longest the socket handler waits for socket events before looking for nodes to disconnect (in milliseconds) */
+static const int SOCKET_EVENTS_TIMEOUT = 50;
+/** Most events taken from epoll at once; the rest are picked up by the next wait */
+static const int MAX_EPOLL_EVENTS = 1024;
+/** Payload space allocated ahead of the received data, so a false message size cannot make us allocate much */
+static const unsigned int RECV_ALLOCATE_AHEAD = 256 * 1024;
+/** Payload buffers at least this large are kept for reuse once their message is processed */
+static const size_t MIN_POOLED_RECV_BUFFER = 64 * 1024;
+/** Most memory held by payload buffers waiting for reuse */
+static const size_t MAX_RECV_BUFFER_POOL = 16 * 1024 * 1024;
+
+/** How the socket handler waits for socket events */
+enum class SocketEventsMode {
+    SELECT, //!< select(), limited to FD_SETSIZE sockets
+    POLL,   //!< poll() over all sockets, without the FD_SETSIZE limit
+    EPOLL,  //!< edge-triggered epoll, sockets registered once
+};
+
+#if defined(USE_EPOLL)
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SocketEventsMode::EPOLL;
+#elif defined(USE_POLL)
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SocketEventsMode::POLL;
+#else
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SocketEventsMode::SELECT;
+#endif
+
+/** Parse a -socketevents value; fails for modes this build does not support */
+bool ParseSocketEventsMode(const std::string& str, SocketEventsMode& mode);
+std::string GetSocketEventsModeName(SocketEventsMode mode);
+/** The -socketevents values this build supports, for the help text */
+std::string GetSupportedSocketEventsModes();
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
@@ -137,6 +168,7 @@ public:
         NetEventsInterface* m_msgproc = nullptr;
         unsigned int nSendBufferMaxSize = 0;
         unsigned int nReceiveFloodSize = 0;
+        SocketEventsMode socketEventsMode = DEFAULT_SOCKETEVENTS;
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
         std::vector<std::string> vSeedNodes;
@@ -158,6 +190,7 @@ public:
         m_msgproc = connOptions.m_msgproc;
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
+        socketEventsMode = connOptions.socketEventsMode;
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -331,6 +364,21 @@ private:
     void ThreadOpenConnections(std::vector<std::string> connect);
     void ThreadMessageHandler();
     void AcceptConnection(const ListenSocket& hListenSocket);
+    /** Register the socket of a new node with epoll; the node is disconnected if this fails */
+    void AddSocketEvents(CNode* pnode);
+    /**
+     * Wait up to nTimeout milliseconds for socket events and record them in
+     * the fHasRecvData and fCanSendData flags of the nodes. The listening
+     * sockets with connections to accept are added to vListenReady.
+     */
+    void SocketEvents(std::vector<const ListenSocket*>& vListenReady, int nTimeout);
+    void SocketEventsSelect(std::vector<const ListenSocket*>& vListenReady, int nTimeout);
+#ifdef USE_POLL
+    void SocketEventsPoll(std::vector<const ListenSocket*>& vListenReady, int nTimeout);
+#endif
+#ifdef USE_EPOLL
+    void SocketEventsEpoll(std::vector<const ListenSocket*>& vListenReady, int nTimeout);
+#endif
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
 
@@ -387,6 +435,9 @@ private:
     unsigned int nReceiveFloodSize;
 
     std::vector<ListenSocket> vhListenSocket;
+    SocketEventsMode socketEventsMode;
+    //! The epoll instance all sockets are registered with, in SocketEventsMode::EPOLL
+    int epollfd;
     std::atomic<bool> fNetworkActive;
     banmap_t setBanned;
     CCriticalSection cs_setBanned;
@@ -576,6 +627,10 @@ public:
         nDataPos = 0;
         nTime = 0;
     }
+    /** Hands a large payload buffer to the pool for the next large message */
+    ~CNetMessage();
+    CNetMessage(CNetMessage&&) = default;
+    CNetMessage& operator=(CNetMessage&&) = default;
 
     bool complete() const
     {
@@ -594,8 +649,19 @@ public:
 
     int readHeader(const char *pch, unsigned int nBytes);
     int readData(const char *pch, unsigned int nBytes);
+
+    /**
+     * Space in vRecv for the next nSize bytes of the payload, so they can be
+     * received into it directly. Requires in_data && !complete().
+     */
+    char* GetDataBuffer(unsigned int& nSize);
+    /** Account for nBytes written to the space returned by GetDataBuffer */
+    void DataReceived(unsigned int nBytes);
 };
 
+/** Drop the pooled payload buffers, for tests that need to start from an empty pool */
+void ClearRecvBufferPool();
+
 
 /** Information about a peer */
 class CNode
@@ -660,6 +726,11 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // Set when the socket may have data to read and cleared once a read drains
+    // it. Only used by the socket handler thread.
+    bool fHasRecvData;
+    // Set when the socket may take more data and cleared once a send blocks
+    bool fCanSendData; // protected by cs_vSend
 protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -733,6 +804,8 @@ private:
     const int nMyStartingHeight;
     int nSendVersion;
     std::list<CNetMessage> vRecvMsg;  // Used only by SocketHandler thread
+    // Account for msg having been received completely; requires cs_vRecv
+    void MessageReceived(CNetMessage& msg, int64_t nTimeMicros);
 
     mutable CCriticalSection cs_addrName;
     std::string addrName;
@@ -761,6 +834,13 @@ public:
     }
 
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete);
+    /**
+     * Where the rest of the payload being received can be read to directly, if
+     * at least nSize bytes of it are missing. nSize is set to the space there.
+     */
+    char* GetRecvBuffer(unsigned int& nSize);
+    /** Like ReceiveMsgBytes, for nBytes read to the space from GetRecvBuffer */
+    void ReceiveMsgBytesInPlace(unsigned int nBytes, bool& complete);
 
     void SetRecvVersion(int nVersionIn)
     {
@@ -18,6 +18,7 @@
 #include <netbase.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
+#include <pow.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <random.h>
@@ -162,6 +163,12 @@ struct CNodeState {
     int nMisbehavior;
     //! Whether this peer should be disconnected and banned (unless whitelisted).
     bool fShouldBan;
+    //! Time spent verifying the proofs of work this peer sent us, in microseconds.
+    int64_t nPoWCheckMicros;
+    //! Part of it wasted on invalid headers and blocks, drained by -maxpowchecktime per minute.
+    int64_t nPoWCheckWasted;
+    //! When nPoWCheckWasted was last drained, in microseconds.
+    int64_t nPoWCheckDrained;
     //! String name of this peer (debugging/logging purposes).
     const std::string name;
     //! List of asynchronously-determined block rejections to notify this peer about.
@@ -243,6 +250,9 @@ struct CNodeState {
         fCurrentlyConnected = false;
         nMisbehavior = 0;
         fShouldBan = false;
+        nPoWCheckMicros = 0;
+        nPoWCheckWasted = 0;
+        nPoWCheckDrained = GetTimeMicros();
         pindexBestKnownBlock = nullptr;
         hashLastUnknownBlock.SetNull();
         pindexLastCommonBlock = nullptr;
@@ -620,6 +630,7 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
     if (state == nullptr)
         return false;
     stats.nMisbehavior = state->nMisbehavior;
+    stats.nPoWCheckMicros = state->nPoWCheckMicros;
     stats.nSyncHeight = state->pindexBestKnownBlock ? state->pindexBestKnownBlock->nHeight : -1;
     stats.nCommonHeight = state->pindexLastCommonBlock ? state->pindexLastCommonBlock->nHeight : -1;
     for (const QueuedBlock& queue : state->vBlocksInFlight) {
@@ -771,6 +782,43 @@ void Misbehaving(NodeId pnode, int howmuch)
         LogPrintf("%s: %s peer=%d (%d -> %d)\n", __func__, state->name, pnode, state->nMisbehavior-howmuch, state->nMisbehavior);
 }
 
+/**
+ * Account nMicros of proof-of-work verification to a peer. Time spent on
+ * headers and blocks that turned out invalid (fWasted) fills a bucket that
+ * drains by -maxpowchecktime every minute; a peer overflowing it costs us
+ * more CPU than any valid chain would and is disconnected.
+ */
+static void ChargePoWCheck(CNode* pnode, int64_t nMicros, bool fWasted) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    CNodeState *state = State(pnode->GetId());
+    if (state == nullptr || nMicros <= 0)
+        return;
+
+    state->nPoWCheckMicros += nMicros;
+    if (!fWasted)
+        return;
+
+    // The bucket is empty after a minute, so the time since it was last
+    // drained is capped there; with the budget bounded too, the product
+    // below cannot overflow however long the peer was quiet
+    int64_t nBudget = std::min<int64_t>(std::max<int64_t>(0, gArgs.GetArg("-maxpowchecktime", DEFAULT_MAX_POW_CHECK_TIME)), MAX_POW_CHECK_TIME) * 1000;
+    int64_t nNow = GetTimeMicros();
+    int64_t nElapsed = std::min<int64_t>(std::max<int64_t>(0, nNow - state->nPoWCheckDrained), 60 * 1000000);
+    int64_t nDrained = nElapsed * nBudget / (60 * 1000000);
+    state->nPoWCheckWasted = std::max<int64_t>(0, state->nPoWCheckWasted - nDrained) + nMicros;
+    state->nPoWCheckDrained = nNow;
+    if (state->nPoWCheckWasted <= nBudget)
+        return;
+
+    if (pnode->fWhitelisted || pnode->m_manual_connection) {
+        LogPrintf("Warning: peer=%d wasted %dms on proof-of-work checks, not disconnecting whitelisted or manual peer\n", pnode->GetId(), state->nPoWCheckWasted / 1000);
+        state->nPoWCheckWasted = 0;
+        return;
+    }
+    LogPrintf("peer=%d wasted %dms on proof-of-work checks, disconnecting\n", pnode->GetId(), state->nPoWCheckWasted / 1000);
+    pnode->fDisconnect = true;
+}
+
 
 
 
@@ -1332,7 +1380,13 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
 
     CValidationState state;
     CBlockHeader first_invalid_header;
-    if (!ProcessNewBlockHeaders(headers, state, chainparams, &pindexLast, &first_invalid_header)) {
+    int64_t nPoWCheckMicros = GetPoWCheckMicros();
+    bool fAccepted = ProcessNewBlockHeaders(headers, state, chainparams, &pindexLast, &first_invalid_header);
+    {
+        LOCK(cs_main);
+        ChargePoWCheck(pfrom, GetPoWCheckMicros() - nPoWCheckMicros, !fAccepted);
+    }
+    if (!fAccepted) {
         int nDoS;
         if (state.IsInvalid(nDoS)) {
             LOCK(cs_main);
@@ -2317,7 +2371,13 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
         const CBlockIndex *pindex = nullptr;
         CValidationState state;
-        if (!ProcessNewBlockHeaders({cmpctblock.header}, state, chainparams, &pindex)) {
+        int64_t nPoWCheckMicros = GetPoWCheckMicros();
+        bool fAccepted = ProcessNewBlockHeaders({cmpctblock.header}, state, chainparams, &pindex);
+        {
+            LOCK(cs_main);
+            ChargePoWCheck(pfrom, GetPoWCheckMicros() - nPoWCheckMicros, !fAccepted);
+        }
+        if (!fAccepted) {
             int nDoS;
             if (state.IsInvalid(nDoS)) {
                 if (nDoS > 0) {
@@ -2636,7 +2696,12 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             mapBlockSource.emplace(hash, std::make_pair(pfrom->GetId(), true));
         }
         bool fNewBlock = false;
-        ProcessNewBlock(chainparams, pblock, forceProcessing, &fNewBlock);
+        int64_t nPoWCheckMicros = GetPoWCheckMicros();
+        bool fAccepted = ProcessNewBlock(chainparams, pblock, forceProcessing, &fNewBlock);
+        {
+            LOCK(cs_main);
+            ChargePoWCheck(pfrom, GetPoWCheckMicros() - nPoWCheckMicros, !fAccepted);
+        }
         if (fNewBlock) {
             pfrom->nLastBlockTime = GetTime();
         } else {
@@ -34,6 +34,10 @@ static constexpr int64_t STALE_CHECK_INTERVAL = 10 * 60; // 10 minutes
 static constexpr int64_t EXTRA_PEER_CHECK_INTERVAL = 45;
 /** Minimum time an outbound-peer-eviction candidate must be connected for, in order to evict, in seconds */
 static constexpr int64_t MINIMUM_CONNECT_TIME = 30;
+/** Default for -maxpowchecktime: milliseconds of proof-of-work verification a peer may waste on invalid headers and blocks per minute */
+static constexpr int64_t DEFAULT_MAX_POW_CHECK_TIME = 5000;
+/** Largest -maxpowchecktime taken into account: an hour per minute */
+static constexpr int64_t MAX_POW_CHECK_TIME = 60 * 60 * 1000;
 
 class PeerLogicValidation : public CValidationInterface, public NetEventsInterface {
 private:
@@ -71,6 +75,7 @@ private:
 
 struct CNodeStateStats {
     int nMisbehavior;
+    int64_t nPoWCheckMicros;
     int nSyncHeight;
     int nCommonHeight;
     std::vector<int> vHeightInFlight;
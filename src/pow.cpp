@@ -10,6 +10,7 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <chainparamsbase.h>
+#include <fermat.h>
 #include <primitives/block.h>
 #include <uint256.h>
 #include <util.h>
@@ -68,15 +69,126 @@ uint64_t GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHeader *
     return nextDifficulty;
 }
 
-bool CheckProofOfWork(const uint256 hash, const uint16_t nShift, const std::vector<uint8_t> *const nAdd, const uint64_t nDifficulty, const Consensus::Params& params)
+/** Number of significant bits of a little-endian adder */
+static unsigned int AdderBits(const std::vector<uint8_t>& nAdd)
 {
-    std::vector<uint8_t> vHash(hash.begin(), hash.end());
+    for (size_t i = nAdd.size(); i > 0; i--) {
+        if (nAdd[i - 1] != 0) {
+            unsigned int nBits = 8 * (i - 1);
+            for (uint8_t n = nAdd[i - 1]; n != 0; n >>= 1)
+                nBits++;
+            return nBits;
+        }
+    }
+    return 0;
+}
+
+bool CheckProofOfWorkBounds(const uint16_t nShift, const std::vector<uint8_t>& nAdd, const uint64_t nDifficulty)
+{
+    // Without a claimed difficulty there is no gap to prove
+    if (nDifficulty == 0)
+        return true;
+
+    // The adder only fills the low nShift bits of the gap start
+    if (AdderBits(nAdd) > nShift)
+        return false;
+
+    // An even start (hash * 2^nShift + adder) is never the prime a gap starts at
+    if (nShift > 0 && (nAdd.empty() || (nAdd[0] & 1) == 0))
+        return false;
 
-    PoW pow(&vHash, nShift, nAdd, nDifficulty);
+    return true;
+}
+
+/** Whether a base 2 Fermat test proves the gap start hash * 2^nShift + nAdd composite */
+static bool IsGapStartComposite(const uint256& hash, const uint16_t nShift, const std::vector<uint8_t>& nAdd)
+{
+    mpz_t mpzStart, mpzAdd;
+    mpz_init(mpzStart);
+    mpz_init(mpzAdd);
+    mpz_import(mpzStart, hash.size(), -1, 1, 0, 0, hash.begin());
+    mpz_mul_2exp(mpzStart, mpzStart, nShift);
+    if (!nAdd.empty())
+        mpz_import(mpzAdd, nAdd.size(), -1, 1, 0, 0, nAdd.data());
+    mpz_add(mpzStart, mpzStart, mpzAdd);
+    // A failed Fermat test proves the start composite; below 4 leave it to PoWCore
+    bool fComposite = mpz_cmp_ui(mpzStart, 3) > 0 && !FermatTest(mpzStart);
+    mpz_clear(mpzStart);
+    mpz_clear(mpzAdd);
+    return fComposite;
+}
+
+static thread_local int64_t nThreadPoWCheckMicros = 0;
+
+/**
+ * Run the checks from cheapest to most expensive: the field bounds, a
+ * base 2 Fermat test of the gap start and only then PoWCore's search for
+ * the end of the gap. Adds the time spent past the bounds to nMicros.
+ */
+static bool CheckProofOfWorkStaged(const uint256& hash, const uint16_t nShift, const std::vector<uint8_t>& nAdd, const uint64_t nDifficulty, int64_t& nMicros)
+{
+    if (!CheckProofOfWorkBounds(nShift, nAdd, nDifficulty))
+        return error("CheckProofOfWork() : shift %u and adder out of bounds", nShift);
+
+    int64_t nStart = GetTimeMicros();
+    if (nDifficulty != 0 && IsGapStartComposite(hash, nShift, nAdd)) {
+        nMicros += GetTimeMicros() - nStart;
+        return error("CheckProofOfWork() : gap start is not prime");
+    }
+
+    std::vector<uint8_t> vHash(hash.begin(), hash.end());
+    PoW pow(&vHash, nShift, &nAdd, nDifficulty);
 
     // Check proof of work matches claimed amount
-    if (!pow.valid())
+    bool fValid = pow.valid();
+    nMicros += GetTimeMicros() - nStart;
+    if (!fValid)
         return error("CheckProofOfWork() : hash does not match nDifficulty");
 
     return true;
 }
+
+bool CheckProofOfWork(const uint256 hash, const uint16_t nShift, const std::vector<uint8_t> *const nAdd, const uint64_t nDifficulty, const Consensus::Params& params)
+{
+    return CheckProofOfWorkStaged(hash, nShift, *nAdd, nDifficulty, nThreadPoWCheckMicros);
+}
+
+bool CheckShareProofOfWork(const uint256& hash, const uint16_t nShift, const std::vector<uint8_t>& nAdd, const uint64_t nShareDifficulty, uint64_t& nMerit)
+{
+    nMerit = 0;
+    if (nShareDifficulty == 0 || !CheckProofOfWorkBounds(nShift, nAdd, nShareDifficulty))
+        return false;
+    if (IsGapStartComposite(hash, nShift, nAdd))
+        return false;
+
+    std::vector<uint8_t> vHash(hash.begin(), hash.end());
+    PoW pow(&vHash, nShift, &nAdd, nShareDifficulty);
+    if (!pow.valid())
+        return false;
+    nMerit = pow.merit();
+    return true;
+}
+
+int64_t GetPoWCheckMicros()
+{
+    return nThreadPoWCheckMicros;
+}
+
+void AddPoWCheckMicros(int64_t nMicros)
+{
+    nThreadPoWCheckMicros += nMicros;
+}
+
+CPoWCheck::CPoWCheck(const CBlockHeader& header, const Consensus::Params& paramsIn, std::atomic<int64_t>* pnMicrosIn) :
+    hash(header.GetHash()), nShift(header.nShift), nAdd(header.nAdd), nDifficulty(header.nDifficulty), params(&paramsIn), pnMicros(pnMicrosIn)
+{
+}
+
+bool CPoWCheck::operator()()
+{
+    int64_t nMicros = 0;
+    bool fValid = CheckProofOfWorkStaged(hash, nShift, nAdd, nDifficulty, nMicros);
+    if (pnMicros)
+        *pnMicros += nMicros;
+    return fValid;
+}
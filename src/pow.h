@@ -8,19 +8,81 @@
 #define BITCOIN_POW_H
 
 #include <consensus/params.h>
+#include <uint256.h>
 #include <PoWCore/src/PoW.h>
 
+#include <atomic>
 #include <stdint.h>
+#include <vector>
 
 class CBlockHeader;
 class CBlockIndex;
-class uint256;
 
 bool TestNet();
 
 uint64_t GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params&);
 
-/** Check whether a block hash satisfies the proof-of-work requirement specified by nDifficulty */
+/**
+ * Check whether a block hash satisfies the proof-of-work requirement specified by nDifficulty.
+ * Bogus headers are turned away by the cheapest check that catches them:
+ * CheckProofOfWorkBounds, then a base 2 Fermat test of the gap start, and
+ * only then the full gap.
+ */
 bool CheckProofOfWork(const uint256 hash, const uint16_t nShift, const std::vector<uint8_t> *const nAdd, const uint64_t nDifficulty, const Consensus::Params&);
 
+/**
+ * Checks on nShift and the (little-endian) adder that need no arithmetic on
+ * the gap itself: the adder has to fit in nShift bits and make the gap start
+ * odd. Everything failing these fails CheckProofOfWork as well.
+ */
+bool CheckProofOfWorkBounds(const uint16_t nShift, const std::vector<uint8_t>& nAdd, const uint64_t nDifficulty);
+
+/**
+ * Check a pool share: the gap proven by hash, nShift and nAdd has to reach
+ * nShareDifficulty, which is below the network difficulty the header
+ * claims. Runs the stages of CheckProofOfWork without logging. On success
+ * nMerit is the merit of the gap, in the same fixed point as nDifficulty.
+ */
+bool CheckShareProofOfWork(const uint256& hash, const uint16_t nShift, const std::vector<uint8_t>& nAdd, const uint64_t nShareDifficulty, uint64_t& nMerit);
+
+/**
+ * Time the calling thread spent in CheckProofOfWork past the bounds checks,
+ * in microseconds. Batches it ran on the PoW check threads are added with
+ * AddPoWCheckMicros.
+ */
+int64_t GetPoWCheckMicros();
+void AddPoWCheckMicros(int64_t nMicros);
+
+/**
+ * Closure representing one header's proof of work check, so a batch of
+ * headers can be verified on a CCheckQueue. The header fields are copied:
+ * the check may outlive the header it was built from while it sits in the
+ * queue. The time spent is added to *pnMicros, if given.
+ */
+class CPoWCheck
+{
+private:
+    uint256 hash;
+    uint16_t nShift;
+    std::vector<uint8_t> nAdd;
+    uint64_t nDifficulty;
+    const Consensus::Params* params;
+    std::atomic<int64_t>* pnMicros;
+
+public:
+    CPoWCheck(): nShift(0), nDifficulty(0), params(nullptr), pnMicros(nullptr) {}
+    CPoWCheck(const CBlockHeader& header, const Consensus::Params& paramsIn, std::atomic<int64_t>* pnMicrosIn = nullptr);
+
+    bool operator()();
+
+    void swap(CPoWCheck& check) {
+        std::swap(hash, check.hash);
+        std::swap(nShift, check.nShift);
+        nAdd.swap(check.nAdd);
+        std::swap(nDifficulty, check.nDifficulty);
+        std::swap(params, check.params);
+        std::swap(pnMicros, check.pnMicros);
+    }
+};
+
 #endif // BITCOIN_POW_H
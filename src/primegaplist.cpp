@@ -0,0 +1,164 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <primegaplist.h>
+
+#include <util.h>
+#include <utiltime.h>
+
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/version.hpp>
+
+namespace {
+
+const char* const PRIMEGAPLIST_HOST = "raw.githubusercontent.com";
+
+std::mutex cs_primegaplist;
+std::shared_ptr<const CPrimeGapList> primeGapList;
+
+} // namespace
+
+fs::path GetPrimeGapListFile()
+{
+    fs::path path(gArgs.GetArg("-primegaplist", DEFAULT_PRIMEGAPLIST_FILE));
+    if (!path.is_complete())
+        path = GetDataDir() / path;
+    return path;
+}
+
+std::shared_ptr<const CPrimeGapList> GetPrimeGapList(std::string& strError)
+{
+    {
+        std::lock_guard<std::mutex> lock(cs_primegaplist);
+        if (primeGapList)
+            return primeGapList;
+    }
+    return LoadPrimeGapList(GetPrimeGapListFile(), strError);
+}
+
+std::shared_ptr<const CPrimeGapList> LoadPrimeGapList(const fs::path& path, std::string& strError)
+{
+    std::ifstream file(path.string());
+    if (!file.is_open()) {
+        strError = "Cannot open " + path.string() + ", see refreshprimegaplist";
+        return nullptr;
+    }
+
+    std::shared_ptr<CPrimeGapList> list = std::make_shared<CPrimeGapList>();
+    list->path = path;
+    list->nLoadTime = GetTime();
+
+    const std::string target = "INSERT INTO gaps VALUES(";
+    std::string line;
+    std::vector<std::string> cells;
+    while (std::getline(file, line)) {
+        std::size_t ge = line.find(target);
+        if (ge == std::string::npos)
+            continue;
+        std::string entry = line.substr(ge + target.length());
+        boost::split(cells, entry, boost::is_any_of(","));
+        try {
+            if (cells.size() > 7)
+                list->mapRecords[std::stoi(cells[0])] = std::stof(cells[7]);
+        } catch (const std::exception&) {
+            // Not a record row
+        }
+    }
+    if (list->mapRecords.empty()) {
+        strError = "No prime gap records in " + path.string();
+        return nullptr;
+    }
+    LogPrintf("Loaded %u prime gap records from %s\n", list->mapRecords.size(), path.string());
+
+    std::lock_guard<std::mutex> lock(cs_primegaplist);
+    primeGapList = list;
+    return list;
+}
+
+bool DownloadPrimeGapList(const fs::path& path, std::string& strError)
+{
+    std::string response;
+    try {
+        boost::system::error_code ec;
+        boost::asio::io_service svc;
+        boost::asio::ssl::context ctx(boost::asio::ssl::context::tls);
+        // The list is only taken from the host whose certificate the system trusts
+        ctx.set_default_verify_paths();
+        boost::asio::ssl::stream<boost::asio::ip::tcp::socket> ssock(svc, ctx);
+        ssock.set_verify_mode(boost::asio::ssl::verify_peer);
+#if BOOST_VERSION >= 107300
+        ssock.set_verify_callback(boost::asio::ssl::host_name_verification(PRIMEGAPLIST_HOST));
+#else
+        ssock.set_verify_callback(boost::asio::ssl::rfc2818_verification(PRIMEGAPLIST_HOST));
+#endif
+        // Name the host, the server has many
+        if (!SSL_set_tlsext_host_name(ssock.native_handle(), PRIMEGAPLIST_HOST)) {
+            strError = "Cannot set the TLS server name";
+            return false;
+        }
+        boost::asio::ip::tcp::resolver resolver(svc);
+        auto it = resolver.resolve({PRIMEGAPLIST_HOST, "443"});
+        boost::asio::connect(ssock.lowest_layer(), it);
+
+        ssock.handshake(boost::asio::ssl::stream_base::handshake_type::client);
+
+        std::stringstream request;
+        request << "GET /primegap-list-project/prime-gap-list/master/allgaps.sql HTTP/1.1\r\n";
+        request << "Host: " << PRIMEGAPLIST_HOST << "\r\n";
+        request << "Accept-Encoding: identity\r\n";
+        request << "Connection: close\r\n";
+        request << "\r\n";
+
+        boost::asio::write(ssock, boost::asio::buffer(request.str()));
+
+        std::size_t nBody = std::string::npos;
+        std::size_t content_length = std::string::npos;
+        do {
+            char buf[8192];
+            size_t bytes_transferred = ssock.read_some(boost::asio::buffer(buf), ec);
+            if (!ec) response.append(buf, buf + bytes_transferred);
+            if (nBody == std::string::npos && (nBody = response.find("\r\n\r\n")) != std::string::npos) {
+                nBody += 4;
+                std::size_t cl = response.find("Content-Length: ");
+                if (cl != std::string::npos && cl < nBody)
+                    content_length = std::stoul(response.substr(cl + 16, response.find("\r\n", cl) - (cl + 16)));
+            }
+            if (nBody != std::string::npos && content_length != std::string::npos && response.length() - nBody >= content_length)
+                break;
+        } while (!ec);
+
+        if (nBody == std::string::npos || response.compare(0, 12, "HTTP/1.1 200") != 0) {
+            strError = std::string("Unexpected response from ") + PRIMEGAPLIST_HOST;
+            return false;
+        }
+        response.erase(0, nBody);
+    } catch (const std::exception& e) {
+        strError = std::string("Download failed: ") + e.what();
+        return false;
+    }
+
+    // Written aside first, so a failed download leaves the old list in place
+    fs::path pathTmp = path;
+    pathTmp += ".new";
+    FILE* file = fsbridge::fopen(pathTmp, "wb");
+    if (!file) {
+        strError = "Cannot write " + pathTmp.string();
+        return false;
+    }
+    bool fWritten = fwrite(response.data(), 1, response.size(), file) == response.size();
+    fWritten = fclose(file) == 0 && fWritten;
+    if (!fWritten || !RenameOver(pathTmp, path)) {
+        strError = "Cannot write " + path.string();
+        return false;
+    }
+    LogPrintf("Downloaded the prime gap list to %s, %u bytes\n", path.string(), response.size());
+    return true;
+}
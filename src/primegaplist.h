@@ -0,0 +1,48 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_PRIMEGAPLIST_H
+#define BITCOIN_PRIMEGAPLIST_H
+
+#include <fs.h>
+
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+/** Default file name of the prime gap list in the data directory */
+static const char* const DEFAULT_PRIMEGAPLIST_FILE = "allgaps.sql";
+
+/** The record merit for each gap length of the prime gap list project */
+struct CPrimeGapList
+{
+    fs::path path;
+    int64_t nLoadTime = 0;
+    std::map<unsigned int, float> mapRecords;
+
+    /** Record merit for a gap length, 0 if there is none */
+    float RecordMerit(unsigned int nGapLen) const
+    {
+        auto it = mapRecords.find(nGapLen);
+        return it == mapRecords.end() ? 0.0f : it->second;
+    }
+};
+
+/** The list file, -primegaplist relative to the data directory */
+fs::path GetPrimeGapListFile();
+
+/**
+ * The cached list, read from GetPrimeGapListFile() on first use.
+ * Returns null with strError set if the file cannot be read.
+ */
+std::shared_ptr<const CPrimeGapList> GetPrimeGapList(std::string& strError);
+
+/** Read the list from path and make it the cached one */
+std::shared_ptr<const CPrimeGapList> LoadPrimeGapList(const fs::path& path, std::string& strError);
+
+/** Fetch allgaps.sql from the prime gap list project on GitHub into path */
+bool DownloadPrimeGapList(const fs::path& path, std::string& strError);
+
+#endif // BITCOIN_PRIMEGAPLIST_H
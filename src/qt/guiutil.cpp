@@ -1035,9 +1035,10 @@ int MaxThreads() {
 
 int64_t GetHashRate() {
 
-    if (GetTimeMillis() - nHPSTimerStart > 8000)
+    CMiningStats stats = GetMiningStats();
+    if (GetTimeMillis() - stats.nLastPass > 8000)
         return (int64_t)0;
-    return (int64_t)dHashesPerSec;
+    return (int64_t)stats.dPrimesPerSec;
 }
 
 QString FormatHashRate(qint64 n)
@@ -63,9 +63,10 @@ int64_t HashRateGraphWidget::getHashRate()
 //    default:
 //        return GetHashRate();
 //    }
-    if (GetTimeMillis() - nHPSTimerStart > 8000)
+    CMiningStats stats = GetMiningStats();
+    if (GetTimeMillis() - stats.nLastPass > 8000)
         return (int64_t)0;
-    return (int64_t)dHashesPerSec;
+    return (int64_t)stats.dPrimesPerSec;
 }
 
 void HashRateGraphWidget::drawHashRate(QPainter& painter)
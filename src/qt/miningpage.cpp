@@ -143,7 +143,7 @@ void MiningPage::updateUI(bool fGenerate)
 {
 
     qint64 NetworkHashrate = GUIUtil::GetNetworkHashPS(120, -1);
-    // int64_t hashrate = (int64_t)dHashesPerSec;
+    CMiningStats stats = GetMiningStats();
     qint64 Hashrate = GUIUtil::GetHashRate();
 
     ui->labelNetHashRate->setText(GUIUtil::FormatHashRate(NetworkHashrate));
@@ -154,7 +154,7 @@ void MiningPage::updateUI(bool fGenerate)
         NextBlockTime = QChar(L'∞');
     else
     {
-        double gaps_per_day = this->powUtils->gaps_per_day(dHashesPerSec, chainActive.Tip()->nDifficulty);
+        double gaps_per_day = this->powUtils->gaps_per_day(stats.dPrimesPerSec, chainActive.Tip()->nDifficulty);
         NextBlockTime = QString::number(gaps_per_day);
     }
     ui->labelNextBlock->setText(NextBlockTime);
@@ -176,9 +176,9 @@ void MiningPage::updateUI(bool fGenerate)
         status = QString("Mining with %1/%2 threads, shift: %3, sieve size: %4, number of primes in sieve: %5 - hashrate: %6 (%7 tests per sec.)")
                 .arg((int)ui->sliderCores->value())
                 .arg(GUIUtil::MaxThreads())
-                .arg(nMiningShift).arg(nMiningSieveSize)
-                .arg(nMiningPrimes)
-                .arg(GUIUtil::FormatHashRate(Hashrate)).arg(dTestsPerSec);
+                .arg(nMiningShift.load()).arg(nMiningSieveSize.load())
+                .arg(nMiningPrimes.load())
+                .arg(GUIUtil::FormatHashRate(Hashrate)).arg(stats.dTestsPerSec);
     ui->miningStatistics->setText(status);
 }
 
@@ -282,8 +282,8 @@ void MiningPage::updateSievePrimes(int i)
     nMiningShift = i;
     if (nMiningShift < 64 && nMiningSieveSize > (((uint64_t) 1) << nMiningShift)) {
        nMiningSieveSize = (((uint64_t) 1) << nMiningShift);
-        qDebug() << "New header shift: " << QString("%1").arg(i) << ", new sieve size value: " << QString("%1").arg(nMiningSieveSize);
-        ui->sievesizeValue->setText(QString("%1").arg(nMiningSieveSize));
+        qDebug() << "New header shift: " << QString("%1").arg(i) << ", new sieve size value: " << QString("%1").arg(nMiningSieveSize.load());
+        ui->sievesizeValue->setText(QString("%1").arg(nMiningSieveSize.load()));
     }
 }
 
@@ -9,16 +9,19 @@
 #include <amount.h>
 #include <base58.h>
 #include <bignum.h>
+#include <bootstrap.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
 #include <coins.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <gapindex.h>
 #include <hash.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
 #include <pow.h>
+#include <primegaplist.h>
 #include <primitives/transaction.h>
 #include <rpc/server.h>
 #ifdef ENABLE_WALLET
@@ -27,6 +30,7 @@
 #include <stdint.h>
 #include <streams.h>
 #include <sync.h>
+#include <triples.h>
 #include <txdb.h>
 #include <txmempool.h>
 #include <util.h>
@@ -41,15 +45,15 @@
 
 #include <boost/thread/thread.hpp> // boost::thread::interrupt
 #include <boost/bind.hpp>
-#include <boost/asio.hpp>
-#include <boost/asio/ssl.hpp>
-#include <boost/algorithm/string.hpp>
 
 #include <univalue.h>
 
+#include <exception>
 #include <memory>
 #include <mutex>
 #include <condition_variable>
+#include <system_error>
+#include <thread>
 #include <iomanip>
 
 static PoWUtils *powUtils = new PoWUtils();
@@ -89,29 +93,45 @@ double GetDifficulty(const CBlockIndex* blockindex)
 
 static PoWUtils *utils = new PoWUtils();
 
-UniValue blockheaderToJSON(const CBlockIndex* blockindex)
+// converts a little-endian gap bound or adder as returned by PoW into a decimal string
+static std::string GapNumberToString(std::vector<uint8_t> vch)
 {
-    AssertLockHeld(cs_main);
-    CBlockHeader block = blockindex->GetBlockHeader();
-    uint256 hash = block.GetHash();
-    std::vector<uint8_t> vHash(hash.begin(), hash.end());
-    PoW pow(&vHash, block.nShift, &block.nAdd, block.nDifficulty);
+    // insert 0 a the begining to avoid sig problems
+    vch.push_back(0);
 
-    std::vector<uint8_t> vStart, vEnd;
-    pow.get_gap(&vStart, &vEnd);
+    CBigNum bn;
+    bn.setvch(vch);
+    return bn.ToString();
+}
 
-    std::vector<uint8_t> vDifficulty(block.nAdd.begin(), block.nAdd.end());
+// the gap end is not cached, it is the gap start plus the gap length
+static std::string GapEndToString(const CBlockPoWSummary& summary)
+{
+    std::vector<uint8_t> vch(summary.vGapStart);
+    vch.push_back(0);
 
-    // insert 0 a the begining to avoid sig problems
-    vDifficulty.push_back(0);
-    vStart.push_back(0);
-    vEnd.push_back(0);
+    CBigNum bn;
+    bn.setvch(vch);
+    bn += CBigNum(summary.nGapLen);
+    return bn.ToString();
+}
 
-    CBigNum bnTarget, bnStart, bnEnd;
-    bnTarget.setvch(vDifficulty);
-    bnStart.setvch(vStart);
-    bnEnd.setvch(vEnd);
+// adds the proof of work fields shared by the block and header JSON
+static void PoWSummaryToJSON(const CBlockIndex* blockindex, UniValue& result)
+{
+    std::shared_ptr<const CBlockPoWSummary> summary = GetBlockPoWSummary(*blockindex);
+
+    result.push_back(Pair("shift", (uint64_t)blockindex->nShift));
+    result.push_back(Pair("adder", GapNumberToString(std::vector<uint8_t>(blockindex->nAdd.begin(), blockindex->nAdd.end()))));
+    result.push_back(Pair("gapstart", GapNumberToString(summary->vGapStart)));
+    result.push_back(Pair("gapend", GapEndToString(*summary)));
+    result.push_back(Pair("gaplen", summary->nGapLen));
+    result.push_back(Pair("merit", utils->get_readable_difficulty(summary->nMerit)));
+}
 
+UniValue blockheaderToJSON(const CBlockIndex* blockindex)
+{
+    AssertLockHeld(cs_main);
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
     int confirmations = -1;
@@ -127,12 +147,7 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     result.push_back(Pair("mediantime", (int64_t)blockindex->GetMedianTimePast()));
     result.push_back(Pair("nonce", (uint64_t)blockindex->nNonce));
     result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
-    result.push_back(Pair("shift", (uint64_t)block.nShift));
-    result.push_back(Pair("adder", bnTarget.ToString()));
-    result.push_back(Pair("gapstart", bnStart.ToString()));
-    result.push_back(Pair("gapend", bnEnd.ToString()));
-    result.push_back(Pair("gaplen", pow.gap_len()));
-    result.push_back(Pair("merit", utils->get_readable_difficulty(pow.merit())));
+    PoWSummaryToJSON(blockindex, result);
     result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
     result.push_back(Pair("nTx", (uint64_t)blockindex->nTx));
 
@@ -147,25 +162,6 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails)
 {
     AssertLockHeld(cs_main);
-    uint256 hash = block.GetHash();
-    std::vector<uint8_t> vHash(hash.begin(), hash.end());
-    PoW pow(&vHash, block.nShift, &block.nAdd, block.nDifficulty);
-
-    std::vector<uint8_t> vStart, vEnd;
-    pow.get_gap(&vStart, &vEnd);
-
-    std::vector<uint8_t> vDifficulty(block.nAdd.begin(), block.nAdd.end());
-
-    // insert 0 a the begining to avoid sig problems
-    vDifficulty.push_back(0);
-    vStart.push_back(0);
-    vEnd.push_back(0);
-
-    CBigNum bnTarget, bnStart, bnEnd;
-    bnTarget.setvch(vDifficulty);
-    bnStart.setvch(vStart);
-    bnEnd.setvch(vEnd);
-
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
     int confirmations = -1;
@@ -197,12 +193,7 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.push_back(Pair("mediantime", (int64_t)blockindex->GetMedianTimePast()));
     result.push_back(Pair("nonce", (uint64_t)block.nNonce));
     result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
-    result.push_back(Pair("shift", (uint64_t)block.nShift));
-    result.push_back(Pair("adder", bnTarget.ToString()));
-    result.push_back(Pair("gapstart", bnStart.ToString()));
-    result.push_back(Pair("gapend", bnEnd.ToString()));
-    result.push_back(Pair("gaplen", pow.gap_len()));
-    result.push_back(Pair("merit", utils->get_readable_difficulty(pow.merit())));
+    PoWSummaryToJSON(blockindex, result);
     result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
     result.push_back(Pair("nTx", (uint64_t)blockindex->nTx));
 
@@ -256,6 +247,11 @@ void RPCNotifyBlockChange(bool ibd, const CBlockIndex * pindex)
         latestblock.height = pindex->nHeight;
     }
     cond_blockchange.notify_all();
+
+    // Derive the gap of a new tip off the validation thread, so the block
+    // RPCs find it cached. Block index entries outlive the scheduler queue.
+    if (!ibd && pindex)
+        CallFunctionInValidationInterfaceQueue([pindex] { GetBlockPoWSummary(*pindex); });
 }
 
 UniValue waitfornewblock(const JSONRPCRequest& request)
@@ -1034,6 +1030,54 @@ UniValue gettxoutsetinfo(const JSONRPCRequest& request)
     return ret;
 }
 
+UniValue getcoinsflushinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getcoinsflushinfo\n"
+            "\nReturns statistics about flushing the UTXO cache to disk.\n"
+            "Flushes write the modified coins in the background; validation is only held up while they are collected,\n"
+            "or while the previous flush is still being written.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"cachesize\": n,          (numeric) coins in the cache\n"
+            "  \"cacheusage\": n,         (numeric) memory used by the cache in bytes\n"
+            "  \"writing\": n,            (numeric) coins being written, 0 if none\n"
+            "  \"writingusage\": n,       (numeric) memory held by the coins being written in bytes\n"
+            "  \"writes\": n,             (numeric) batches written since startup\n"
+            "  \"lastwritecoins\": n,     (numeric) coins in the last batch\n"
+            "  \"lastwritetime\": x.xxx,  (numeric) seconds taken to write the last batch\n"
+            "  \"totalwritetime\": x.xxx, (numeric) seconds spent writing batches\n"
+            "  \"stalls\": n,             (numeric) flushes since startup\n"
+            "  \"laststalltime\": x.xxx,  (numeric) seconds validation was held up by the last flush\n"
+            "  \"maxstalltime\": x.xxx,   (numeric) the longest a flush held up validation in seconds\n"
+            "  \"totalstalltime\": x.xxx  (numeric) seconds validation was held up by flushes\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getcoinsflushinfo", "")
+            + HelpExampleRpc("getcoinsflushinfo", "")
+        );
+
+    LOCK(cs_main);
+    if (!pcoinsflusher)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Coins database not loaded");
+    CCoinsFlushStats stats = pcoinsflusher->GetStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("cachesize", (uint64_t)pcoinsTip->GetCacheSize());
+    obj.pushKV("cacheusage", (uint64_t)pcoinsTip->DynamicMemoryUsage());
+    obj.pushKV("writing", stats.nWritingEntries);
+    obj.pushKV("writingusage", (uint64_t)pcoinsflusher->DynamicMemoryUsage());
+    obj.pushKV("writes", stats.nWrites);
+    obj.pushKV("lastwritecoins", stats.nLastEntries);
+    obj.pushKV("lastwritetime", stats.nLastWriteMicros * 0.000001);
+    obj.pushKV("totalwritetime", stats.nTotalWriteMicros * 0.000001);
+    obj.pushKV("stalls", stats.nStalls);
+    obj.pushKV("laststalltime", stats.nLastStallMicros * 0.000001);
+    obj.pushKV("maxstalltime", stats.nMaxStallMicros * 0.000001);
+    obj.pushKV("totalstalltime", stats.nTotalStallMicros * 0.000001);
+    return obj;
+}
+
 UniValue gettxout(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
@@ -1681,6 +1725,15 @@ UniValue savemempool(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+/** An integer merit, checked to fit the 16 integer bits of the fixed point merits */
+static uint64_t ParseGapMerit(const UniValue& value)
+{
+    int nMerit = value.get_int();
+    if (nMerit < 0 || nMerit > 0xffff)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Merit out of range, must be 0 to 65535");
+    return nMerit;
+}
+
 // returns all prime gaps with the given merit if they exist
 UniValue listprimerecords(const JSONRPCRequest& request)
 {
@@ -1688,49 +1741,64 @@ UniValue listprimerecords(const JSONRPCRequest& request)
         throw runtime_error(
             "listprimerecords merit\n"
             "\nReturns a list of all prime gaps with the given integer merit.\n"
+            "Served from the gap index without walking the chain when gapcoind runs with -gapindex.\n"
             "\nArguments:\n"
             "1. merit        (numeric 1,2,3..) the prime gap merit.\n");
 
 #ifdef ENABLE_WALLET
     CWallet * const pwallet = GetWalletForJSONRPCRequest(request);
-
-    LOCK2(cs_main, pwallet ? &pwallet->cs_wallet : nullptr);
-#else
-    LOCK(cs_main);
 #endif
 
-    uint64_t nMerit  = request.params[0].get_int();
+    uint64_t nMerit  = ParseGapMerit(request.params[0]);
 
     UniValue ret(UniValue::VARR);
     CTxDestination address;
 
+    if (g_gapindex && g_gapindex->IsSynced()) {
+        std::vector<CGapRecord> records;
+        if (!g_gapindex->FindRecords(nMerit << 48, (nMerit << 48) | ((1ULL << 48) - 1), std::numeric_limits<size_t>::max(), records))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the gap index");
+
+        // newest gaps first, as in the chain walk below
+        std::sort(records.begin(), records.end(), [](const CGapRecord& a, const CGapRecord& b) { return a.nHeight > b.nHeight; });
+
+        for (const CGapRecord& record : records)
+        {
+            UniValue entry(UniValue::VOBJ);
+
+            entry.push_back(Pair("time", DateTimeStrFormat("%Y-%m-%d %H:%M:%S UTC", record.nTime).c_str()));
+            entry.push_back(Pair("epoch", record.nTime));
+            entry.push_back(Pair("height", record.nHeight));
+#ifdef ENABLE_WALLET
+            entry.push_back(Pair("mineraddress", (record.nCoinbaseOutputs > 1)? "multiple" : ExtractDestination(record.txoutCoinbase.scriptPubKey, address)? EncodeDestination(address).c_str() : "invalid"));
+            entry.push_back(Pair("ismine", pwallet && bool(pwallet->IsMine(record.txoutCoinbase) & ISMINE_SPENDABLE)));
+            entry.push_back(Pair("iswatchonly", pwallet && bool(pwallet->IsMine(record.txoutCoinbase) & ISMINE_WATCH_ONLY)));
+#endif
+            entry.push_back(Pair("gapstart", GapNumberToString(record.vGapStart)));
+            entry.push_back(Pair("gapend", GapNumberToString(record.vGapEnd)));
+            entry.push_back(Pair("gaplen", record.nGapLen));
+            entry.push_back(Pair("merit", utils->get_readable_difficulty(record.nMerit)));
+            ret.push_back(entry);
+        }
+        return ret;
+    }
+
+#ifdef ENABLE_WALLET
+    LOCK2(cs_main, pwallet ? &pwallet->cs_wallet : nullptr);
+#else
+    LOCK(cs_main);
+#endif
+
     for (CBlockIndex* pindex = chainActive.Tip(); pindex; pindex = pindex->pprev)
     {
 
-        uint256 hash = pindex->GetBlockHash();
-        std::vector<uint8_t> vHash(hash.begin(), hash.end());
-        PoW pow(&vHash, pindex->nShift, &pindex->nAdd, pindex->nDifficulty);
+        std::shared_ptr<const CBlockPoWSummary> summary = GetBlockPoWSummary(*pindex);
 
-        uint64_t curMerit = pow.merit();
+        uint64_t curMerit = summary->nMerit;
 
         if (nMerit != (curMerit >> 48))
             continue;
 
-        std::vector<uint8_t> vStart, vEnd;
-        pow.get_gap(&vStart, &vEnd);
-        
-        std::vector<uint8_t> vDifficulty(pindex->nAdd.begin(), pindex->nAdd.end());
-        
-        // insert 0 a the begining to avoid sig problems
-        vDifficulty.push_back(0);
-        vStart.push_back(0);
-        vEnd.push_back(0);
-        
-        CBigNum bnTarget, bnStart, bnEnd;
-        bnTarget.setvch(vDifficulty);
-        bnStart.setvch(vStart);
-        bnEnd.setvch(vEnd);
-
         CBlock block;
         if (ReadBlockFromDisk(block, pindex, Params().GetConsensus(), false)) {
 
@@ -1744,9 +1812,9 @@ UniValue listprimerecords(const JSONRPCRequest& request)
             entry.push_back(Pair("ismine", bool(pwallet->IsMine(block.vtx[0]->vout[0]) & ISMINE_SPENDABLE)));
             entry.push_back(Pair("iswatchonly", bool(pwallet->IsMine(block.vtx[0]->vout[0]) & ISMINE_WATCH_ONLY)));
 #endif
-            entry.push_back(Pair("gapstart", bnStart.ToString()));
-            entry.push_back(Pair("gapend", bnEnd.ToString()));
-            entry.push_back(Pair("gaplen", pow.gap_len()));
+            entry.push_back(Pair("gapstart", GapNumberToString(summary->vGapStart)));
+            entry.push_back(Pair("gapend", GapEndToString(*summary)));
+            entry.push_back(Pair("gaplen", summary->nGapLen));
             entry.push_back(Pair("merit", utils->get_readable_difficulty(curMerit)));
             ret.push_back(entry);
         }
@@ -1776,54 +1844,74 @@ UniValue listbestprimes(const JSONRPCRequest& request)
         throw runtime_error(
             "listbestprimes amount (min merit)\n"
             "\nReturns a sorted list of the best prime gaps merits.\n"
+            "Served from the gap index without walking the chain when gapcoind runs with -gapindex.\n"
             "\nArguments:\n"
             "1. amount        (numeric). number of prime gaps to display\n"
             "2. merit         (numeric, default = 16). minimum merit to display\n");
 
+    if (request.params[0].get_int() < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative amount");
     uint64_t amount = request.params[0].get_int();
     uint64_t nMerit = 16;
 
     if (request.params.size() > 1)
-      nMerit = request.params[1].get_int();
+      nMerit = ParseGapMerit(request.params[1]);
 
 #ifdef ENABLE_WALLET
     CWallet * const pwallet = GetWalletForJSONRPCRequest(request);
+#endif
+
+    std::vector<PrimeRecord> records;
+    CTxDestination address;
+
+    if (g_gapindex && g_gapindex->IsSynced()) {
+        std::vector<CGapRecord> best;
+        if (!g_gapindex->FindRecords(nMerit << 48, std::numeric_limits<uint64_t>::max(), 1 + amount, best))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the gap index");
+
+        UniValue ret(UniValue::VARR);
 
+        // the index yields the best gap first, the result lists it last
+        for (auto it = best.rbegin(); it != best.rend(); ++it)
+        {
+            const CGapRecord& record = *it;
+            std::string strGapStart = GapNumberToString(record.vGapStart);
+
+            UniValue entry(UniValue::VOBJ);
+            entry.push_back(Pair("time", DateTimeStrFormat("%Y-%m-%d %H:%M:%S UTC", record.nTime).c_str()));
+            entry.push_back(Pair("epoch", record.nTime));
+            entry.push_back(Pair("height", record.nHeight));
+#ifdef ENABLE_WALLET
+            entry.push_back(Pair("ismine", pwallet && bool(pwallet->IsMine(record.txoutCoinbase) & ISMINE_SPENDABLE)));
+            entry.push_back(Pair("iswatchonly", pwallet && bool(pwallet->IsMine(record.txoutCoinbase) & ISMINE_WATCH_ONLY)));
+            entry.push_back(Pair("mineraddress", (record.nCoinbaseOutputs > 1)? "multiple" : ExtractDestination(record.txoutCoinbase.scriptPubKey, address)? EncodeDestination(address).c_str() : "invalid"));
+#endif
+            entry.push_back(Pair("primedigits", std::to_string(strGapStart.length())));
+            entry.push_back(Pair("gapstart", strGapStart));
+            entry.push_back(Pair("gapend", GapNumberToString(record.vGapEnd)));
+            entry.push_back(Pair("gaplen", record.nGapLen));
+            entry.push_back(Pair("merit", utils->get_readable_difficulty(record.nMerit)));
+            ret.push_back(entry);
+        }
+        return ret;
+    }
+
+#ifdef ENABLE_WALLET
     LOCK2(cs_main, pwallet ? &pwallet->cs_wallet : nullptr);
 #else
     LOCK(cs_main);
 #endif
 
-    std::vector<PrimeRecord> records;
-    CTxDestination address;
-
     for (CBlockIndex* pindex = chainActive.Tip(); pindex; pindex = pindex->pprev)
     {
 
-        uint256 hash = pindex->GetBlockHash();
-        std::vector<uint8_t> vHash(hash.begin(), hash.end());
-        PoW pow(&vHash, pindex->nShift, &pindex->nAdd, pindex->nDifficulty);
+        std::shared_ptr<const CBlockPoWSummary> summary = GetBlockPoWSummary(*pindex);
 
-        uint64_t curMerit = pow.merit();
+        uint64_t curMerit = summary->nMerit;
 
         if (nMerit > (curMerit >> 48))
             continue;
 
-        std::vector<uint8_t> vStart, vEnd;
-        pow.get_gap(&vStart, &vEnd);
-        
-        std::vector<uint8_t> vDifficulty(pindex->nAdd.begin(), pindex->nAdd.end());
-        
-        // insert 0 a the begining to avoid sig problems
-        vDifficulty.push_back(0);
-        vStart.push_back(0);
-        vEnd.push_back(0);
-        
-        CBigNum bnTarget, bnStart, bnEnd;
-        bnTarget.setvch(vDifficulty);
-        bnStart.setvch(vStart);
-        bnEnd.setvch(vEnd);
-
         CBlock block;
         if (ReadBlockFromDisk(block, pindex, Params().GetConsensus(), false)) {
 
@@ -1836,10 +1924,11 @@ UniValue listbestprimes(const JSONRPCRequest& request)
             entry.push_back(Pair("iswatchonly", bool(pwallet->IsMine(block.vtx[0]->vout[0]) & ISMINE_WATCH_ONLY)));
             entry.push_back(Pair("mineraddress", (block.vtx[0]->vout.size() > 1)? "multiple" : ExtractDestination(block.vtx[0]->vout[0].scriptPubKey, address)? EncodeDestination(address).c_str() : "invalid"));
 #endif
-            entry.push_back(Pair("primedigits", std::to_string(bnStart.ToString().length())));
-            entry.push_back(Pair("gapstart", bnStart.ToString()));
-            entry.push_back(Pair("gapend", bnEnd.ToString()));
-            entry.push_back(Pair("gaplen", pow.gap_len()));
+            std::string strGapStart = GapNumberToString(summary->vGapStart);
+            entry.push_back(Pair("primedigits", std::to_string(strGapStart.length())));
+            entry.push_back(Pair("gapstart", strGapStart));
+            entry.push_back(Pair("gapend", GapEndToString(*summary)));
+            entry.push_back(Pair("gaplen", summary->nGapLen));
             entry.push_back(Pair("merit", utils->get_readable_difficulty(curMerit)));
 
             PrimeRecord rec(curMerit, entry);
@@ -1859,235 +1948,21 @@ UniValue listbestprimes(const JSONRPCRequest& request)
     return ret;
 }
 
-static std::string blockgraph(const CBlockIndex* pblockindex)
-{
-
-    bool withTypes = false;
-
-    std::map<std::string,std::string> blockkeys = {
-        std::make_pair("adder", "integer"),
-        std::make_pair("difficulty", "decimal"),
-        std::make_pair("gaplen", "integer"),
-        std::make_pair("gapstart", "string"),
-        std::make_pair("height", "integer"),
-        std::make_pair("mediantime", "integer"),
-        std::make_pair("merit", "decimal"),
-        std::make_pair("shift", "integer"),
-        std::make_pair("size", "integer"),
-    };
-
-    // std::string chainid = "<http://purl.org/net/bel-epa/ccy#C324fff4a-c492-4e8b-94f4-2f599efd7ba1> ";
-    std::string rdfs = "<http://www.w3.org/1999/02/22-rdf-syntax-ns#";
-    std::string ccy = "<http://purl.org/net/bel-epa/ccy#";
-    std::string ccyC = ccy + "C";
-    std::string doacc = "<http://purl.org/net/bel-epa/doacc#";
-
-    std::stringstream stream;
-
-    CBlock block;
-    auto& consensus_params = Params().GetConsensus();
-    UniValue data;
-    {
-        LOCK(cs_main);
-        ReadBlockFromDisk(block, pblockindex, consensus_params, false);
-        data = blockToJSON(block, pblockindex, true);
-    }
-
-    std::string blockid = "<http://purl.org/net/bel-epa/ccy#C" + data["hash"].getValStr() + "> ";
-    if (withTypes)
-        stream << blockid << rdfs << "type> " << ccy << "Block> ." << std::endl;
-    if (!data["nextblockhash"].isNull())
-        stream << blockid << ccy << "next> " << ccyC << data["nextblockhash"].getValStr() << "> ." << std::endl;
-    if (pblockindex->nHeight > 0)
-        stream << blockid << ccy << "prev> " << ccyC << data["previousblockhash"].getValStr() << "> ." << std::endl;
-    stream << blockid << ccy << "time> \"" << DateTimeStrFormat("%Y-%m-%dT%H:%M:%SZ", std::stoll(data["time"].getValStr())) << "\"^^<http://www.w3.org/2001/XMLSchema#dateTime> ." << std::endl;
-
-    for (auto it = blockkeys.begin(); it != blockkeys.end(); ++it)
-    {
-        stream << blockid << ccy << it->first << "> \"" << data[it->first].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#" << it->second << "> ." << std::endl;
-    }
-
-    UniValue tx(UniValue::VARR);
-    for (size_t i=0; i<data["tx"].size(); i++) {
-        UniValue txi(UniValue::VARR);
-        UniValue txo(UniValue::VARR);
-        UniValue script(UniValue::VARR);
-
-        tx = data["tx"][i];
-
-        std::string txid = ccyC + tx["txid"].getValStr() + "> ";
-        if (withTypes)
-            stream << txid << rdfs << "type> " << ccy << "Transaction> ." << std::endl;
-        stream << blockid << ccy << "transaction> " << txid << " ." << std::endl;
-        stream << txid << ccy << "time> \"" << DateTimeStrFormat("%Y-%m-%dT%H:%M:%SZ", std::stoll(data["time"].getValStr())) << "\"^^<http://www.w3.org/2001/XMLSchema#dateTime> ." << std::endl;
-        if (tx["locktime"].getValStr() != "0")
-            stream << txid << ccy << "locktime> \"" << tx["txid"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#integer> ." << std::endl; 
-
-        if (i == 0) {
-            txi = tx["vin"][0];
-            std::string coinbasetxinput = ccyC + tx["txid"].getValStr() + "-0-0> ";
-            if (withTypes)
-                stream << coinbasetxinput << rdfs << "type> " << ccy << "TransactionInput> ." << std::endl;
-            stream << txid << ccy << "input> " << coinbasetxinput << "." << std::endl;
-            stream << coinbasetxinput << ccy + "coinbase> \"" << txi["coinbase"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
-            stream << coinbasetxinput << ccy + "sequence> \"" << txi["sequence"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#integer> ." << std::endl;
-
-            txo = tx["vout"][0];
-            script = txo["scriptPubKey"];
-            std::string coinbasetxoutput = ccyC + tx["txid"].getValStr() + "-1-0> ";
-            if (withTypes)
-                stream << coinbasetxoutput << rdfs << "type> " << ccy << "TransactionOutput> ." << std::endl;
-            stream << txid << ccy << "output> " << coinbasetxoutput << "." << std::endl;
-            stream << coinbasetxoutput << ccy + "value> \"" << txo["value"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#decimal> ." << std::endl;
-            stream << coinbasetxoutput << ccy + "n> \"" << txo["n"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#integer> ." << std::endl;
-            stream << coinbasetxoutput << ccy + "pkasm> \"" << script["asm"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
-            stream << coinbasetxoutput << ccy + "type> \"" << script["type"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
-            if (script["type"].getValStr() != "nulldata" && script["type"].getValStr() != "nonstandard") {
-                stream << coinbasetxoutput << ccy + "reqSigs> \"" << script["reqSigs"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
-                std::string coinbasetxoutputaddresses = ccy + "OA" + tx["txid"].getValStr() + strprintf("-0-0> ");
-                for (size_t m=0; m<script["addresses"].size();m++) {
-                    std::string coinbasetxoutputaddress = ccy + script["addresses"][m].getValStr() + "> ";
-                    if (withTypes)
-                        stream << coinbasetxoutputaddress << rdfs << "type> " << ccy << "Address> " << "." << std::endl;
-                    stream << coinbasetxoutput << ccy << "address> " << coinbasetxoutputaddress << "." << std::endl;
-                }
-            }
-        } else {
-
-            // create TransactionInput
-            for (size_t j=0;j<tx["vin"].size();j++) {
-                txi = tx["vin"][j];
-                std::string txinputid = ccyC + tx["txid"].getValStr() + "-0-" + std::to_string((int)j) + "> ";
-                if (withTypes)
-                    stream << txinputid << rdfs << "type> " << ccy << "TransactionInput> ." << std::endl;
-                stream << txid << ccy << "input> " << txinputid << "." << std::endl;
-                stream << txinputid << ccy + "txid> " << ccyC << txi["txid"].getValStr() << "> ." << std::endl;
-                stream << txinputid << ccy + "nvout> \"" << txi["vout"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#integer> ." << std::endl;
-                stream << txinputid << ccy + "ssasm> \"" << txi["scriptSig"]["asm"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
-                stream << txinputid << ccy + "sequence> \"" << txi["sequence"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#integer> ." << std::endl;
-                if (!txi["txinwitness"].isNull()) {
-                    for(size_t w=0; w<txi["txinwitness"].size();w++) {
-                        std::string txinputwitness = ccy + txi["txinwitness"][w].getValStr() + "> ";
-                        stream << txinputid << ccy << "witness> " << txinputwitness << " ." << std::endl;
-                    }
-                }
-                // Mark the txins as spent
-                std::string txspentid = ccyC + tx["txid"].getValStr() + "-1-" + txi["vout"].getValStr() + "> ";
-                stream << txspentid << ccy << "spent> \"true\"^^<http://www.w3.org/2001/XMLSchema#boolean> ." << std::endl;
-            }
-
-            // create TransactionOutput
-            for (size_t k=0;k<tx["vout"].size();k++) {
-                txo = tx["vout"][k];
-                script = txo["scriptPubKey"];
-                std::string txoutputid = ccyC + tx["txid"].getValStr() + "-1-" + std::to_string((int)k) + "> ";
-                if (withTypes)
-                    stream << txoutputid << rdfs << "type> " << ccy << "TransactionOutput> ." << std::endl;
-                stream << txid << ccy << "output> " << txoutputid << "." << std::endl;
-                stream << txoutputid << ccy << "spent> \"false\"^^<http://www.w3.org/2001/XMLSchema#boolean> ." << std::endl;
-                stream << txoutputid << ccy + "value> \"" << txo["value"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#decimal> ." << std::endl;
-                stream << txoutputid << ccy + "n> \"" << txo["n"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#integer> ." << std::endl;
-                stream << txoutputid << ccy + "pkasm> \"" << script["asm"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
-                stream << txoutputid << ccy + "type> \"" << script["type"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
-
-                // nonstandard, pubkey, pubkeyhash, scripthash, multisig, nulldata, 
-                // witness_v0_keyhash, witness_v0_scripthash, witness_unknown"
-
-                if (script["type"].getValStr() != "nulldata" && script["type"].getValStr() != "nonstandard") {
-                    stream << txoutputid << ccy + "reqSigs> \"" << script["reqSigs"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
-                    for (size_t n=0; n<script["addresses"].size();n++) {
-                        std::string txoutputaddress = ccy + script["addresses"][n].getValStr() + "> ";
-                        if (withTypes)
-                            stream << txoutputid << rdfs << "type> " << ccy << "Address> " << "." << std::endl;
-                        stream << txoutputid << ccy << "address> " << txoutputaddress << "." << std::endl;
-                    }
-                }
-            }
-        }
-    }
-    return stream.str();
-}
-
-static std::map<int, float> getprimegaplist() {
-    boost::system::error_code ec;
-    boost::asio::io_service svc;
-    boost::asio::ssl::context ctx(boost::asio::ssl::context::tls);
-    boost::asio::ssl::stream<boost::asio::ip::tcp::socket> ssock(svc, ctx);
-    boost::asio::ip::tcp::resolver resolver(svc);
-    auto it = resolver.resolve({"raw.githubusercontent.com", "443"});
-    boost::asio::connect(ssock.lowest_layer(), it);
-
-    ssock.handshake(boost::asio::ssl::stream_base::handshake_type::client);
-
-    std::stringstream request;
-    request << "GET /primegap-list-project/prime-gap-list/master/allgaps.sql HTTP/1.1\r\n";
-    request << "Host: raw.githubusercontent.com\r\n";
-    request << "Accept-Encoding: *\r\n";
-    request << "\r\n";
-
-    boost::asio::write(ssock, boost::asio::buffer(request.str()));
-    std::string response;
-    size_t content_length = 999999999;
-
-    do {
-        char buf[8192];
-        size_t bytes_transferred = ssock.read_some(boost::asio::buffer(buf), ec);
-        if (!ec) response.append(buf, buf + bytes_transferred);
-        // Pro tem
-        if (response.length() == bytes_transferred) {
-            std::size_t cl = response.find("Content-Length: ");
-            std::size_t cc = response.find("Cache-Control:");
-            content_length = std::stoi(response.substr(cl+16, cc-(cl+16)));
-        }
-        if (response.length() > content_length)
-            ec = boost::asio::error::operation_aborted;
-    } while (!ec);
-    ssock.shutdown();
-    vector<string> results;
-    boost::split(results, response, boost::is_any_of("\n"));
-    std::map<int, float> gaps;
-    std::string target = "INSERT INTO gaps VALUES(";
-    std::vector<std::string> cells;
-    for (int i = 0; i < (int)results.size(); i++) {
-        std::size_t ge = results[i].find(target);
-        if (ge != std::string::npos) {
-            std::string entry = results[i].substr(target.length(), results[i].length()-2);
-            boost::split(cells, entry, boost::is_any_of(","));
-            gaps.insert(std::pair<int, float>(std::stoi(cells[0]), std::stof(cells[7])));
-        }
-    }
-    return gaps;
-}
-
-static std::string checkagainstprimegaplist(const CBlockIndex* pblockindex, std::map<int, float> gaps)
+// formats a block's gap for the prime gap list if it beats the record merit
+static std::string checkagainstprimegaplist(const CBlockIndex* pblockindex, const CPrimeGapList& gaps)
 {
     std::stringstream stream;
-    CBlock block;
-    auto& consensus_params = Params().GetConsensus();
-    UniValue data;
-    {
-        LOCK(cs_main);
-        ReadBlockFromDisk(block, pblockindex, consensus_params, false);
-        data = blockToJSON(block, pblockindex, true);
-    }
-
-    float recordmerit = 0.0;
-    float merit = data["merit"].get_real();
-    int gap = data["gaplen"].get_int();
-
-    std::map<int,float>::iterator entry;
-    entry = gaps.find(gap);
+    std::shared_ptr<const CBlockPoWSummary> summary = GetBlockPoWSummary(*pblockindex);
 
-    if (entry != gaps.end()) {
-        recordmerit = entry->second;
-    }
+    float merit = utils->get_readable_difficulty(summary->nMerit);
+    float recordmerit = gaps.RecordMerit(summary->nGapLen);
 
     if ((merit - recordmerit) > 0.000099999999999) {
-        stream << data["gaplen"].getValStr() << " ";
+        stream << summary->nGapLen << " ";
         stream << "Gapcoin ";
-        stream << DateTimeStrFormat("%Y-%m-%d", std::stoll(data["time"].getValStr())) << " ";
+        stream << DateTimeStrFormat("%Y-%m-%d", pblockindex->GetBlockTime()) << " ";
         stream << fixed << setprecision(6) << merit << " ";
-        stream << data["gapstart"].getValStr();
+        stream << GapNumberToString(summary->vGapStart);
         stream << std::endl;
     }
     return stream.str();
@@ -2137,7 +2012,7 @@ UniValue renderblock(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
 
     UniValue result(UniValue::VSTR);
-    result.setStr(blockgraph(pblockindex));
+    result.setStr(BlockToTriples(block, pblockindex));
     return result;
 }
 
@@ -2179,26 +2054,41 @@ UniValue renderblockhash(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
 
     UniValue result(UniValue::VSTR);
-    result.setStr(blockgraph(pblockindex));
+    result.setStr(BlockToTriples(block, pblockindex));
     return result;
 }
 
 UniValue dumptriples(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 5)
         throw std::runtime_error(
-            "dumptriples filename startblock endblock\n"
-            "\nCreates an RDF serialization of the blockchain in destination, which can be a directory or a path with filename.\n"
+            "dumptriples filename ( startblock endblock compression threads )\n"
+            "\nStarts writing an RDF serialization of the blockchain as N-Triples to destination, which can be a directory or a path with filename.\n"
+            "The blocks are rendered by a pool of worker threads in the background and written in order; see gettriplesinfo for the progress.\n"
             "\nArguments:\n"
-            "1. filename      (string) optional filename with path (either absolute or relative)\n"
+            "1. filename      (string) filename with path (either absolute or relative), an existing FIFO, or \"-\" for the node's standard output\n"
+            "                 (not with -printtoconsole, whose log would be mixed in)\n"
             "2. startblock    (numeric) optional first block number to dump (default 0).\n"
-            "3. endblock      (numeric) optional last block number to dump (default 1200000).\n");
+            "3. endblock      (numeric) optional last block number to dump (default the chain tip).\n"
+            "4. compression   (string) optional \"none\" or \"gzip\" (default \"none\"; gzip needs a build with zlib).\n"
+            "5. threads       (numeric) optional number of worker threads (default the number of cores, at most " + std::to_string(MAX_TRIPLES_THREADS) + ").\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filename\": \"xxxx\",    (string) the destination written to\n"
+            "  \"startheight\": n,      (numeric) the first block dumped\n"
+            "  \"endheight\": n         (numeric) the last block dumped\n"
+            "}\n");
 
-    fs::path filepath = request.params[0].get_str();
-    filepath = fs::absolute(filepath);
+    std::string strSink = request.params[0].get_str();
+    if (strSink != "-")
+        strSink = fs::absolute(strSink).string();
 
-    int nEndBlock = 1200000;
     int nStartBlock = 0;
+    int nEndBlock;
+    {
+        LOCK(cs_main);
+        nEndBlock = chainActive.Height();
+    }
 
     if (request.params.size() > 1)
         nStartBlock = request.params[1].get_int();
@@ -2207,45 +2097,71 @@ UniValue dumptriples(const JSONRPCRequest& request)
         nEndBlock = request.params[2].get_int();
     }
 
-    try {
-
-        boost::filesystem::path filepath = request.params[0].get_str();
-        filepath = boost::filesystem::absolute(filepath);
-
-        /* Prevent arbitrary files from being overwritten. There have been reports
-         * that users have overwritten wallet files this way:
-         * https://github.com/bitcoin/bitcoin/issues/9934
-         * It may also avoid other security issues.
-         */
-        if (boost::filesystem::exists(filepath)) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, filepath.string() + " already exists. If you are sure this is what you want, move it out of the way first");
-        }
+    TriplesCompression compression = TriplesCompression::NONE;
+    if (request.params.size() > 3 && !ParseTriplesCompression(request.params[3].get_str(), compression))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unsupported compression: " + request.params[3].get_str());
 
-        std::ofstream file;
-        file.open(filepath.string().c_str());
-        if (!file.is_open())
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Cannot open wallet dump file");
+    int nThreads = std::min(GetNumCores(), MAX_TRIPLES_THREADS);
+    if (request.params.size() > 4)
+        nThreads = request.params[4].get_int();
+    if (nThreads < 1 || nThreads > MAX_TRIPLES_THREADS)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("threads must be between 1 and %d", MAX_TRIPLES_THREADS));
 
-        CBlockIndex* pblockindex = chainActive[nStartBlock];
-
-        while (pblockindex->nHeight <= nEndBlock)
-        {
-            file << blockgraph(pblockindex);
-            pblockindex = chainActive.Next(pblockindex);
-        }
-
-        file.close();
-
-    } catch(const boost::filesystem::filesystem_error &e) {
+    std::string strError;
+    try {
+        if (!StartTriplesDump(strSink, nStartBlock, nEndBlock, compression, nThreads, strError))
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Error: " + strError);
+    } catch(const fs::filesystem_error &e) {
         throw JSONRPCError(-1, "Error: Triples dump failed!");
     }
 
     UniValue reply(UniValue::VOBJ);
-    reply.pushKV("filename", filepath.string());
+    reply.pushKV("filename", strSink);
+    reply.pushKV("startheight", nStartBlock);
+    reply.pushKV("endheight", nEndBlock);
 
     return reply;
 }
 
+UniValue gettriplesinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "gettriplesinfo\n"
+            "\nReturns the progress of the last dumptriples.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"running\": true|false,   (boolean) whether the dump is still being written\n"
+            "  \"filename\": \"xxxx\",      (string) the destination written to\n"
+            "  \"startheight\": n,        (numeric) the first block dumped\n"
+            "  \"endheight\": n,          (numeric) the last block to dump\n"
+            "  \"height\": n,             (numeric) the next block to be written\n"
+            "  \"progress\": x.xxx,       (numeric) the fraction of the blocks written\n"
+            "  \"bytes\": n,              (numeric) the uncompressed size of the triples written\n"
+            "  \"threads\": n,            (numeric) the number of worker threads\n"
+            "  \"elapsed\": n,            (numeric) seconds since the dump started\n"
+            "  \"error\": \"xxxx\"          (string, optional) why the dump stopped short\n"
+            "}\n"
+            );
+
+    CTriplesDumpStatus status = GetTriplesDumpStatus();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("running", status.fRunning);
+    if (status.strSink.empty())
+        return obj;
+    obj.pushKV("filename", status.strSink);
+    obj.pushKV("startheight", status.nStartHeight);
+    obj.pushKV("endheight", status.nEndHeight);
+    obj.pushKV("height", status.nHeight);
+    obj.pushKV("progress", (double)(status.nHeight - status.nStartHeight) / (status.nEndHeight - status.nStartHeight + 1));
+    obj.pushKV("bytes", status.nBytes);
+    obj.pushKV("threads", status.nThreads);
+    obj.pushKV("elapsed", (status.fRunning ? GetTime() : status.nEndTime) - status.nStartTime);
+    if (!status.strError.empty())
+        obj.pushKV("error", status.strError);
+    return obj;
+}
+
 UniValue checkprimegaplist(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
@@ -2253,39 +2169,116 @@ UniValue checkprimegaplist(const JSONRPCRequest& request)
             "checkprimegaplist startheight endheight\n"
             "\nReturns a list of formatted record gaps or improved merits appropriate for copying and"
             "\npasting into Seth Troisi’s online submission service at https://primegaps.cloudygo.com/.\n"
+            "The records are read from the local prime gap list file (-primegaplist), see refreshprimegaplist.\n"
             "\nArguments:\n"
             "1. startheight    (integer) First block number to check.\n"
             "2. endheight      (integer, default = chaintip) Last block number to check.\n"
             );
 
-    int nStartBlock = request.params[0].get_int();
-    CBlockIndex* pblockindex = chainActive[nStartBlock];
+    std::string strError;
+    std::shared_ptr<const CPrimeGapList> gaps = GetPrimeGapList(strError);
+    if (!gaps)
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
 
-    int nEndBlock = chainActive.Tip()->nHeight;
-    if (request.params.size() > 1)
-        nEndBlock = request.params[1].get_int();
-
-    std::map<int, float> gaps = getprimegaplist();
-    std::stringstream results;
-
-    while (pblockindex->nHeight < nEndBlock)
+    std::vector<const CBlockIndex*> vIndex;
     {
-        results << checkagainstprimegaplist(pblockindex, gaps);
-        pblockindex = chainActive.Next(pblockindex);
+        LOCK(cs_main);
+        int nStartBlock = request.params[0].get_int();
+        int nEndBlock = chainActive.Tip()->nHeight;
+        if (request.params.size() > 1)
+            nEndBlock = request.params[1].get_int();
+        if (nStartBlock < 0 || nEndBlock > chainActive.Height())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+
+        for (int h = nStartBlock; h < nEndBlock; h++)
+            vIndex.push_back(chainActive[h]);
+    }
+
+    // The gaps not cached yet are computed in slices on all cores
+    const size_t nThreads = std::max<size_t>(1, std::min<size_t>(GetNumCores(), vIndex.size() / 1000));
+    std::vector<std::string> vResults(nThreads);
+    // An exception is thrown on from here once all slices are done, instead of escaping a thread
+    std::vector<std::exception_ptr> vErrors(nThreads);
+    auto check = [&](size_t t) {
+        try {
+            const size_t nEnd = vIndex.size() * (t + 1) / nThreads;
+            for (size_t i = vIndex.size() * t / nThreads; i < nEnd; i++)
+                vResults[t] += checkagainstprimegaplist(vIndex[i], *gaps);
+        } catch (...) {
+            vErrors[t] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> vThreads;
+    for (size_t t = 1; t < nThreads; t++) {
+        try {
+            vThreads.emplace_back(check, t);
+        } catch (const std::system_error&) {
+            // Out of threads, so this slice is checked here
+            check(t);
+        }
+    }
+    check(0);
+    for (std::thread& thread : vThreads)
+        thread.join();
+    for (const std::exception_ptr& error : vErrors) {
+        if (error)
+            std::rethrow_exception(error);
     }
-    return results.str();
+
+    std::string results;
+    for (const std::string& str : vResults)
+        results += str;
+    return results;
+}
+
+UniValue refreshprimegaplist(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "refreshprimegaplist ( download )\n"
+            "\nRe-reads the prime gap list file used by checkprimegaplist (-primegaplist).\n"
+            "\nArguments:\n"
+            "1. download    (boolean, optional, default=false) First fetch allgaps.sql from the prime gap list project on GitHub into the file.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filename\": \"xxxx\",   (string) the prime gap list file\n"
+            "  \"records\": n          (numeric) the number of gap lengths with a record\n"
+            "}\n"
+            );
+
+    const fs::path path = GetPrimeGapListFile();
+    std::string strError;
+    if (!request.params[0].isNull() && request.params[0].get_bool() && !DownloadPrimeGapList(path, strError))
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+
+    std::shared_ptr<const CPrimeGapList> gaps = LoadPrimeGapList(path, strError);
+    if (!gaps)
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+
+    UniValue reply(UniValue::VOBJ);
+    reply.pushKV("filename", path.string());
+    reply.pushKV("records", (uint64_t)gaps->mapRecords.size());
+    return reply;
 }
 
 UniValue dumpbootstrap(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
+    if (request.fHelp || request.params.size() < 2 || request.params.size() > 4)
         throw std::runtime_error(
-            "dumpbootstrap filename endblock [startblock=0]\n"
-            "\nCreates a bootstrap format block dump of the blockchain in destination, which can be a directory or a path with filename, up to the given endblock number.\n"
+            "dumpbootstrap filename endblock [startblock=0] [resume=false]\n"
+            "\nStarts writing a bootstrap format block dump of the blockchain to destination, which can be a directory or a path with filename, up to the given endblock number.\n"
+            "The blocks are copied from the block files in the background; see getbootstrapinfo for the progress.\n"
             "\nOptional <startblock> is the first block number to dump.\n"
             "1. filename      (string) optional filename with path (either absolute or relative)\n"
             "2. endblock      Last block number to dump.\n"
-            "2. startblock    (numeric) optional first block number to dump (default 0).\n"
+            "3. startblock    (numeric) optional first block number to dump (default 0).\n"
+            "4. resume        (boolean) optional, continue an existing dump of the same startblock after its last complete block (default false).\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filename\": \"xxxx\",    (string) the file written to\n"
+            "  \"startheight\": n,      (numeric) the first block this run writes\n"
+            "  \"endheight\": n         (numeric) the last block it writes\n"
+            "}\n"
             );
 
 
@@ -2305,46 +2298,71 @@ UniValue dumpbootstrap(const JSONRPCRequest& request)
     if (nStartBlock < 0 || nStartBlock > nEndBlock)
         throw std::runtime_error("Start block number out of range.");
 
+    bool fResume = false;
+    if (request.params.size() > 3)
+        fResume = request.params[3].get_bool();
 
-    try {
-
-        boost::filesystem::path filepath = request.params[0].get_str();
-        filepath = boost::filesystem::absolute(filepath);
-
-        /* Prevent arbitrary files from being overwritten. There have been reports
-         * that users have overwritten wallet files this way:
-         * https://github.com/bitcoin/bitcoin/issues/9934
-         * It may also avoid other security issues.
-         */
-        if (boost::filesystem::exists(filepath)) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, filepath.string() + \
-                " already exists. If you are sure this is what you want, move it out of the way first");
-        }
-
-        FILE* file = fopen(filepath.string().c_str(), "wb");
-        if (!file)
-            throw JSONRPCError(RPC_MISC_ERROR, "Error: Could not open bootstrap file for writing.");
-
-        CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
-        if (fileout.IsNull())
-            return error("WriteBlockToDisk: OpenBlockFile failed");
-
-        CBlockIndex* pblockindex = chainActive[nStartBlock];
-        auto& consensus_params = Params().GetConsensus();
+    /* Prevent arbitrary files from being overwritten. There have been reports
+     * that users have overwritten wallet files this way:
+     * https://github.com/bitcoin/bitcoin/issues/9934
+     * It may also avoid other security issues.
+     */
+    if (!fResume && fs::exists(filepath)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, filepath.string() + \
+            " already exists. If you are sure this is what you want, move it out of the way first");
+    }
 
-        while (pblockindex->nHeight <= nEndBlock)
-        {
-            CBlock block;
-            ReadBlockFromDisk(block, pblockindex, consensus_params);
-            unsigned int nSize = GetSerializeSize(fileout, block);
-            fileout << FLATDATA(Params().MessageStart()) << nSize << block;
-            pblockindex = chainActive.Next(pblockindex);
-        }
-    } catch(const boost::filesystem::filesystem_error &e) {
+    std::string strError;
+    try {
+        if (!StartBootstrapDump(filepath, nStartBlock, nEndBlock, fResume, strError))
+            throw JSONRPCError(RPC_MISC_ERROR, "Error: " + strError);
+    } catch(const fs::filesystem_error &e) {
         throw JSONRPCError(RPC_MISC_ERROR, "Error: Bootstrap dump failed!");
     }
 
-    return NullUniValue;
+    CBootstrapDumpStatus status = GetBootstrapDumpStatus();
+    UniValue reply(UniValue::VOBJ);
+    reply.pushKV("filename", filepath.string());
+    reply.pushKV("startheight", status.nHeight);
+    reply.pushKV("endheight", status.nEndHeight);
+    return reply;
+}
+
+UniValue getbootstrapinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getbootstrapinfo\n"
+            "\nReturns the progress of the last dumpbootstrap.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"running\": true|false,   (boolean) whether the dump is still being written\n"
+            "  \"filename\": \"xxxx\",      (string) the file written to\n"
+            "  \"startheight\": n,        (numeric) the first block in the file\n"
+            "  \"endheight\": n,          (numeric) the last block to dump\n"
+            "  \"height\": n,             (numeric) the next block to be written; a resumed dump continues here\n"
+            "  \"progress\": x.xxx,       (numeric) the fraction of the blocks written\n"
+            "  \"bytes\": n,              (numeric) the size of the file\n"
+            "  \"elapsed\": n,            (numeric) seconds since the dump started\n"
+            "  \"error\": \"xxxx\"          (string, optional) why the dump stopped short\n"
+            "}\n"
+            );
+
+    CBootstrapDumpStatus status = GetBootstrapDumpStatus();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("running", status.fRunning);
+    if (status.path.empty())
+        return obj;
+    obj.pushKV("filename", status.path.string());
+    obj.pushKV("startheight", status.nStartHeight);
+    obj.pushKV("endheight", status.nEndHeight);
+    obj.pushKV("height", status.nHeight);
+    obj.pushKV("progress", (double)(status.nHeight - status.nStartHeight) / (status.nEndHeight - status.nStartHeight + 1));
+    obj.pushKV("bytes", status.nBytes);
+    obj.pushKV("elapsed", (status.fRunning ? GetTime() : status.nEndTime) - status.nStartTime);
+    if (!status.strError.empty())
+        obj.pushKV("error", status.strError);
+    return obj;
 }
 
 static const CRPCCommand commands[] =
@@ -2358,6 +2376,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockhash",           &getblockhash,           {"height"} },
     { "blockchain",         "getblockheader",         &getblockheader,         {"blockhash","verbose"} },
     { "blockchain",         "getchaintips",           &getchaintips,           {} },
+    { "blockchain",         "getcoinsflushinfo",      &getcoinsflushinfo,      {} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          {} },
     { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    {"txid","verbose"} },
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  {"txid","verbose"} },
@@ -2375,6 +2394,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "listprimerecords",       &listprimerecords,       {"merit"} },
     { "blockchain",         "listbestprimes",         &listbestprimes,         {"amount", "merit"} },
     { "blockchain",         "checkprimegaplist",      &checkprimegaplist,      {"start", "end"} },
+    { "blockchain",         "refreshprimegaplist",    &refreshprimegaplist,    {"download"} },
 
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        {"blockhash"} },
@@ -2383,10 +2403,12 @@ static const CRPCCommand commands[] =
     { "hidden",             "waitforblock",           &waitforblock,           {"blockhash","timeout"} },
     { "hidden",             "waitforblockheight",     &waitforblockheight,     {"height","timeout"} },
     { "hidden",             "syncwithvalidationinterfacequeue", &syncwithvalidationinterfacequeue, {} },
-    { "hidden",             "dumptriples",            &dumptriples,            {"filename", "start", "end"} },
+    { "hidden",             "dumptriples",            &dumptriples,            {"filename", "start", "end", "compression", "threads"} },
+    { "hidden",             "gettriplesinfo",         &gettriplesinfo,         {} },
     { "hidden",             "renderblock",            &renderblock,            {"block"} },
     { "hidden",             "renderblockhash",        &renderblockhash,        {"blockhash"} },
-    { "hidden",             "dumpbootstrap",          &dumpbootstrap,          {"filename", "end", "start"} },
+    { "hidden",             "dumpbootstrap",          &dumpbootstrap,          {"filename", "end", "start", "resume"} },
+    { "hidden",             "getbootstrapinfo",       &getbootstrapinfo,       {} },
 };
 
 void RegisterBlockchainRPCCommands(CRPCTable &t)
@@ -35,8 +35,10 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "setgenerate", 2, "shift" },
     { "setgenerate", 3, "sieveprimes" },
     { "setgenerate", 4, "sievesize" },
+    { "setgenerate", 5, "autotune" },
     { "generatetoaddress", 0, "nblocks" },
     { "generatetoaddress", 2, "maxtries" },
+    { "getminingstats", 0, "verbose" },
     { "getnetworkprimesps", 0, "nblocks" },
     { "getnetworkprimesps", 1, "height" },
     { "sendtoaddress", 1, "amount" },
@@ -70,6 +72,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "listaccounts", 1, "include_watchonly" },
     { "walletpassphrase", 1, "timeout" },
     { "getblocktemplate", 0, "template_request" },
+    { "validateshares", 0, "shares" },
     { "getwork", 0, "data" },
     { "listsinceblock", 1, "target_confirmations" },
     { "listsinceblock", 2, "include_watchonly" },
@@ -157,12 +160,15 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "renderblock", 0, "block" },
     { "dumptriples", 1, "start" },
     { "dumptriples", 2, "end" },
+    { "dumptriples", 4, "threads" },
     { "checkprimegaplist", 0, "start" },
     { "checkprimegaplist", 1, "end" },
+    { "refreshprimegaplist", 0, "download" },
     { "getnetworkhashps", 0, "lookup"},
     { "getnetworkhashps", 1, "height"},
     { "dumpbootstrap", 1, "end" },
     { "dumpbootstrap", 2, "start" },
+    { "dumpbootstrap", 3, "resume" },
 };
 
 class CRPCConvertTable
@@ -13,6 +13,7 @@
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <gapshares.h>
 #include <init.h>
 #include <validation.h>
 #include <miner.h>
@@ -29,6 +30,9 @@
 #include <wallet/wallet.h>
 #include <warnings.h>
 
+#include <chrono>
+#include <functional>
+#include <list>
 #include <memory>
 #include <stdint.h>
 
@@ -275,7 +279,7 @@ UniValue getprimespersec(const JSONRPCRequest& request)
             + HelpExampleRpc("getprimespersec", "")
         );
 
-    return (uint64_t)dHashesPerSec;
+    return (uint64_t)GetMiningStats().dPrimesPerSec;
 }
 
 
@@ -305,11 +309,13 @@ UniValue getgenerate(const JSONRPCRequest& request)
 
 UniValue setgenerate(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() < 1 || request.params.size() > 5)
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 6)
         throw std::runtime_error(
-            "setgenerate generate ( genproclimit ) ( sievesize ) ( sieveprimes ) ( shift )\n"
+            "setgenerate generate ( genproclimit ) ( shift ) ( sieveprimes ) ( sievesize ) ( autotune )\n"
             "\nSet 'generate' true or false to turn generation on or off.\n"
             "Generation is limited to 'genproclimit' processors, -1 is unlimited.\n"
+            "Turning generation off keeps the miner threads and their sieves around for a quick restart,\n"
+            "a 'genproclimit' of 0 releases them.\n"
             "See the getgenerate call for the current setting.\n"
             "\nArguments:\n"
             "1. generate         (boolean, required) Set to true to turn on generation, false to turn off.\n"
@@ -318,11 +324,16 @@ UniValue setgenerate(const JSONRPCRequest& request)
             "4. sieveprimes      (numeric, optional) Sets the amount of primes used in the sieve (advised: 900000).\n"
             "5. sievesize        (numeric, optional) Sets the size of the prime sieve (advised: 33554432).\n"
             "                    Note: sieve size can only have 2^shift size.\n"
+            "6. autotune         (boolean, optional) Let the miner measure sieveprimes and sievesize at the shift\n"
+            "                    and keep the best ones, see getmininginfo. Cannot be combined with sieveprimes or\n"
+            "                    sievesize; setting either of them turns tuning off.\n"
             "\nExamples:\n"
             "\nSet the generation on with a limit of one processor, default mining parameters\n"
             + HelpExampleCli("setgenerate", "true 1") +
             "\nSet the generation on with a limit of one processor, explicit mining parameters\n"
             + HelpExampleCli("setgenerate", "true 1 25 900000 33554432") +
+            "\nSet the generation on with all processors, tuning the sieve parameters at shift 25\n"
+            + HelpExampleCli("-named setgenerate", "generate=true genproclimit=-1 shift=25 autotune=true") +
             "\nTurn off generation\n"
             + HelpExampleCli("setgenerate", "false") +
             "\nUsing json rpc with default mining parameters\n"
@@ -348,29 +359,40 @@ UniValue setgenerate(const JSONRPCRequest& request)
             fGenerate = false;
     }
 
-    if (request.params.size() > 2)
+    // Tuning picks the sieve parameters, so it is refused along with them
+    const bool fSieveParams = !request.params[3].isNull() || !request.params[4].isNull();
+    const bool fAutoTune = !request.params[5].isNull() && request.params[5].get_bool();
+    if (fAutoTune && fSieveParams)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "sieveprimes and sievesize cannot be set with autotune");
+
+    if (!request.params[2].isNull())
     {
-        if (request.params[2].get_int() < 14)
+        int nShift = request.params[2].get_int();
+        if (nShift < 14)
             nMiningShift = 14;
-        else if (request.params[2].get_int() >= (1 << 16))
+        else if (nShift >= (1 << 16))
             nMiningShift = (1 << 16) - 1;
         else
-            nMiningShift = request.params[2].get_int();
+            nMiningShift = nShift;
     }
 
-    if (request.params.size() > 3)
+    if (!request.params[3].isNull())
     {
         nMiningPrimes = (request.params[3].get_int64() < 1000) ? 1000 : request.params[3].get_int64();
     }
 
-    if (request.params.size() > 4)
+    if (!request.params[4].isNull())
     {
         nMiningSieveSize = (request.params[4].get_int64() < 1000) ? 1000 : request.params[4].get_int64();
-
-        if (nMiningShift < 64 && nMiningSieveSize > (((uint64_t) 1) << nMiningShift))
-           nMiningSieveSize = (((uint64_t) 1) << nMiningShift);
     }
 
+    // Also when only the shift got smaller
+    if (nMiningShift < 64 && nMiningSieveSize > (((uint64_t) 1) << nMiningShift))
+       nMiningSieveSize = (((uint64_t) 1) << nMiningShift);
+
+    if (!request.params[5].isNull() || fSieveParams)
+        SetMiningAutoTune(fAutoTune);
+
     gArgs.SoftSetArg("-gen", (fGenerate ? "1" : "0"));
     gArgs.SoftSetArg("-genproclimit", itostr(nGenProcLimit));
     //mapArgs["-gen"] = (fGenerate ? "1" : "0");
@@ -379,9 +401,11 @@ UniValue setgenerate(const JSONRPCRequest& request)
 
     nGenProcLimit = nGenProcLimit >= 0 ? nGenProcLimit : numCores;
     std::string msg = "Mining with " + std::to_string(nGenProcLimit) + " of " + std::to_string(numCores) + " threads," + \
-            " shift " + std::to_string(nMiningShift) + \
-            " sieve-primes " + std::to_string(nMiningPrimes) + \
-            " sieve-size " + std::to_string(nMiningSieveSize);
+            " shift " + std::to_string(nMiningShift.load()) + \
+            " sieve-primes " + std::to_string(nMiningPrimes.load()) + \
+            " sieve-size " + std::to_string(nMiningSieveSize.load());
+    if (GetMiningTuneReport().fEnabled)
+        msg += ", tuning sieve parameters";
     if (fGenerate) {
         return msg;
     } else {
@@ -392,6 +416,29 @@ UniValue setgenerate(const JSONRPCRequest& request)
 
 static PoWUtils *powUtils = new PoWUtils;
 
+static UniValue MiningTuneToJSON(const CMiningTuneReport& report)
+{
+    UniValue measurements(UniValue::VARR);
+    for (const CMiningTuneResult& result : report.vResults) {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("shift",        result.nShift));
+        entry.push_back(Pair("sieveprimes",  result.nSievePrimes));
+        entry.push_back(Pair("sievesize",    result.nSieveSize));
+        entry.push_back(Pair("primespersec", (uint64_t)result.dPrimesPerSec));
+        entry.push_back(Pair("testspersec",  (uint64_t)result.dTestsPerSec));
+        entry.push_back(Pair("gapsperday",   result.dGapsPerDay));
+        measurements.push_back(entry);
+    }
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("enabled",      report.fEnabled));
+    obj.push_back(Pair("tuning",       report.fTuning));
+    obj.push_back(Pair("difficulty",   (double)report.nDifficulty / (1ULL << 48)));
+    obj.push_back(Pair("measurements", measurements));
+    obj.push_back(Pair("chosen",       report.nBest));
+    return obj;
+}
+
 UniValue getmininginfo(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -412,6 +459,25 @@ UniValue getmininginfo(const JSONRPCRequest& request)
             "  \"primespersec\": n          (numeric) The primes per second of the generation, or 0 if no generation.\n"
             "  \"testspersec\": n           (numeric) The primes tests per second of the generation, or 0 if no generation.\n"
             "  \"gapsperday\": xxx.xxxxx    (numeric) The estimated (difficulty) gaps per day\n"
+            "  \"hugepages\": \"xxxx\",       (string) The transparent huge page mode the sieves are allocated under (always, madvise, never), empty if unknown\n"
+            "  \"placement\": [             (json array) Where every miner thread runs, see -genpin\n"
+            "    {\n"
+            "      \"cpu\": n,                (numeric) The CPU the thread is pinned to, -1 if it isn't\n"
+            "      \"node\": n                (numeric) The NUMA node of that CPU, holding the thread's sieve, -1 if unknown\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"autotune\": {              (json object) The sieve parameter tuner, see setgenerate\n"
+            "    \"enabled\": true|false,   (boolean) If the tuner is on\n"
+            "    \"tuning\": true|false,    (boolean) If it is measuring right now\n"
+            "    \"difficulty\": xxx.xxxxx, (numeric) The difficulty the measurements were made at\n"
+            "    \"measurements\": [        (json array) The configurations measured so far\n"
+            "      {\n"
+            "        \"shift\": n, \"sieveprimes\": n, \"sievesize\": n,\n"
+            "        \"primespersec\": n, \"testspersec\": n, \"gapsperday\": xxx.xxxxx\n"
+            "      }, ...\n"
+            "    ],\n"
+            "    \"chosen\": n              (numeric) The index of the configuration in use, -1 while none was picked\n"
+            "  },\n"
             "  \"pooledtx\": n              (numeric) The size of the mempool\n"
             "  \"chain\": \"xxxx\",           (string) current network name as defined in BIP70 (main, test, regtest)\n"
             "  \"warnings\": \"...\"          (string) any network and blockchain warnings\n"
@@ -423,6 +489,17 @@ UniValue getmininginfo(const JSONRPCRequest& request)
         );
 
 
+    std::vector<CMiningStats> vPerThread;
+    CMiningStats stats = GetMiningStats(&vPerThread);
+
+    UniValue placement(UniValue::VARR);
+    for (const CMiningStats& thread : vPerThread) {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("cpu", thread.nCore));
+        entry.push_back(Pair("node", thread.nNode));
+        placement.push_back(entry);
+    }
+
     LOCK(cs_main);
 
     // For gaps_per_day
@@ -439,12 +516,15 @@ UniValue getmininginfo(const JSONRPCRequest& request)
     obj.push_back(Pair("difficulty",       (double)GetDifficulty()));
     obj.push_back(Pair("generate",         getgenerate()));
     obj.push_back(Pair("genproclimit",     (int64_t)gArgs.GetArg("-genproclimit", -1)));
-    obj.push_back(Pair("sievesize",        nMiningSieveSize));
-    obj.push_back(Pair("sieveprimes",      nMiningPrimes));
-    obj.push_back(Pair("shift",            nMiningShift));
-    obj.push_back(Pair("primespersec",     getprimespersec(request)));
-    obj.push_back(Pair("testspersec",      (int) dTestsPerSec));
-    obj.push_back(Pair("gapsperday",       powUtils->gaps_per_day(dHashesPerSec, difficulty)));
+    obj.push_back(Pair("sievesize",        nMiningSieveSize.load()));
+    obj.push_back(Pair("sieveprimes",      nMiningPrimes.load()));
+    obj.push_back(Pair("shift",            nMiningShift.load()));
+    obj.push_back(Pair("primespersec",     (uint64_t)stats.dPrimesPerSec));
+    obj.push_back(Pair("testspersec",      (int) stats.dTestsPerSec));
+    obj.push_back(Pair("gapsperday",       powUtils->gaps_per_day(stats.dPrimesPerSec, difficulty)));
+    obj.push_back(Pair("hugepages",        GetTransparentHugePages()));
+    obj.push_back(Pair("placement",        placement));
+    obj.push_back(Pair("autotune",         MiningTuneToJSON(GetMiningTuneReport())));
     obj.push_back(Pair("networkprimesps",  getnetworkprimesps(request)));
     obj.push_back(Pair("pooledtx",         (uint64_t)mempool.size()));
     obj.push_back(Pair("testnet",          TestNet()));
@@ -458,6 +538,68 @@ UniValue getmininginfo(const JSONRPCRequest& request)
     return obj;
 }
 
+static UniValue MiningStatsToJSON(const CMiningStats& stats)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("primespersec",       (uint64_t)stats.dPrimesPerSec));
+    obj.push_back(Pair("testspersec",        (uint64_t)stats.dTestsPerSec));
+    obj.push_back(Pair("passes",             stats.nPasses));
+    obj.push_back(Pair("avgpassms",          stats.nPasses ? 0.001 * stats.nPassMicros / stats.nPasses : 0.0));
+    obj.push_back(Pair("testsperpass",       stats.nPasses ? stats.nTests / stats.nPasses : 0));
+    UniValue gaps(UniValue::VOBJ);
+    for (unsigned int i = 0; i < MINING_MERIT_BUCKETS; i++) {
+        if (stats.vGapsByMerit[i])
+            gaps.push_back(Pair(i + 1 < MINING_MERIT_BUCKETS ? itostr(i) : itostr(i) + "+", stats.vGapsByMerit[i]));
+    }
+    obj.push_back(Pair("gaps",               gaps));
+    return obj;
+}
+
+UniValue getminingstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getminingstats ( verbose )\n"
+            "\nReturns counters of the internal miner since its threads were started.\n"
+            "\nArguments:\n"
+            "1. verbose          (boolean, optional, default=false) Also list the counters of every thread\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"threads\": n,              (numeric) The number of miner threads\n"
+            "  \"primespersec\": n,         (numeric) The primes per second of the last sieve pass of every thread\n"
+            "  \"testspersec\": n,          (numeric) The prime tests per second of the last sieve pass of every thread\n"
+            "  \"passes\": n,               (numeric) The number of sieve passes\n"
+            "  \"avgpassms\": x.xxx,        (numeric) The average time of a sieve pass, sieving and testing, in milliseconds\n"
+            "  \"testsperpass\": n,         (numeric) The average number of candidates tested per sieve pass\n"
+            "  \"gaps\": {                  (json object) The gaps reported by the sieve, by merit rounded down\n"
+            "    \"merit\": n,              (numeric) The number of gaps\n"
+            "    ...\n"
+            "  },\n"
+            "  \"perthread\": [ ... ]       (json array, verbose only) The same counters for every thread\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getminingstats", "")
+            + HelpExampleCli("getminingstats", "true")
+            + HelpExampleRpc("getminingstats", "true")
+        );
+
+    bool fVerbose = !request.params[0].isNull() && request.params[0].get_bool();
+
+    std::vector<CMiningStats> vPerThread;
+    CMiningStats stats = GetMiningStats(fVerbose ? &vPerThread : nullptr);
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("threads", stats.nThreads));
+    obj.pushKVs(MiningStatsToJSON(stats));
+    if (fVerbose) {
+        UniValue threads(UniValue::VARR);
+        for (const CMiningStats& thread : vPerThread)
+            threads.push_back(MiningStatsToJSON(thread));
+        obj.push_back(Pair("perthread", threads));
+    }
+    return obj;
+}
+
 
 // NOTE: Unlike wallet RPC (which use BTC values), mining RPCs follow GBT (BIP 22) in using satoshi amounts
 UniValue prioritisetransaction(const JSONRPCRequest& request)
@@ -522,6 +664,175 @@ std::string gbt_vb_name(const Consensus::DeploymentPos pos) {
     return s;
 }
 
+namespace {
+
+/**
+ * Long polls of getblocktemplate and getwork. A poll watches the tip and
+ * mempool.GetTransactionsUpdated() its longpollid was issued for. It ends as
+ * soon as the tip moves, or once it has waited a minute and the mempool has
+ * changed. Polls over HTTP are parked without a thread (JSONRPCDeferred),
+ * others block on cvLongPoll; both are woken from the validation interface,
+ * with a single RPC timer for the one-minute mark. A parked poll is dropped
+ * again if its client disconnects.
+ */
+struct CLongPollWaiter
+{
+    uint64_t nId;
+    uint256 hashWatchedChain;
+    unsigned int nTransactionsUpdated;
+    //! From then on mempool changes end the poll too
+    std::chrono::steady_clock::time_point due;
+    std::function<void()> resume;
+};
+
+const std::chrono::seconds LONGPOLL_MEMPOOL_WAIT(60);
+
+CWaitableCriticalSection csLongPoll;
+CConditionVariable cvLongPoll;
+std::list<CLongPollWaiter> lLongPollWaiters;
+uint64_t nLongPollWaiterLastId = 0;
+//! When the armed RPC timer fires, max() if none is
+std::chrono::steady_clock::time_point longPollTimerDue = std::chrono::steady_clock::time_point::max();
+
+bool LongPollDone(const uint256& hashWatchedChain, unsigned int nTransactionsUpdated, std::chrono::steady_clock::time_point due)
+{
+    {
+        WaitableLock lock(csBestBlock);
+        if (hashBestBlock != hashWatchedChain)
+            return true;
+    }
+    return std::chrono::steady_clock::now() >= due && mempool.GetTransactionsUpdated() != nTransactionsUpdated;
+}
+
+/** Resume the parked polls that are over and wake the blocked ones to check */
+void NotifyLongPolls()
+{
+    std::vector<std::function<void()> > vResume;
+    std::chrono::steady_clock::time_point nextDue = std::chrono::steady_clock::time_point::max();
+    {
+        WaitableLock lock(csLongPoll);
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for (std::list<CLongPollWaiter>::iterator it = lLongPollWaiters.begin(); it != lLongPollWaiters.end(); ) {
+            if (!IsRPCRunning() || LongPollDone(it->hashWatchedChain, it->nTransactionsUpdated, it->due)) {
+                vResume.push_back(std::move(it->resume));
+                it = lLongPollWaiters.erase(it);
+            } else {
+                if (it->due > now)
+                    nextDue = std::min(nextDue, it->due);
+                ++it;
+            }
+        }
+        cvLongPoll.notify_all();
+
+        // Waiters are due in the order they came, so an armed timer only
+        // needs replacing once it has fired
+        if (nextDue != std::chrono::steady_clock::time_point::max() && longPollTimerDue == std::chrono::steady_clock::time_point::max()) {
+            int64_t nSeconds = std::chrono::duration_cast<std::chrono::seconds>(nextDue - now).count() + 1;
+            try {
+                RPCRunLater("longpoll", [] {
+                    {
+                        WaitableLock lock(csLongPoll);
+                        longPollTimerDue = std::chrono::steady_clock::time_point::max();
+                    }
+                    // Run from the validation queue: a timer may not re-arm itself from its own callback
+                    CallFunctionInValidationInterfaceQueue(NotifyLongPolls);
+                }, nSeconds);
+                longPollTimerDue = now + std::chrono::seconds(nSeconds);
+            } catch (const UniValue&) {
+                // No timer while RPC shuts down; every poll is resumed by StopRPCLongPoll
+            }
+        }
+    }
+
+    for (const std::function<void()>& resume : vResume)
+        resume();
+}
+
+class CLongPollNotifier final : public CValidationInterface
+{
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override
+    {
+        NotifyLongPolls();
+    }
+
+    void TransactionAddedToMempool(const CTransactionRef& ptx) override
+    {
+        NotifyLongPolls();
+    }
+};
+
+CLongPollNotifier longPollNotifier;
+
+/**
+ * Wait until the long poll for the given state is over. Called with cs_main
+ * held: a request that can be parked throws JSONRPCDeferred (unwinding the
+ * lock), any other waits on cvLongPoll with cs_main released.
+ */
+void WaitForLongPoll(const JSONRPCRequest& request, const uint256& hashWatchedChain, unsigned int nTransactionsUpdated)
+{
+    AssertLockHeld(cs_main);
+
+    // A resumed request only gets here once its poll is over
+    if (request.fResumed)
+        return;
+
+    std::chrono::steady_clock::time_point due = std::chrono::steady_clock::now() + LONGPOLL_MEMPOOL_WAIT;
+    if (LongPollDone(hashWatchedChain, nTransactionsUpdated, due))
+        return;
+
+    if (request.fCanDefer) {
+        JSONRPCDeferred deferred;
+        deferred.park = [hashWatchedChain, nTransactionsUpdated, due](const std::function<void()>& resume) -> std::function<bool()> {
+            uint64_t nId;
+            {
+                WaitableLock lock(csLongPoll);
+                nId = ++nLongPollWaiterLastId;
+                lLongPollWaiters.push_back(CLongPollWaiter{nId, hashWatchedChain, nTransactionsUpdated, due, resume});
+            }
+            // Catches a change that happened since the check above
+            NotifyLongPolls();
+            return [nId] {
+                WaitableLock lock(csLongPoll);
+                for (std::list<CLongPollWaiter>::iterator it = lLongPollWaiters.begin(); it != lLongPollWaiters.end(); ++it) {
+                    if (it->nId == nId) {
+                        lLongPollWaiters.erase(it);
+                        return true;
+                    }
+                }
+                return false;
+            };
+        };
+        throw deferred;
+    }
+
+    LEAVE_CRITICAL_SECTION(cs_main);
+    {
+        WaitableLock lock(csLongPoll);
+        while (!LongPollDone(hashWatchedChain, nTransactionsUpdated, due) && IsRPCRunning()) {
+            if (std::chrono::steady_clock::now() < due)
+                cvLongPoll.wait_until(lock, due);
+            else
+                cvLongPoll.wait(lock);
+        }
+    }
+    ENTER_CRITICAL_SECTION(cs_main);
+}
+
+}
+
+void StartRPCLongPoll()
+{
+    RegisterValidationInterface(&longPollNotifier);
+}
+
+void StopRPCLongPoll()
+{
+    UnregisterValidationInterface(&longPollNotifier);
+    // With RPC stopped, every parked poll is resumed into a "Shutting down" error
+    NotifyLongPolls();
+}
+
 static inline void CBlockToCharAry(CBlock* pblock, char* pdata)
 {
 
@@ -536,18 +847,20 @@ static inline void CBlockToCharAry(CBlock* pblock, char* pdata)
 #ifdef ENABLE_WALLET
 UniValue getwork(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() > 1)
+    if (request.fHelp || request.params.size() > 2)
         throw runtime_error(
-            "getwork ( \"data\" )\n"
+            "getwork ( \"data\" \"longpollid\" )\n"
             "\nIf 'data' is not specified, it returns the formatted hash data to work on.\n"
             "If 'data' is specified, tries to solve the block and returns true if it was successful.\n"
             "\nArguments:\n"
             "1. \"data\"       (string, optional) The hex encoded data to solve\n"
+            "2. \"longpollid\" (string, optional) Without 'data': wait until the work for this longpollid is outdated\n"
             "\nResult (when 'data' is not specified):\n"
             "{\n"
             "  \"data\" : \"xxxxx\",      (string) The block data\n"
             "  \"hash\" : \"xxxxx\",      (string) The block hash\n" 
-            "  \"difficulty\" : \"xxxx\"  (numeric) The current difficulty\n"
+            "  \"difficulty\" : \"xxxx\", (numeric) The current difficulty\n"
+            "  \"longpollid\" : \"xxxx\"  (string) id to wait for new work with\n"
             "}\n"
             "\nResult (when 'data' is specified):\n"
             "true|false       (boolean) If solving the block specified in the 'data' was successfull\n"
@@ -572,10 +885,25 @@ UniValue getwork(const JSONRPCRequest& request)
     typedef map<uint256, pair<CBlock*, CScript> > mapNewBlock_t;
     static mapNewBlock_t mapNewBlock;    // FIXME: thread safety
     static vector<std::unique_ptr<CBlockTemplate>> vNewBlockTemplate;
+    static unsigned int nTransactionsUpdatedLast;
 
-    if (request.params.size() == 0)
+    if (request.params[0].isNull())
     {
-        
+        if (!request.params[1].isNull())
+        {
+            // Format: <hashBestChain><nTransactionsUpdatedLast>, as for getblocktemplate
+            std::string lpstr = request.params[1].get_str();
+            uint256 hashWatchedChain;
+            hashWatchedChain.SetHex(lpstr.substr(0, 64));
+            unsigned int nTransactionsUpdatedLastLP = atoi64(lpstr.substr(64));
+
+            // Park the request, or wait without the main lock
+            WaitForLongPoll(request, hashWatchedChain, nTransactionsUpdatedLastLP);
+
+            if (!IsRPCRunning())
+                throw JSONRPCError(RPC_CLIENT_NOT_CONNECTED, "Shutting down");
+        }
+
         // If the keypool is exhausted, no script is returned at all.  Catch this.
         if (!coinbaseScript)
             throw JSONRPCError(RPC_WALLET_KEYPOOL_RAN_OUT, "Error: Keypool ran out, please call keypoolrefill first");
@@ -586,7 +914,6 @@ UniValue getwork(const JSONRPCRequest& request)
         
         // Update block
         WaitableLock lock(csBestBlock);
-        static unsigned int nTransactionsUpdatedLast;
         static CBlockIndex* pindexPrev;
         static int64_t nStart;
         static std::unique_ptr<CBlockTemplate> pblocktemplate;
@@ -643,6 +970,7 @@ UniValue getwork(const JSONRPCRequest& request)
         result.push_back(Pair("data",         HexStr(BEGIN(pdata), END(pdata))));
         result.push_back(Pair("hash",         pblock->GetHash().GetHex()));
         result.push_back(Pair("difficulty",   pblock->nDifficulty));
+        result.push_back(Pair("longpollid",   chainActive.Tip()->GetBlockHash().GetHex() + i64tostr(nTransactionsUpdatedLast)));
         return result;
     }
     else
@@ -845,7 +1173,6 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     {
         // Wait to respond until either the best block changes, OR a minute has passed and there are more transactions
         uint256 hashWatchedChain;
-        std::chrono::steady_clock::time_point checktxtime;
         unsigned int nTransactionsUpdatedLastLP;
 
         if (lpval.isStr())
@@ -863,24 +1190,8 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
             nTransactionsUpdatedLastLP = nTransactionsUpdatedLast;
         }
 
-        // Release the wallet and main lock while waiting
-        LEAVE_CRITICAL_SECTION(cs_main);
-        {
-            checktxtime = std::chrono::steady_clock::now() + std::chrono::minutes(1);
-
-            WaitableLock lock(csBestBlock);
-            while (hashBestBlock == hashWatchedChain && IsRPCRunning())
-            {
-                if (cvBlockChange.wait_until(lock, checktxtime) == std::cv_status::timeout)
-                {
-                    // Timeout: Check transactions for update
-                    if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLastLP)
-                        break;
-                    checktxtime += std::chrono::seconds(10);
-                }
-            }
-        }
-        ENTER_CRITICAL_SECTION(cs_main);
+        // Park the request, or wait without the main lock
+        WaitForLongPoll(request, hashWatchedChain, nTransactionsUpdatedLastLP);
 
         if (!IsRPCRunning())
             throw JSONRPCError(RPC_CLIENT_NOT_CONNECTED, "Shutting down");
@@ -1367,20 +1678,95 @@ UniValue estimaterawfee(const JSONRPCRequest& request)
     return result;
 }
 
+UniValue validateshares(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "validateshares [{\"header\":\"hex\",\"difficulty\":x},...]\n"
+            "\nChecks pool shares: gaps that only need to reach a share difficulty below the network difficulty.\n"
+            "The shares are checked in parallel and remembered, so a share submitted again is reported as a duplicate.\n"
+            "Only shares whose gap also reaches the difficulty in their header are checked against the chain.\n"
+            "\nArguments:\n"
+            "1. shares                (array, required) the shares to check\n"
+            "     [\n"
+            "       {\n"
+            "         \"header\": \"hex\",     (string, required) the serialized block header, including nShift and nAdd\n"
+            "         \"difficulty\": x      (numeric, required) the merit the gap has to reach\n"
+            "       }\n"
+            "       ,...\n"
+            "     ]\n"
+            "\nResult:\n"
+            "[                       (array) one result per share, in order\n"
+            "  {\n"
+            "    \"hash\": \"hex\",         (string) the header hash\n"
+            "    \"valid\": true|false,   (boolean) whether the gap reaches the share difficulty\n"
+            "    \"merit\": x.xxx,        (numeric) the merit of the gap, if valid\n"
+            "    \"block\": true|false,   (boolean) whether the gap is also a block on top of the active chain, to be sent with submitblock\n"
+            "    \"reject-reason\": \"xxx\" (string, optional) duplicate, high-shift or low-merit\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("validateshares", "'[{\"header\":\"mydata\",\"difficulty\":16}]'")
+            + HelpExampleRpc("validateshares", "[{\"header\":\"mydata\",\"difficulty\":16}]")
+        );
+
+    const UniValue& shares = request.params[0].get_array();
+    std::vector<CGapShare> vShares(shares.size());
+    for (size_t i = 0; i < shares.size(); i++) {
+        const UniValue& share = shares[i].get_obj();
+        RPCTypeCheckObj(share,
+            {
+                {"header", UniValueType(UniValue::VSTR)},
+                {"difficulty", UniValueType(UniValue::VNUM)},
+            });
+        if (!IsHex(share["header"].get_str()))
+            throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Header decode failed");
+        CDataStream ssHeader(ParseHex(share["header"].get_str()), SER_NETWORK, PROTOCOL_VERSION);
+        try {
+            ssHeader >> vShares[i].header;
+        } catch (const std::exception&) {
+            throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Header decode failed");
+        }
+        double dDifficulty = share["difficulty"].get_real();
+        if (dDifficulty <= 0 || dDifficulty >= 65536)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Share difficulty out of range");
+        vShares[i].nShareDifficulty = dDifficulty * (1ULL << 48);
+    }
+
+    std::vector<CGapShareResult> vResults = GetGapShareValidator().Validate(vShares, GetNumCores());
+
+    UniValue results(UniValue::VARR);
+    for (const CGapShareResult& result : vResults) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("hash", result.hash.GetHex());
+        obj.pushKV("valid", result.fValid);
+        if (result.fValid)
+            obj.pushKV("merit", (double)result.nMerit / (1ULL << 48));
+        obj.pushKV("block", result.fBlock);
+        if (!result.strReject.empty())
+            obj.pushKV("reject-reason", result.strReject);
+        results.push_back(obj);
+    }
+    return results;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
     { "mining",             "getnetworkhashps",       &getnetworkhashps,       {"nblocks","height"} },
     { "mining",             "getmininginfo",          &getmininginfo,          {} },
+    { "mining",             "getminingstats",         &getminingstats,         {"verbose"} },
     { "mining",             "prioritisetransaction",  &prioritisetransaction,  {"txid","dummy","fee_delta"} },
     { "mining",             "getblocktemplate",       &getblocktemplate,       {"template_request"} },
     { "mining",             "submitblock",            &submitblock,            {"hexdata","dummy"} },
+    { "mining",             "validateshares",         &validateshares,         {"shares"} },
 
 #if ENABLE_WALLET
     /* Coin generation */
-    { "generating",         "getwork",                &getwork,                {"data"} },
+    { "generating",         "getwork",                &getwork,                {"data","longpollid"} },
     { "generating",         "getgenerate",            &getgenerate,            {}  },
-    { "generating",         "setgenerate",            &setgenerate,            {"generate", "genproclimit", "shift", "sieveprimes", "sievesize"}  },
+    { "generating",         "setgenerate",            &setgenerate,            {"generate", "genproclimit", "shift", "sieveprimes", "sievesize", "autotune"}  },
 #endif
     { "generating",         "generatetoaddress",      &generatetoaddress,      {"nblocks","address","maxtries"} },
 
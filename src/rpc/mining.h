@@ -16,6 +16,11 @@ static const int DEFAULT_GENERATE_THREADS = 1;
 void InitRPCMining();
 void ShutdownRPCMining();
 
+/** Start waking getblocktemplate and getwork long polls from the validation interface */
+void StartRPCLongPoll();
+/** Stop doing so, ending every poll still waiting. Call once RPC has stopped. */
+void StopRPCLongPoll();
+
 /** Generate blocks (mine) */
 UniValue generateBlocks(std::shared_ptr<CReserveScript> coinbaseScript, int nGenerate, uint64_t nMaxTries, bool keepScript);
 
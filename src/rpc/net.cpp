@@ -95,6 +95,7 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
             "    \"addnode\": true|false,     (boolean) Whether connection was due to addnode/-connect or if it was an automatic/inbound connection\n"
             "    \"startingheight\": n,       (numeric) The starting height (block) of the peer\n"
             "    \"banscore\": n,             (numeric) The ban score\n"
+            "    \"powchecktime\": n,         (numeric) Seconds spent verifying the proofs of work this peer sent\n"
             "    \"synced_headers\": n,       (numeric) The last header we have in common with this peer\n"
             "    \"synced_blocks\": n,        (numeric) The last block we have in common with this peer\n"
             "    \"inflight\": [\n"
@@ -160,6 +161,7 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
         obj.push_back(Pair("startingheight", stats.nStartingHeight));
         if (fStateStats) {
             obj.push_back(Pair("banscore", statestats.nMisbehavior));
+            obj.push_back(Pair("powchecktime", 0.000001 * statestats.nPoWCheckMicros));
             obj.push_back(Pair("synced_headers", statestats.nSyncHeight));
             obj.push_back(Pair("synced_blocks", statestats.nCommonHeight));
             UniValue heights(UniValue::VARR);
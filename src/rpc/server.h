@@ -11,6 +11,7 @@
 #include <rpc/protocol.h>
 #include <uint256.h>
 
+#include <functional>
 #include <list>
 #include <map>
 #include <stdint.h>
@@ -46,11 +47,29 @@ public:
     bool fHelp;
     std::string URI;
     std::string authUser;
+    //! Whether the caller can park this request rather than block on it (see JSONRPCDeferred)
+    bool fCanDefer;
+    //! Set when a parked request is run again because its wait is over
+    bool fResumed;
 
-    JSONRPCRequest() : id(NullUniValue), params(NullUniValue), fHelp(false) {}
+    JSONRPCRequest() : id(NullUniValue), params(NullUniValue), fHelp(false), fCanDefer(false), fResumed(false) {}
     void parse(const UniValue& valRequest);
 };
 
+/**
+ * Thrown by a long-poll method (getblocktemplate, getwork) whose wait is not
+ * over yet, when the request allows it. Instead of holding a thread, the
+ * caller keeps the request aside and hands park() the function that runs it
+ * again, with fResumed set, once the method calls it. park() returns a
+ * function that drops the request instead, when its client has gone away;
+ * that one returns false if the request was resumed already. Deliberately
+ * not a std::exception, so CRPCTable::execute lets it through.
+ */
+struct JSONRPCDeferred
+{
+    std::function<std::function<bool()>(const std::function<void()>& resume)> park;
+};
+
 /** Query whether RPC is running */
 bool IsRPCRunning();
 
@@ -122,7 +141,8 @@ void RPCUnsetTimerInterface(RPCTimerInterface *iface);
 
 /**
  * Run func nSeconds from now.
- * Overrides previous timer <name> (if any).
+ * Overrides previous timer <name> (if any). Safe to call from any thread,
+ * but not from within func itself.
  */
 void RPCRunLater(const std::string& name, std::function<void(void)> func, int64_t nSeconds);
 
@@ -0,0 +1,120 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bootstrap.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <streams.h>
+#include <utiltime.h>
+#include <validation.h>
+#include <test/test_bitcoin.h>
+
+#include <fstream>
+#include <iterator>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** The bootstrap records of blocks nStart..nEnd, serialized the old way */
+std::string ExpectedDump(int nStart, int nEnd)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    LOCK(cs_main);
+    for (int h = nStart; h <= nEnd; h++) {
+        CBlock block;
+        BOOST_CHECK(ReadBlockFromDisk(block, chainActive[h], Params().GetConsensus()));
+        unsigned int nSize = GetSerializeSize(ss, block);
+        ss << FLATDATA(Params().MessageStart()) << nSize << block;
+    }
+    return ss.str();
+}
+
+std::string ReadDump(const fs::path& path)
+{
+    std::ifstream file(path.string(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+CBootstrapDumpStatus WaitForDump()
+{
+    CBootstrapDumpStatus status;
+    for (int i = 0; i < 1000 && (status = GetBootstrapDumpStatus()).fRunning; i++)
+        MilliSleep(10);
+    return status;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(bootstrap_tests)
+
+BOOST_FIXTURE_TEST_CASE(bootstrap_dump_matches_blocks, TestChain100Setup)
+{
+    const int nTip = chainActive.Height();
+    const fs::path path = pathTemp / "bootstrap.dat";
+    std::string strError;
+    BOOST_CHECK(StartBootstrapDump(path, 0, nTip, false, strError));
+    CBootstrapDumpStatus status = WaitForDump();
+    BOOST_CHECK(!status.fRunning);
+    BOOST_CHECK_EQUAL(status.strError, "");
+    BOOST_CHECK_EQUAL(status.nHeight, nTip + 1);
+
+    const std::string strExpected = ExpectedDump(0, nTip);
+    BOOST_CHECK_EQUAL(status.nBytes, strExpected.size());
+    BOOST_CHECK(ReadDump(path) == strExpected);
+
+    // Never overwritten without resume
+    BOOST_CHECK(!StartBootstrapDump(path, 0, nTip, false, strError));
+}
+
+BOOST_FIXTURE_TEST_CASE(bootstrap_dump_resumes, TestChain100Setup)
+{
+    const int nTip = chainActive.Height();
+    const fs::path path = pathTemp / "bootstrap.dat";
+    const std::string strExpected = ExpectedDump(10, nTip);
+    std::string strError;
+
+    // The first half, then a cut through a record, as an interrupted dump leaves it
+    BOOST_CHECK(StartBootstrapDump(path, 10, 50, false, strError));
+    BOOST_CHECK_EQUAL(WaitForDump().strError, "");
+    {
+        const size_t nLength = fs::file_size(path);
+        std::ofstream file(path.string(), std::ios::binary | std::ios::app);
+        file.write(strExpected.data() + nLength, 50);
+    }
+
+    BOOST_CHECK(StartBootstrapDump(path, 10, nTip, true, strError));
+    CBootstrapDumpStatus status = WaitForDump();
+    BOOST_CHECK_EQUAL(status.strError, "");
+    BOOST_CHECK_EQUAL(status.nStartHeight, 10);
+    BOOST_CHECK_EQUAL(status.nHeight, nTip + 1);
+    BOOST_CHECK(ReadDump(path) == strExpected);
+}
+
+BOOST_FIXTURE_TEST_CASE(bootstrap_resume_checks_file, TestChain100Setup)
+{
+    const int nTip = chainActive.Height();
+    std::string strError;
+
+    // Anything else is left alone
+    const fs::path pathOther = pathTemp / "wallet.dat";
+    {
+        std::ofstream file(pathOther.string(), std::ios::binary);
+        file << "not a bootstrap file";
+    }
+    BOOST_CHECK(!StartBootstrapDump(pathOther, 0, nTip, true, strError));
+    BOOST_CHECK(strError.find("is not a bootstrap file") != std::string::npos);
+    BOOST_CHECK_EQUAL(ReadDump(pathOther), "not a bootstrap file");
+
+    // The blocks of another start height are not continued from
+    const fs::path path = pathTemp / "bootstrap.dat";
+    BOOST_CHECK(StartBootstrapDump(path, 10, 50, false, strError));
+    BOOST_CHECK_EQUAL(WaitForDump().strError, "");
+    const std::string strDump = ReadDump(path);
+    BOOST_CHECK(!StartBootstrapDump(path, 20, nTip, true, strError));
+    BOOST_CHECK(strError.find("does not hold the active chain blocks") != std::string::npos);
+    BOOST_CHECK(ReadDump(path) == strDump);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
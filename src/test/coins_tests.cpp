@@ -8,6 +8,7 @@
 #include <undo.h>
 #include <utilstrencodings.h>
 #include <test/test_bitcoin.h>
+#include <txdb.h>
 #include <validation.h>
 #include <consensus/validation.h>
 
@@ -855,4 +856,79 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_sync)
+{
+    CCoinsViewDB db(1 << 20, true);
+    CCoinsViewFlusher flusher(&db);
+    CCoinsViewCacheTest cache(&flusher);
+
+    std::vector<COutPoint> outpoints;
+    for (int i = 0; i < 1000; i++) {
+        outpoints.emplace_back(InsecureRand256(), 0);
+        CTxOut out(InsecureRandRange(MAX_MONEY), CScript() << std::vector<unsigned char>(InsecureRandRange(64), 0));
+        cache.AddCoin(outpoints.back(), Coin(out, 1, false), false);
+    }
+    const uint256 hashBlock = InsecureRand256();
+    cache.SetBestBlock(hashBlock);
+
+    // Everything is written, and stays cached unmodified
+    BOOST_CHECK(cache.Sync(std::numeric_limits<size_t>::max()));
+    BOOST_CHECK(flusher.GetBestBlock() == hashBlock);
+    BOOST_CHECK(flusher.HaveCoin(outpoints[0]));
+    BOOST_CHECK(flusher.Wait());
+    BOOST_CHECK(db.GetBestBlock() == hashBlock);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), outpoints.size());
+    for (const auto& entry : cache.map())
+        BOOST_CHECK_EQUAL(entry.second.flags, 0);
+    for (const COutPoint& outpoint : outpoints)
+        BOOST_CHECK(db.HaveCoin(outpoint));
+    cache.SelfTest();
+
+    // Spent coins are erased from the database and dropped from the cache
+    for (size_t i = 0; i < outpoints.size(); i += 2)
+        BOOST_CHECK(cache.SpendCoin(outpoints[i]));
+    BOOST_CHECK(cache.Sync(std::numeric_limits<size_t>::max()));
+    BOOST_CHECK(!flusher.HaveCoin(outpoints[0]));
+    BOOST_CHECK(flusher.Wait());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), outpoints.size() / 2);
+    for (size_t i = 0; i < outpoints.size(); i++)
+        BOOST_CHECK_EQUAL(db.HaveCoin(outpoints[i]), i % 2 == 1);
+    cache.SelfTest();
+
+    // Over the limit, the coins modified since the last sync are kept first
+    Coin coin = cache.AccessCoin(outpoints[1]);
+    cache.SpendCoin(outpoints[1]);
+    cache.AddCoin(outpoints[1], std::move(coin), false);
+    const size_t nUsage = cache.DynamicMemoryUsage();
+    BOOST_CHECK(cache.Sync(nUsage / 4));
+    BOOST_CHECK(flusher.Wait());
+    BOOST_CHECK(cache.DynamicMemoryUsage() < nUsage / 2);
+    BOOST_CHECK(cache.GetCacheSize() > 0);
+    BOOST_CHECK(cache.GetCacheSize() < outpoints.size() / 2);
+    BOOST_CHECK(cache.map().count(outpoints[1]));
+    cache.SelfTest();
+    for (size_t i = 1; i < outpoints.size(); i += 2)
+        BOOST_CHECK(cache.HaveCoin(outpoints[i]));
+
+    // The batch counts against the limit, so with every coin modified the
+    // ones that don't fit are handed over rather than copied
+    for (size_t i = 0; i < outpoints.size(); i += 2) {
+        CTxOut out(InsecureRandRange(MAX_MONEY), CScript() << std::vector<unsigned char>(InsecureRandRange(64), 0));
+        cache.AddCoin(outpoints[i], Coin(out, 2, false), false);
+    }
+    const size_t nUsageModified = cache.DynamicMemoryUsage();
+    BOOST_CHECK(cache.Sync(nUsageModified));
+    BOOST_CHECK(cache.DynamicMemoryUsage() < nUsageModified);
+    BOOST_CHECK(flusher.DynamicMemoryUsage() > 0);
+    BOOST_CHECK(flusher.Wait());
+    BOOST_CHECK_EQUAL(flusher.DynamicMemoryUsage(), 0U);
+    cache.SelfTest();
+    for (const COutPoint& outpoint : outpoints)
+        BOOST_CHECK(cache.HaveCoin(outpoint));
+
+    const CCoinsFlushStats stats = flusher.GetStats();
+    BOOST_CHECK_EQUAL(stats.nWrites, 4U);
+    BOOST_CHECK_EQUAL(stats.nWritingEntries, 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
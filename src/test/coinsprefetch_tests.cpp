@@ -0,0 +1,128 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coinsprefetch.h>
+#include <consensus/merkle.h>
+#include <test/test_bitcoin.h>
+#include <txdb.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** A block spending n coins written to db, and one output of its own first transaction */
+std::shared_ptr<CBlock> BlockSpendingCoins(CCoinsViewDB& db, int n)
+{
+    CCoinsMap mapCoins;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.emplace_back(50 * COIN, CScript() << OP_TRUE);
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+    pblock->vtx.push_back(MakeTransactionRef(coinbase));
+
+    CMutableTransaction parent;
+    for (int i = 0; i < n; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(InsecureRand256(), InsecureRandRange(4));
+        tx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+        CCoinsCacheEntry& entry = mapCoins[tx.vin[0].prevout];
+        entry.coin = Coin(CTxOut(COIN, CScript() << OP_TRUE), 1, false);
+        entry.flags = CCoinsCacheEntry::DIRTY;
+        if (i == 0)
+            parent = tx;
+        pblock->vtx.push_back(MakeTransactionRef(tx));
+    }
+    // Spends an output created in the block, which is not looked up
+    CMutableTransaction child;
+    child.vin.emplace_back(COutPoint(parent.GetHash(), 0));
+    child.vout.emplace_back(COIN, CScript() << OP_TRUE);
+    pblock->vtx.push_back(MakeTransactionRef(child));
+    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+
+    BOOST_CHECK(db.BatchWrite(mapCoins, InsecureRand256()));
+    return pblock;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(coinsprefetch_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(coinsprefetch_apply)
+{
+    CCoinsViewDB db(1 << 20, true);
+    StartCoinsPrefetch(&db, 2);
+
+    std::shared_ptr<CBlock> pblock = BlockSpendingCoins(db, 500);
+    PrefetchBlockCoins(pblock);
+    {
+        LOCK(cs_main);
+        CCoinsViewCache cache(&db);
+        ApplyPrefetchedCoins(*pblock, cache);
+        BOOST_CHECK_EQUAL(cache.GetCacheSize(), 500U);
+        for (size_t i = 1; i <= 500; i++)
+            BOOST_CHECK(cache.HaveCoinInCache(pblock->vtx[i]->vin[0].prevout));
+
+        // Applied once only
+        CCoinsViewCache cache2(&db);
+        ApplyPrefetchedCoins(*pblock, cache2);
+        BOOST_CHECK_EQUAL(cache2.GetCacheSize(), 0U);
+    }
+
+    // Coins read before the view was written to are dropped
+    pblock = BlockSpendingCoins(db, 500);
+    PrefetchBlockCoins(pblock);
+    {
+        LOCK(cs_main);
+        InvalidatePrefetchedCoins();
+        CCoinsViewCache cache(&db);
+        ApplyPrefetchedCoins(*pblock, cache);
+        BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    }
+
+    // So are coins read while the view was being written to, which may be
+    // from before the write landed
+    {
+        LOCK(cs_main);
+        InvalidatePrefetchedCoins();
+    }
+    pblock = BlockSpendingCoins(db, 500);
+    PrefetchBlockCoins(pblock);
+    {
+        LOCK(cs_main);
+        InvalidatePrefetchedCoins();
+        CCoinsViewCache cache(&db);
+        ApplyPrefetchedCoins(*pblock, cache);
+        BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    }
+
+    // Entries in the view are left alone
+    pblock = BlockSpendingCoins(db, 10);
+    PrefetchBlockCoins(pblock);
+    {
+        LOCK(cs_main);
+        CCoinsViewCache cache(&db);
+        const COutPoint& prevout = pblock->vtx[1]->vin[0].prevout;
+        BOOST_CHECK(cache.SpendCoin(prevout));
+        ApplyPrefetchedCoins(*pblock, cache);
+        BOOST_CHECK(!cache.HaveCoin(prevout));
+        BOOST_CHECK_EQUAL(cache.GetCacheSize(), 10U);
+    }
+
+    // Blocks that do not match their merkle root are not read
+    pblock = BlockSpendingCoins(db, 10);
+    pblock->hashMerkleRoot.SetNull();
+    PrefetchBlockCoins(pblock);
+    {
+        LOCK(cs_main);
+        CCoinsViewCache cache(&db);
+        ApplyPrefetchedCoins(*pblock, cache);
+        BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    }
+
+    StopCoinsPrefetch();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,97 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <fermat.h>
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+bool FermatReference(const mpz_t mpzN)
+{
+    mpz_t mpzExp, mpzResult;
+    mpz_init(mpzExp);
+    mpz_init_set_ui(mpzResult, 2);
+    mpz_sub_ui(mpzExp, mpzN, 1);
+    mpz_powm(mpzResult, mpzResult, mpzExp, mpzN);
+    bool fPrime = mpz_cmp_ui(mpzResult, 1) == 0;
+    mpz_clear(mpzExp);
+    mpz_clear(mpzResult);
+    return fPrime;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(fermat_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(fermat_known_values)
+{
+    mpz_t vN[4];
+    for (mpz_t& mpz : vN)
+        mpz_init(mpz);
+    mpz_set_ui(vN[0], 341);             // 11 * 31, yet passes base 2
+    mpz_set_ui(vN[1], 343);
+    mpz_ui_pow_ui(vN[2], 2, 127);
+    mpz_sub_ui(vN[2], vN[2], 1);
+    mpz_add_ui(vN[3], vN[2], 2);        // divisible by 3
+
+    bool vPrime[4];
+    FermatTest(vN, 4, vPrime);
+    BOOST_CHECK(vPrime[0]);
+    BOOST_CHECK(!vPrime[1]);
+    BOOST_CHECK(vPrime[2]);
+    BOOST_CHECK(!vPrime[3]);
+    BOOST_CHECK(FermatTest(vN[2]));
+    BOOST_CHECK(!FermatTest(vN[3]));
+
+    for (mpz_t& mpz : vN)
+        mpz_clear(mpz);
+}
+
+BOOST_AUTO_TEST_CASE(fermat_backends_match_gmp)
+{
+    // Gap starts, hash * 2^nShift + adder, of mined sizes and past what the
+    // vector backends take, about a third of them prime
+    const size_t nCount = 61;
+    mpz_t vN[nCount];
+    for (size_t i = 0; i < nCount; i++) {
+        mpz_init(vN[i]);
+        uint256 hash = InsecureRand256();
+        mpz_import(vN[i], hash.size(), -1, 1, 0, 0, hash.begin());
+        mpz_setbit(vN[i], 255);
+        mpz_mul_2exp(vN[i], vN[i], i % 3 == 2 ? 800 : 20 + i);
+        mpz_add_ui(vN[i], vN[i], InsecureRand32() | 1);
+        if (i % 3 == 0)
+            mpz_nextprime(vN[i], vN[i]);
+    }
+
+    for (const char* strName : {"gmp", "avx2", "avx512ifma"}) {
+        if (!FermatSelect(strName))
+            continue;
+        // Batches of every length, so that spare lanes get used too
+        for (size_t nBatch = 1; nBatch <= 2 * FermatBatchSize() + 1; nBatch++) {
+            for (size_t nFirst = 0; nFirst + nBatch <= nCount; nFirst += nBatch) {
+                bool vPrime[nCount];
+                FermatTest(vN + nFirst, nBatch, vPrime);
+                for (size_t i = 0; i < nBatch; i++)
+                    BOOST_CHECK_MESSAGE(vPrime[i] == FermatReference(vN[nFirst + i]), strName);
+            }
+        }
+    }
+    FermatAutoDetect();
+
+    for (size_t i = 0; i < nCount; i++)
+        mpz_clear(vN[i]);
+}
+
+BOOST_AUTO_TEST_CASE(fermat_select)
+{
+    BOOST_CHECK(FermatSelect("gmp"));
+    BOOST_CHECK_EQUAL(FermatBatchSize(), 1U);
+    BOOST_CHECK(!FermatSelect("sse2"));
+    FermatAutoDetect();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,109 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <flatmap.h>
+#include <test/test_bitcoin.h>
+
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+struct CheapHasher
+{
+    //! Few distinct hashes, so probe sequences collide and wrap around
+    size_t operator()(uint32_t n) const { return (n % 61) * 0x9E3779B97F4A7C15ULL; }
+};
+
+typedef flatmap<uint32_t, std::vector<unsigned char>, CheapHasher> TestMap;
+
+void CheckEqual(const TestMap& map, const std::map<uint32_t, std::vector<unsigned char>>& ref)
+{
+    BOOST_CHECK_EQUAL(map.size(), ref.size());
+    size_t count = 0;
+    for (const auto& entry : map) {
+        auto it = ref.find(entry.first);
+        BOOST_REQUIRE(it != ref.end());
+        BOOST_CHECK(it->second == entry.second);
+        count++;
+    }
+    BOOST_CHECK_EQUAL(count, ref.size());
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(flatmap_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(flatmap_simulation)
+{
+    TestMap map;
+    std::map<uint32_t, std::vector<unsigned char>> ref;
+
+    for (int i = 0; i < 100000; i++) {
+        const uint32_t key = InsecureRandRange(2000);
+        switch (InsecureRandRange(4)) {
+        case 0: {
+            std::vector<unsigned char> value(InsecureRandRange(40), i);
+            auto ret = map.emplace(key, value);
+            BOOST_CHECK_EQUAL(ret.second, ref.emplace(key, value).second);
+            BOOST_CHECK(ret.first->second == ref[key]);
+            break;
+        }
+        case 1:
+            BOOST_CHECK_EQUAL(map.erase(key), ref.erase(key));
+            break;
+        case 2:
+            map[key].push_back(i);
+            ref[key].push_back(i);
+            break;
+        case 3: {
+            auto it = map.find(key);
+            BOOST_CHECK_EQUAL(it == map.end(), ref.count(key) == 0);
+            break;
+        }
+        }
+        if (i % 10000 == 0) {
+            // Erase while iterating, the way CCoinsView::BatchWrite implementations do
+            for (TestMap::iterator it = map.begin(); it != map.end(); ) {
+                if (InsecureRandBool()) {
+                    ref.erase(it->first);
+                    map.erase(it++);
+                } else {
+                    ++it;
+                }
+            }
+            CheckEqual(map, ref);
+        }
+    }
+    CheckEqual(map, ref);
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(flatmap_stable_references)
+{
+    TestMap map;
+    std::vector<unsigned char>& first = map[12345];
+    first.push_back(1);
+    // Growing the table moves the slots, not the values
+    for (uint32_t n = 0; n < 10000; n++)
+        map.emplace(n, std::vector<unsigned char>());
+    BOOST_CHECK(&map[12345] == &first);
+    BOOST_CHECK_EQUAL(map[12345].size(), 1U);
+
+    // Erased values are recycled instead of allocating more
+    const size_t nChunkBytes = map.ChunkBytes();
+    for (uint32_t n = 0; n < 10000; n++)
+        map.erase(n);
+    for (uint32_t n = 20000; n < 30000; n++)
+        map.emplace(n, std::vector<unsigned char>());
+    BOOST_CHECK_EQUAL(map.ChunkBytes(), nChunkBytes);
+    BOOST_CHECK_EQUAL(map.size(), 10001U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <gapindex.h>
+#include <validation.h>
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(gapindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(gapindex_sync_and_order, TestChain100Setup)
+{
+    CGapIndex gapindex(1 << 20, true);
+    BOOST_CHECK(!gapindex.IsSynced());
+
+    gapindex.Sync();
+    BOOST_CHECK(gapindex.IsSynced());
+
+    int nTipHeight;
+    uint256 hashTip, hashPrev;
+    {
+        LOCK(cs_main);
+        nTipHeight = chainActive.Height();
+        hashTip = chainActive.Tip()->GetBlockHash();
+        hashPrev = chainActive.Tip()->pprev->GetBlockHash();
+    }
+
+    // Every block of the active chain, genesis included, best merit first
+    std::vector<CGapRecord> records;
+    BOOST_CHECK(gapindex.FindRecords(0, std::numeric_limits<uint64_t>::max(), std::numeric_limits<size_t>::max(), records));
+    BOOST_CHECK_EQUAL(records.size(), (size_t)nTipHeight + 1);
+    for (size_t i = 1; i < records.size(); i++)
+        BOOST_CHECK(records[i - 1].nMerit >= records[i].nMerit);
+
+    // Range bounds are inclusive and the count is honoured
+    uint64_t nMerit = records[records.size() / 2].nMerit;
+    std::vector<CGapRecord> range;
+    BOOST_CHECK(gapindex.FindRecords(nMerit, nMerit, std::numeric_limits<size_t>::max(), range));
+    BOOST_CHECK(!range.empty());
+    for (const CGapRecord& record : range)
+        BOOST_CHECK_EQUAL(record.nMerit, nMerit);
+
+    std::vector<CGapRecord> best;
+    BOOST_CHECK(gapindex.FindRecords(0, std::numeric_limits<uint64_t>::max(), 3, best));
+    BOOST_CHECK_EQUAL(best.size(), 3U);
+    BOOST_CHECK(best[0].hashBlock == records[0].hashBlock);
+
+    // Erasing a block that is not the indexed tip leaves the tip alone
+    BOOST_CHECK(gapindex.ReadBestBlock() == hashTip);
+    BOOST_CHECK(gapindex.EraseBlock(uint256S("0x01"), hashPrev));
+    BOOST_CHECK(gapindex.ReadBestBlock() == hashTip);
+
+    // Disconnecting the tip drops exactly its record
+    BOOST_CHECK(gapindex.EraseBlock(hashTip, hashPrev));
+    BOOST_CHECK(gapindex.ReadBestBlock() == hashPrev);
+    records.clear();
+    BOOST_CHECK(gapindex.FindRecords(0, std::numeric_limits<uint64_t>::max(), std::numeric_limits<size_t>::max(), records));
+    BOOST_CHECK_EQUAL(records.size(), (size_t)nTipHeight);
+    for (const CGapRecord& record : records)
+        BOOST_CHECK(record.hashBlock != hashTip);
+
+    // Catching up again restores it
+    gapindex.Sync();
+    records.clear();
+    BOOST_CHECK(gapindex.FindRecords(0, std::numeric_limits<uint64_t>::max(), std::numeric_limits<size_t>::max(), records));
+    BOOST_CHECK_EQUAL(records.size(), (size_t)nTipHeight + 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(powsummary_cache, TestChain100Setup)
+{
+    const CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        pindex = chainActive.Tip();
+    }
+
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, pindex, Params().GetConsensus(), false));
+    CGapRecord record = CGapIndex::MakeRecord(block, pindex);
+
+    // The summary carries the same gap as the one derived from the full block
+    std::shared_ptr<const CBlockPoWSummary> summary = GetBlockPoWSummary(*pindex);
+    BOOST_CHECK_EQUAL(summary->nMerit, record.nMerit);
+    BOOST_CHECK_EQUAL(summary->nGapLen, record.nGapLen);
+    BOOST_CHECK(summary->vGapStart == record.vGapStart);
+    BOOST_CHECK(GetBlockPoWSummary(*pindex) == summary);
+
+    // Nothing more is attached once the budget is used up
+    size_t nMaxSaved = nPoWSummaryCacheMax;
+    nPoWSummaryCacheMax = PoWSummaryCacheUsage();
+    BOOST_CHECK(GetBlockPoWSummary(*pindex->pprev) != GetBlockPoWSummary(*pindex->pprev));
+    BOOST_CHECK_EQUAL(PoWSummaryCacheUsage(), nPoWSummaryCacheMax);
+    nPoWSummaryCacheMax = nMaxSaved;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
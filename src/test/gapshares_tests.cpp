@@ -0,0 +1,55 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gapshares.h>
+#include <chain.h>
+#include <validation.h>
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(gapshares_tests, TestChain100Setup)
+
+BOOST_AUTO_TEST_CASE(gapshares_validate)
+{
+    // The blocks of the test chain prove gaps of at least the minimum test difficulty
+    std::vector<CGapShare> vShares;
+    {
+        LOCK(cs_main);
+        for (int h = 1; h <= chainActive.Height(); h++)
+            vShares.push_back({chainActive[h]->GetBlockHeader(), chainActive[h]->nDifficulty / 2});
+    }
+    CGapShare bad = vShares.back();
+    bad.header.nAdd[0] ^= 1;
+    vShares.push_back(bad);
+    // Resubmitted within the batch
+    vShares.push_back(vShares.front());
+
+    CGapShareValidator validator;
+    std::vector<CGapShareResult> vResults = validator.Validate(vShares, 4);
+    BOOST_REQUIRE_EQUAL(vResults.size(), vShares.size());
+    for (size_t i = 0; i + 2 < vShares.size(); i++) {
+        BOOST_CHECK(vResults[i].fValid);
+        BOOST_CHECK(!vResults[i].fDuplicate);
+        BOOST_CHECK(vResults[i].nMerit >= vShares[i].nShareDifficulty);
+        BOOST_CHECK(vResults[i].hash == vShares[i].header.GetHash());
+        // Already on the chain, so not a new block
+        BOOST_CHECK(!vResults[i].fBlock);
+    }
+    BOOST_CHECK(!vResults[vShares.size() - 2].fValid);
+    BOOST_CHECK(vResults.back().fDuplicate);
+
+    // Everything checked once is a duplicate from now on
+    vResults = validator.Validate({vShares[0], bad}, 1);
+    BOOST_CHECK(vResults[0].fDuplicate && !vResults[0].fValid);
+    BOOST_CHECK(vResults[1].fDuplicate);
+
+    // The same adder padded with zeros is the same gap
+    CGapShare padded = vShares[1];
+    padded.header.nAdd.push_back(0);
+    vResults = validator.Validate({padded}, 1);
+    BOOST_CHECK(vResults[0].fDuplicate && !vResults[0].fValid);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
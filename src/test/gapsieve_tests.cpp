@@ -0,0 +1,140 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gapsieve.h>
+#include <test/test_bitcoin.h>
+#include <PoWCore/src/Sieve.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** Remembers the adders of the gaps it is handed, up to a limit */
+class RecordingProcessor : public PoWProcessor
+{
+public:
+    std::vector<std::vector<uint8_t>> vAdders;
+    size_t nMax;
+
+    explicit RecordingProcessor(size_t nMaxIn) : nMax(nMaxIn) {}
+
+    bool process(PoW* pow)
+    {
+        std::vector<uint8_t> vAdd;
+        pow->get_adder(&vAdd);
+        vAdders.push_back(vAdd);
+        return vAdders.size() < nMax;
+    }
+};
+
+/** The value of a little-endian adder */
+uint64_t AdderValue(const std::vector<uint8_t>& vAdd)
+{
+    uint64_t nAdd = 0;
+    for (size_t i = vAdd.size(); i-- > 0; )
+        nAdd = (nAdd << 8) | vAdd[i];
+    return nAdd;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(gapsieve_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(gapsieve_segmented_matches_plain)
+{
+    // Few primes, the wheel alone, and enough for bucketed primes and many
+    // segments; a shift that cuts the range short
+    for (uint64_t nPrimes : {(uint64_t)2, (uint64_t)4, (uint64_t)5000, (uint64_t)60000}) {
+        for (uint16_t nShift : {(uint16_t)20, (uint16_t)25}) {
+            CGapSieve segmented(nullptr, nPrimes, 1 << 22);
+            CGapSieve plain(nullptr, nPrimes, 1 << 22);
+            uint256 hash = InsecureRand256();
+            segmented.Sieve(hash, nShift, true);
+            plain.Sieve(hash, nShift, false);
+
+            BOOST_CHECK_EQUAL(segmented.GetSieveRange(), std::min<uint64_t>(1 << 22, 1ULL << nShift));
+            uint64_t nMismatches = 0;
+            for (uint64_t nOffset = 1; nOffset < segmented.GetSieveRange(); nOffset += 2)
+                nMismatches += segmented.IsComposite(nOffset) != plain.IsComposite(nOffset);
+            BOOST_CHECK_EQUAL(nMismatches, 0U);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(gapsieve_marks_small_factors)
+{
+    CGapSieve sieve(nullptr, 100, 1 << 16);
+    uint256 hash = InsecureRand256();
+    sieve.Sieve(hash, 20);
+
+    mpz_t mpzStart, mpzN;
+    mpz_init(mpzStart);
+    mpz_init(mpzN);
+    mpz_import(mpzStart, hash.size(), -1, 1, 0, 0, hash.begin());
+    mpz_mul_2exp(mpzStart, mpzStart, 20);
+    for (uint64_t nOffset = 1; nOffset < sieve.GetSieveRange(); nOffset += 2) {
+        mpz_add_ui(mpzN, mpzStart, nOffset);
+        // The first 100 odd primes end at 547
+        bool fSmallFactor = false;
+        for (unsigned long p = 3; p <= 547 && !fSmallFactor; p += 2)
+            fSmallFactor = mpz_divisible_ui_p(mpzN, p);
+        BOOST_CHECK_EQUAL(sieve.IsComposite(nOffset), fSmallFactor);
+    }
+    mpz_clear(mpzStart);
+    mpz_clear(mpzN);
+}
+
+BOOST_AUTO_TEST_CASE(gapsieve_run_finds_gaps)
+{
+    // At a merit of one there are gaps everywhere
+    RecordingProcessor processor(10);
+    CGapSieve sieve(&processor, 5000, 1 << 20);
+    uint256 hash = InsecureRand256();
+    sieve.Run(hash, 20, 1ULL << 48);
+    BOOST_CHECK_EQUAL(processor.vAdders.size(), 10U);
+    BOOST_CHECK(sieve.TestsPerSec() > 0);
+
+    for (const std::vector<uint8_t>& vAdd : processor.vAdders) {
+        mpz_t mpzStart, mpzAdd;
+        mpz_init(mpzStart);
+        mpz_init(mpzAdd);
+        mpz_import(mpzStart, hash.size(), -1, 1, 0, 0, hash.begin());
+        mpz_mul_2exp(mpzStart, mpzStart, 20);
+        mpz_import(mpzAdd, vAdd.size(), -1, 1, 0, 0, vAdd.data());
+        BOOST_CHECK(mpz_cmp_ui(mpzAdd, 1 << 20) < 0);
+        mpz_add(mpzStart, mpzStart, mpzAdd);
+        BOOST_CHECK(mpz_probab_prime_p(mpzStart, 25));
+        mpz_clear(mpzStart);
+        mpz_clear(mpzAdd);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(gapsieve_run_matches_powcore)
+{
+    // The same start, shift and sieve parameters must give PoWCore's gaps,
+    // in its order, from short ranges to ones that take bucketed primes
+    for (uint16_t nShift : {(uint16_t)20, (uint16_t)22}) {
+        for (uint64_t nPrimes : {(uint64_t)1000, (uint64_t)60000}) {
+            uint256 hash = InsecureRand256();
+            std::vector<uint8_t> vHash(hash.begin(), hash.end());
+
+            RecordingProcessor expected(20);
+            Sieve sieve(&expected, nPrimes, 1 << 20);
+            std::vector<uint8_t> vAdd;
+            PoW pow(&vHash, nShift, &vAdd, 1ULL << 48);
+            sieve.run_sieve(&pow, NULL);
+
+            RecordingProcessor found(20);
+            CGapSieve gapsieve(&found, nPrimes, 1 << 20);
+            gapsieve.Run(hash, nShift, 1ULL << 48);
+
+            BOOST_CHECK_EQUAL(found.vAdders.size(), 20U);
+            BOOST_REQUIRE_EQUAL(found.vAdders.size(), expected.vAdders.size());
+            for (size_t i = 0; i < found.vAdders.size(); i++)
+                BOOST_CHECK_EQUAL(AdderValue(found.vAdders[i]), AdderValue(expected.vAdders[i]));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -729,4 +729,70 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     fCheckpointsEnabled = true;
 }
 
+/** Publish work with the sieve parameters currently set, as the template builder does */
+static void PublishTunerWork(CMinerPool& pool, uint64_t nDifficulty)
+{
+    std::shared_ptr<CMinerWork> work = std::make_shared<CMinerWork>();
+    work->block.nDifficulty = nDifficulty;
+    work->block.nShift = nMiningShift;
+    work->nSievePrimes = nMiningPrimes;
+    work->nSieveSize = nMiningSieveSize;
+    pool.Publish(std::move(work));
+}
+
+BOOST_AUTO_TEST_CASE(miner_tuner_keeps_shift)
+{
+    const uint16_t nShiftPrev = nMiningShift;
+    const uint64_t nPrimesPrev = nMiningPrimes, nSieveSizePrev = nMiningSieveSize;
+    const uint64_t nDifficulty = PoWUtils::min_test_difficulty;
+
+    // With no miner threads every candidate is measured as soon as its slice is over
+    CMinerPool pool(Params());
+    CMinerTuner tuner(1);
+    nMiningShift = 22;
+    PublishTunerWork(pool, nDifficulty);
+    tuner.Step(pool);
+    BOOST_CHECK(!tuner.GetReport().fEnabled);
+
+    tuner.SetEnabled(true);
+    for (int i = 0; i < 100 && (i == 0 || tuner.GetReport().fTuning); i++) {
+        tuner.Step(pool);
+        BOOST_CHECK_EQUAL(nMiningShift, 22);
+        PublishTunerWork(pool, nDifficulty);
+        MilliSleep(2);
+    }
+
+    // The sieve sizes up to 2^shift, then the sieve-primes at the best of them
+    CMiningTuneReport report = tuner.GetReport();
+    BOOST_CHECK(report.fEnabled);
+    BOOST_CHECK(!report.fTuning);
+    BOOST_REQUIRE_EQUAL(report.vResults.size(), 6U);
+    BOOST_CHECK_EQUAL(report.vResults[0].nSieveSize, 1U << 21);
+    BOOST_CHECK_EQUAL(report.vResults[1].nSieveSize, 1U << 22);
+    for (const CMiningTuneResult& result : report.vResults) {
+        BOOST_CHECK_EQUAL(result.nShift, 22);
+        BOOST_CHECK(result.nSieveSize <= 1U << 22);
+    }
+    BOOST_CHECK(report.nBest >= 0);
+    BOOST_CHECK_EQUAL(nMiningSieveSize, report.vResults[report.nBest].nSieveSize);
+    BOOST_CHECK_EQUAL(nMiningPrimes, report.vResults[report.nBest].nSievePrimes);
+
+    // Tuned until the difficulty drifts or the operator changes the shift,
+    // a shift below the sizes tried leaving only the sieve of 2^shift
+    tuner.Step(pool);
+    BOOST_CHECK(!tuner.GetReport().fTuning);
+    nMiningShift = 16;
+    tuner.Step(pool);
+    report = tuner.GetReport();
+    BOOST_CHECK(report.fTuning);
+    BOOST_CHECK(report.vResults.empty());
+    BOOST_CHECK_EQUAL(nMiningSieveSize, 1U << 16);
+    BOOST_CHECK_EQUAL(nMiningPrimes, DEFAULT_MINING_TUNE_PRIMES);
+
+    tuner.SetEnabled(false);
+    nMiningShift = nShiftPrev;
+    nMiningPrimes = nPrimesPrev;
+    nMiningSieveSize = nSieveSizePrev;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
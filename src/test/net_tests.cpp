@@ -187,4 +187,81 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+BOOST_AUTO_TEST_CASE(cnetmessage_receive_in_place)
+{
+    // Messages of earlier tests may have left buffers in the pool
+    ClearRecvBufferPool();
+
+    std::vector<unsigned char> payload(RECV_ALLOCATE_AHEAD * 3 / 2);
+    for (unsigned char& c : payload)
+        c = InsecureRandBits(8);
+    const char* pchPayload = (const char*)payload.data();
+    uint256 hash = Hash(payload.begin(), payload.end());
+    CMessageHeader hdr(Params().MessageStart(), NetMsgType::BLOCK, payload.size());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+    ssHeader << hdr;
+
+    const char* pchBuffer;
+    {
+        CNetMessage msg(Params().MessageStart(), SER_NETWORK, PROTOCOL_VERSION);
+        BOOST_CHECK_EQUAL(msg.readHeader(ssHeader.data(), ssHeader.size()), (int)ssHeader.size());
+        BOOST_CHECK(msg.in_data);
+
+        // Copied and in place reads can be mixed
+        size_t nPos = msg.readData(pchPayload, 1000);
+        BOOST_CHECK_EQUAL(nPos, 1000U);
+        while (nPos < payload.size()) {
+            unsigned int nSize;
+            char* pch = msg.GetDataBuffer(nSize);
+            BOOST_CHECK(nSize > 0 && nSize <= RECV_ALLOCATE_AHEAD);
+            nSize = std::min<size_t>(nSize, std::min<size_t>(payload.size() - nPos, 50000));
+            memcpy(pch, pchPayload + nPos, nSize);
+            msg.DataReceived(nSize);
+            nPos += nSize;
+        }
+        BOOST_CHECK(msg.complete());
+        BOOST_CHECK(msg.GetMessageHash() == hash);
+        BOOST_CHECK_EQUAL(msg.vRecv.size(), payload.size());
+        BOOST_CHECK(memcmp(msg.vRecv.data(), payload.data(), payload.size()) == 0);
+        // The buffer does not grow beyond the message
+        BOOST_CHECK_EQUAL(msg.vRecv.capacity(), payload.size());
+        pchBuffer = msg.vRecv.data();
+    }
+
+    // The next large message takes over the buffer
+    {
+        CNetMessage msg(Params().MessageStart(), SER_NETWORK, PROTOCOL_VERSION);
+        msg.readHeader(ssHeader.data(), ssHeader.size());
+        BOOST_CHECK(msg.vRecv.data() == pchBuffer);
+        BOOST_CHECK(msg.vRecv.empty());
+    }
+
+    // CNode only hands out the payload while at least the asked for size is missing
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    CAddress addr = CAddress(CService(ipv4Addr, 7777), NODE_NETWORK);
+    CNode node(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", false);
+    bool complete;
+    BOOST_CHECK(node.ReceiveMsgBytes(ssHeader.data(), ssHeader.size(), complete));
+    BOOST_CHECK(!complete);
+    size_t nPos = 0;
+    while (true) {
+        unsigned int nSize = 0x10000;
+        char* pch = node.GetRecvBuffer(nSize);
+        if (!pch)
+            break;
+        BOOST_CHECK(payload.size() - nPos >= 0x10000);
+        nSize = std::min<size_t>(nSize, payload.size() - nPos);
+        memcpy(pch, pchPayload + nPos, nSize);
+        node.ReceiveMsgBytesInPlace(nSize, complete);
+        BOOST_CHECK(!complete);
+        nPos += nSize;
+    }
+    BOOST_CHECK(payload.size() - nPos < 0x10000);
+    BOOST_CHECK(node.ReceiveMsgBytes(pchPayload + nPos, payload.size() - nPos, complete));
+    BOOST_CHECK(complete);
+    BOOST_CHECK_EQUAL(node.nRecvBytes, ssHeader.size() + payload.size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,12 +3,19 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <cstddef>
+#include <bignum.h>
 #include <chain.h>
 #include <chainparams.h>
+#include <clientversion.h>
 #include <pow.h>
 #include <random.h>
+#include <streams.h>
 #include <util.h>
+#include <validation.h>
 #include <test/test_bitcoin.h>
+#include <PoWCore/src/PoWUtils.h>
+
+#include <limits>
 
 #include <boost/test/unit_test.hpp>
 
@@ -143,6 +150,136 @@ BOOST_AUTO_TEST_CASE(CheckProofOfWork_test_zero_target) // Fails for Bitcoin Che
     BOOST_CHECK(CheckProofOfWork(hash, nShift, &nAdd, nDifficulty, consensus));
 }
 
+BOOST_AUTO_TEST_CASE(CPoWCheck_test)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    CBlockHeader header = chainParams->GenesisBlock().GetBlockHeader();
+    CPoWCheck check(header, chainParams->GetConsensus());
+
+    // The check keeps its own copy of the header fields
+    header.nNonce++;
+    CPoWCheck checkBad(header, chainParams->GetConsensus());
+    BOOST_CHECK(check());
+    BOOST_CHECK(!checkBad());
+
+    check.swap(checkBad);
+    BOOST_CHECK(!check());
+    BOOST_CHECK(checkBad());
+}
+
+BOOST_AUTO_TEST_CASE(CheckProofOfWork_staged_test)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const CBlockHeader genesis = chainParams->GenesisBlock().GetBlockHeader();
+    BOOST_CHECK(CheckProofOfWorkBounds(genesis.nShift, genesis.nAdd, genesis.nDifficulty));
+
+    // The adder is little-endian and has to fit in nShift bits
+    std::vector<uint8_t> nAdd = genesis.nAdd;
+    nAdd.push_back(0);
+    BOOST_CHECK(CheckProofOfWorkBounds(genesis.nShift, nAdd, genesis.nDifficulty));
+    nAdd = genesis.nAdd;
+    nAdd.back() |= 0x10;
+    BOOST_CHECK(!CheckProofOfWorkBounds(genesis.nShift, nAdd, genesis.nDifficulty));
+    BOOST_CHECK(CheckProofOfWorkBounds(genesis.nShift + 1, nAdd, genesis.nDifficulty));
+
+    // ...and has to make the gap start odd
+    nAdd = genesis.nAdd;
+    nAdd[0]--;
+    BOOST_CHECK(!CheckProofOfWorkBounds(genesis.nShift, nAdd, genesis.nDifficulty));
+    BOOST_CHECK(!CheckProofOfWorkBounds(genesis.nShift, std::vector<uint8_t>(), genesis.nDifficulty));
+
+    // Nothing to prove without a difficulty
+    BOOST_CHECK(CheckProofOfWorkBounds(genesis.nShift, nAdd, 0));
+
+    // A gap start divisible by three is turned away by the Fermat test
+    nAdd = genesis.nAdd;
+    nAdd[0] += 4;
+    BOOST_CHECK(CheckProofOfWorkBounds(genesis.nShift, nAdd, genesis.nDifficulty));
+    BOOST_CHECK(!CheckProofOfWork(genesis.GetHash(), genesis.nShift, &nAdd, genesis.nDifficulty, chainParams->GetConsensus()));
+
+    // Checks that get past the bounds are timed; batches run elsewhere are added by the caller
+    int64_t nMicros = GetPoWCheckMicros();
+    BOOST_CHECK(CheckProofOfWork(genesis.GetHash(), genesis.nShift, &genesis.nAdd, genesis.nDifficulty, chainParams->GetConsensus()));
+    BOOST_CHECK(GetPoWCheckMicros() >= nMicros);
+    AddPoWCheckMicros(1000);
+    BOOST_CHECK(GetPoWCheckMicros() >= nMicros + 1000);
+}
+
+BOOST_AUTO_TEST_CASE(CheckProofOfWorkBounds_matches_powcore)
+{
+    // The bounds only turn away headers PoWCore rejects as well, so they
+    // don't change what is valid
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const CBlock& genesis = chainParams->GenesisBlock();
+    std::vector<uint8_t> vHash(genesis.GetHash().begin(), genesis.GetHash().end());
+
+    std::vector<std::pair<uint16_t, std::vector<uint8_t>>> vRejected;
+    // Adders wider than nShift, by one bit up to several bytes
+    for (int nBit = 0; nBit < 24; nBit++) {
+        std::vector<uint8_t> nAdd(genesis.nAdd);
+        nAdd.resize(std::max<size_t>(nAdd.size(), (genesis.nShift + nBit) / 8 + 1), 0);
+        nAdd[(genesis.nShift + nBit) / 8] |= 1 << ((genesis.nShift + nBit) % 8);
+        vRejected.emplace_back(genesis.nShift, nAdd);
+    }
+    // Even gap starts, including an empty adder
+    for (int i = 0; i < 16; i++) {
+        std::vector<uint8_t> nAdd(genesis.nAdd);
+        nAdd[0] = (nAdd[0] & ~1) ^ (2 * i);
+        vRejected.emplace_back(genesis.nShift, nAdd);
+    }
+    vRejected.emplace_back(genesis.nShift, std::vector<uint8_t>());
+
+    for (const auto& header : vRejected) {
+        BOOST_CHECK(!CheckProofOfWorkBounds(header.first, header.second, genesis.nDifficulty));
+        PoW pow(&vHash, header.first, &header.second, genesis.nDifficulty);
+        BOOST_CHECK(!pow.valid());
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(CheckBlockIndexPoW_test, TestChain100Setup)
+{
+    BOOST_CHECK(CheckBlockIndexPoW(Params(), -1, false));
+    BOOST_CHECK(CheckBlockIndexPoW(Params(), 10, false));
+
+    CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        pindex = chainActive[chainActive.Height() - 5];
+    }
+
+    // A damaged entry is found when it is within the checked depth
+    uint64_t nDifficulty = pindex->nDifficulty;
+    pindex->nDifficulty = std::numeric_limits<uint64_t>::max();
+    BOOST_CHECK(CheckBlockIndexPoW(Params(), 5, false));
+    BOOST_CHECK(!CheckBlockIndexPoW(Params(), 10, false));
+    BOOST_CHECK(!CheckBlockIndexPoW(Params(), -1, false));
+    pindex->nDifficulty = nDifficulty;
+}
+
+BOOST_AUTO_TEST_CASE(CBlockIndex_adder_test)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    CBlockHeader header = chainParams->GenesisBlock().GetBlockHeader();
+
+    // Adders stored inline and on the heap round-trip through the index and its disk format
+    for (size_t nSize : {(size_t)3, (size_t)12, (size_t)40}) {
+        header.nAdd.assign(nSize, 0x5a);
+        header.nAdd.back() = (unsigned char)nSize;
+
+        uint256 hash = header.GetHash();
+        CBlockIndex index(header);
+        index.phashBlock = &hash;
+        BOOST_CHECK(index.GetBlockHeader().GetHash() == hash);
+
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << CDiskBlockIndex(&index);
+        CDiskBlockIndex diskindex;
+        ss >> diskindex;
+        BOOST_CHECK(diskindex.nAdd == index.nAdd);
+        BOOST_CHECK(diskindex.GetBlockHash() == hash);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
 {
     const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
@@ -165,4 +302,71 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+/* GetBlockProof as it was computed through OpenSSL before */
+static arith_uint256 GetBlockProofBigNum(uint64_t nDifficulty)
+{
+    static PoWUtils powUtils;
+    std::vector<uint8_t> work;
+    powUtils.target_work(&work, nDifficulty);
+    work.push_back(0);
+
+    CBigNum bnWork;
+    bnWork.setvch(work);
+    bool fNegative, fOverflow;
+    arith_uint256 bnTarget;
+    bnTarget.SetCompact(bnWork.GetCompact(), &fNegative, &fOverflow);
+    if (fNegative || fOverflow || bnTarget == 0)
+        return 0;
+    return bnTarget;
+}
+
+BOOST_AUTO_TEST_CASE(GetBlockProof_matches_bignum)
+{
+    CBlockIndex index;
+
+    // Every 1/1024 merit from zero to past merit 177.45, where the work
+    // outgrows 256 bits
+    for (uint64_t nDifficulty = 0; nDifficulty <= (180ULL << 48); nDifficulty += (1ULL << 38)) {
+        index.nDifficulty = nDifficulty;
+        BOOST_CHECK(GetBlockProof(index) == GetBlockProofBigNum(nDifficulty));
+    }
+
+    // The rest of the range in coarse steps, up to the largest difficulty
+    for (uint64_t nDifficulty = 180ULL << 48; nDifficulty >= (180ULL << 48); nDifficulty += (1ULL << 50)) {
+        index.nDifficulty = nDifficulty;
+        BOOST_CHECK(GetBlockProof(index) == GetBlockProofBigNum(nDifficulty));
+    }
+    index.nDifficulty = std::numeric_limits<uint64_t>::max();
+    BOOST_CHECK(GetBlockProof(index) == GetBlockProofBigNum(index.nDifficulty));
+
+    // Random values of every magnitude, overflowing ones included
+    for (int i = 0; i < 10000; i++) {
+        index.nDifficulty = InsecureRandBits(1 + InsecureRandRange(64));
+        BOOST_CHECK(GetBlockProof(index) == GetBlockProofBigNum(index.nDifficulty));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(GetBlockProof_values)
+{
+    CBlockIndex index;
+
+    // floor(e^merit), at compact precision from 2^24 on
+    const struct {
+        uint64_t nDifficulty;
+        const char* pszWork;
+    } vValues[] = {
+        {0, "1"},
+        {1ULL << 48, "2"},
+        {10ULL << 48, "560a"},
+        {16ULL << 48, "879700"},
+        {(21ULL << 48) + (1ULL << 47), "819a0000"},
+        {177ULL << 48, "a442000000000000000000000000000000000000000000000000000000000000"},
+        {178ULL << 48, "0"},
+    };
+    for (const auto& value : vValues) {
+        index.nDifficulty = value.nDifficulty;
+        BOOST_CHECK_EQUAL(GetBlockProof(index).GetHex(), arith_uint256(value.pszWork).GetHex());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,39 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <primegaplist.h>
+#include <test/test_bitcoin.h>
+
+#include <fstream>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(primegaplist_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(primegaplist_load)
+{
+    const fs::path path = pathTemp / "allgaps.sql";
+    std::string strError;
+    BOOST_CHECK(!LoadPrimeGapList(path, strError));
+
+    {
+        std::ofstream file(path.string());
+        file << "CREATE TABLE gaps(gapsize INT, ismax BOOL, primecat TEXT, isfirst TEXT, primecert TEXT, discoverer TEXT, year INT, merit REAL, primedigits INT, startprime BLOB);\n";
+        file << "INSERT INTO gaps VALUES(2,1,'C','C','','',1850,1.8204784532536746,1,'3');\n";
+        file << "INSERT INTO gaps VALUES(1132,1,'C','C','','Nicely',1999,27.14577,18,'1693182318746371');\n";
+        file << "INSERT INTO gaps VALUES(6000,0,'C','?','','Gapcoin',2015,26.01,100,'2*3');\n";
+    }
+
+    std::shared_ptr<const CPrimeGapList> gaps = LoadPrimeGapList(path, strError);
+    BOOST_REQUIRE(gaps);
+    BOOST_CHECK_EQUAL(gaps->mapRecords.size(), 3U);
+    BOOST_CHECK_CLOSE(gaps->RecordMerit(1132), 27.14577f, 0.0001);
+    BOOST_CHECK_CLOSE(gaps->RecordMerit(6000), 26.01f, 0.0001);
+    BOOST_CHECK_EQUAL(gaps->RecordMerit(1134), 0.0f);
+
+    // Loading makes it the cached list
+    BOOST_CHECK(GetPrimeGapList(strError) == gaps);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,7 @@
 #include <consensus/consensus.h>
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
+#include <fermat.h>
 #include <validation.h>
 #include <miner.h>
 #include <net_processing.h>
@@ -46,6 +47,7 @@ std::ostream& operator<<(std::ostream& os, const uint256& num)
 BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
 {
         SHA256AutoDetect();
+        FermatAutoDetect();
         RandomInit();
         ECC_Start();
         SetupEnvironment();
@@ -84,7 +86,8 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
         mempool.setSanityCheck(1.0);
         pblocktree.reset(new CBlockTreeDB(1 << 20, true));
         pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
-        pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+        pcoinsflusher.reset(new CCoinsViewFlusher(pcoinsdbview.get()));
+        pcoinsTip.reset(new CCoinsViewCache(pcoinsflusher.get()));
         if (!LoadGenesisBlock(chainparams)) {
             throw std::runtime_error("LoadGenesisBlock failed.");
         }
@@ -95,8 +98,10 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
             }
         }
         nScriptCheckThreads = 3;
-        for (int i=0; i < nScriptCheckThreads-1; i++)
+        for (int i=0; i < nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadPoWCheck);
+        }
         g_connman = std::unique_ptr<CConnman>(new CConnman(0x1337, 0x1337)); // Deterministic randomness for tests.
         connman = g_connman.get();
         peerLogic.reset(new PeerLogicValidation(connman, scheduler));
@@ -112,6 +117,7 @@ TestingSetup::~TestingSetup()
         peerLogic.reset();
         UnloadBlockIndex();
         pcoinsTip.reset();
+        pcoinsflusher.reset();
         pcoinsdbview.reset();
         pblocktree.reset();
         fs::remove_all(pathTemp);
@@ -0,0 +1,139 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
+#include <triples.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <utiltime.h>
+#include <validation.h>
+#include <test/test_bitcoin.h>
+
+#include <fstream>
+#include <iterator>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if USE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** The triples of blocks nStart..nEnd, rendered one after the other */
+std::string ExpectedTriples(int nStart, int nEnd)
+{
+    std::string str;
+    for (int h = nStart; h <= nEnd; h++) {
+        CBlock block;
+        const CBlockIndex* pindex;
+        {
+            LOCK(cs_main);
+            pindex = chainActive[h];
+        }
+        BOOST_CHECK(ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+        str += BlockToTriples(block, pindex);
+    }
+    return str;
+}
+
+CTriplesDumpStatus WaitForDump()
+{
+    CTriplesDumpStatus status;
+    for (int i = 0; i < 3000 && (status = GetTriplesDumpStatus()).fRunning; i++)
+        MilliSleep(10);
+    return status;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(triples_tests)
+
+BOOST_FIXTURE_TEST_CASE(triples_dump_in_order, TestChain100Setup)
+{
+    // More blocks than one shard, and more shards than workers
+    const int nTip = chainActive.Height();
+    BOOST_CHECK(nTip + 1 > TRIPLES_SHARD_SIZE);
+    const std::string strPath = (pathTemp / "triples.nt").string();
+    std::string strError;
+    BOOST_CHECK(StartTriplesDump(strPath, 0, nTip, TriplesCompression::NONE, 3, strError));
+    CTriplesDumpStatus status = WaitForDump();
+    BOOST_CHECK(!status.fRunning);
+    BOOST_CHECK_EQUAL(status.strError, "");
+    BOOST_CHECK_EQUAL(status.nHeight, nTip + 1);
+
+    const std::string strExpected = ExpectedTriples(0, nTip);
+    std::ifstream file(strPath, std::ios::binary);
+    const std::string strDump((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    BOOST_CHECK_EQUAL(status.nBytes, strExpected.size());
+    BOOST_CHECK(strDump == strExpected);
+
+    // Never overwritten
+    BOOST_CHECK(!StartTriplesDump(strPath, 0, nTip, TriplesCompression::NONE, 1, strError));
+    BOOST_CHECK(!StartTriplesDump((pathTemp / "other.nt").string(), 0, nTip + 1, TriplesCompression::NONE, 1, strError));
+}
+
+#if USE_ZLIB
+BOOST_FIXTURE_TEST_CASE(triples_dump_gzip, TestChain100Setup)
+{
+    const int nTip = chainActive.Height();
+    const std::string strPath = (pathTemp / "triples.nt.gz").string();
+    TriplesCompression compression;
+    BOOST_CHECK(ParseTriplesCompression("gzip", compression));
+    std::string strError;
+    BOOST_CHECK(StartTriplesDump(strPath, 5, nTip, compression, 2, strError));
+    BOOST_CHECK_EQUAL(WaitForDump().strError, "");
+
+    std::string strDump;
+    gzFile file = gzopen(strPath.c_str(), "rb");
+    BOOST_REQUIRE(file);
+    char buf[4096];
+    int nRead;
+    while ((nRead = gzread(file, buf, sizeof(buf))) > 0)
+        strDump.append(buf, nRead);
+    gzclose(file);
+    BOOST_CHECK(strDump == ExpectedTriples(5, nTip));
+}
+#endif
+
+#ifndef WIN32
+BOOST_FIXTURE_TEST_CASE(triples_dump_fifo_stops, TestChain100Setup)
+{
+    const int nTip = chainActive.Height();
+    const std::string strPath = (pathTemp / "triples.fifo").string();
+    BOOST_REQUIRE(mkfifo(strPath.c_str(), 0600) == 0);
+    std::string strError;
+
+    // Stopped while waiting for a reader
+    BOOST_CHECK(StartTriplesDump(strPath, 0, nTip, TriplesCompression::NONE, 1, strError));
+    MilliSleep(200);
+    BOOST_CHECK(GetTriplesDumpStatus().fRunning);
+    StopTriplesDump();
+    BOOST_CHECK_EQUAL(GetTriplesDumpStatus().strError, "Interrupted");
+
+    // Stopped while the reader has stalled with the pipe full
+    int fd = open(strPath.c_str(), O_RDONLY | O_NONBLOCK);
+    BOOST_REQUIRE(fd >= 0);
+    BOOST_CHECK(StartTriplesDump(strPath, 0, nTip, TriplesCompression::NONE, 1, strError));
+    MilliSleep(500);
+    BOOST_CHECK(GetTriplesDumpStatus().fRunning);
+    StopTriplesDump();
+    CTriplesDumpStatus status = GetTriplesDumpStatus();
+    BOOST_CHECK(!status.fRunning);
+    BOOST_CHECK(status.nHeight <= nTip);
+    BOOST_CHECK(!status.strError.empty());
+    close(fd);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
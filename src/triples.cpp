@@ -0,0 +1,577 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
+#include <triples.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <core_io.h>
+#include <primitives/block.h>
+#include <rpc/blockchain.h>
+#include <rpc/server.h>
+#include <sync.h>
+#include <util.h>
+#include <utiltime.h>
+#include <validation.h>
+
+#include <univalue.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#ifndef WIN32
+#include <poll.h>
+#endif
+
+#if USE_ZLIB
+#include <zlib.h>
+#endif
+
+std::string BlockToTriples(const CBlock& block, const CBlockIndex* pblockindex)
+{
+    bool withTypes = false;
+
+    std::map<std::string,std::string> blockkeys = {
+        std::make_pair("adder", "integer"),
+        std::make_pair("difficulty", "decimal"),
+        std::make_pair("gaplen", "integer"),
+        std::make_pair("gapstart", "string"),
+        std::make_pair("height", "integer"),
+        std::make_pair("mediantime", "integer"),
+        std::make_pair("merit", "decimal"),
+        std::make_pair("shift", "integer"),
+        std::make_pair("size", "integer"),
+    };
+
+    // std::string chainid = "<http://purl.org/net/bel-epa/ccy#C324fff4a-c492-4e8b-94f4-2f599efd7ba1> ";
+    std::string rdfs = "<http://www.w3.org/1999/02/22-rdf-syntax-ns#";
+    std::string ccy = "<http://purl.org/net/bel-epa/ccy#";
+    std::string ccyC = ccy + "C";
+    std::string doacc = "<http://purl.org/net/bel-epa/doacc#";
+
+    std::stringstream stream;
+
+    // The gap is computed and cached before taking cs_main, and the
+    // transactions are rendered after releasing it, so that dump workers
+    // only hold the lock for the block header fields
+    GetBlockPoWSummary(*pblockindex);
+    UniValue data;
+    {
+        LOCK(cs_main);
+        data = blockToJSON(block, pblockindex, false);
+    }
+    UniValue txs(UniValue::VARR);
+    for (const auto& ptx : block.vtx) {
+        UniValue objTx(UniValue::VOBJ);
+        TxToUniv(*ptx, uint256(), objTx, true, RPCSerializationFlags());
+        txs.push_back(objTx);
+    }
+
+    std::string blockid = "<http://purl.org/net/bel-epa/ccy#C" + data["hash"].getValStr() + "> ";
+    if (withTypes)
+        stream << blockid << rdfs << "type> " << ccy << "Block> ." << std::endl;
+    if (!data["nextblockhash"].isNull())
+        stream << blockid << ccy << "next> " << ccyC << data["nextblockhash"].getValStr() << "> ." << std::endl;
+    if (pblockindex->nHeight > 0)
+        stream << blockid << ccy << "prev> " << ccyC << data["previousblockhash"].getValStr() << "> ." << std::endl;
+    stream << blockid << ccy << "time> \"" << DateTimeStrFormat("%Y-%m-%dT%H:%M:%SZ", std::stoll(data["time"].getValStr())) << "\"^^<http://www.w3.org/2001/XMLSchema#dateTime> ." << std::endl;
+
+    for (auto it = blockkeys.begin(); it != blockkeys.end(); ++it)
+    {
+        stream << blockid << ccy << it->first << "> \"" << data[it->first].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#" << it->second << "> ." << std::endl;
+    }
+
+    UniValue tx(UniValue::VARR);
+    for (size_t i=0; i<txs.size(); i++) {
+        UniValue txi(UniValue::VARR);
+        UniValue txo(UniValue::VARR);
+        UniValue script(UniValue::VARR);
+
+        tx = txs[i];
+
+        std::string txid = ccyC + tx["txid"].getValStr() + "> ";
+        if (withTypes)
+            stream << txid << rdfs << "type> " << ccy << "Transaction> ." << std::endl;
+        stream << blockid << ccy << "transaction> " << txid << " ." << std::endl;
+        stream << txid << ccy << "time> \"" << DateTimeStrFormat("%Y-%m-%dT%H:%M:%SZ", std::stoll(data["time"].getValStr())) << "\"^^<http://www.w3.org/2001/XMLSchema#dateTime> ." << std::endl;
+        if (tx["locktime"].getValStr() != "0")
+            stream << txid << ccy << "locktime> \"" << tx["txid"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#integer> ." << std::endl; 
+
+        if (i == 0) {
+            txi = tx["vin"][0];
+            std::string coinbasetxinput = ccyC + tx["txid"].getValStr() + "-0-0> ";
+            if (withTypes)
+                stream << coinbasetxinput << rdfs << "type> " << ccy << "TransactionInput> ." << std::endl;
+            stream << txid << ccy << "input> " << coinbasetxinput << "." << std::endl;
+            stream << coinbasetxinput << ccy + "coinbase> \"" << txi["coinbase"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
+            stream << coinbasetxinput << ccy + "sequence> \"" << txi["sequence"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#integer> ." << std::endl;
+
+            txo = tx["vout"][0];
+            script = txo["scriptPubKey"];
+            std::string coinbasetxoutput = ccyC + tx["txid"].getValStr() + "-1-0> ";
+            if (withTypes)
+                stream << coinbasetxoutput << rdfs << "type> " << ccy << "TransactionOutput> ." << std::endl;
+            stream << txid << ccy << "output> " << coinbasetxoutput << "." << std::endl;
+            stream << coinbasetxoutput << ccy + "value> \"" << txo["value"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#decimal> ." << std::endl;
+            stream << coinbasetxoutput << ccy + "n> \"" << txo["n"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#integer> ." << std::endl;
+            stream << coinbasetxoutput << ccy + "pkasm> \"" << script["asm"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
+            stream << coinbasetxoutput << ccy + "type> \"" << script["type"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
+            if (script["type"].getValStr() != "nulldata" && script["type"].getValStr() != "nonstandard") {
+                stream << coinbasetxoutput << ccy + "reqSigs> \"" << script["reqSigs"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
+                std::string coinbasetxoutputaddresses = ccy + "OA" + tx["txid"].getValStr() + strprintf("-0-0> ");
+                for (size_t m=0; m<script["addresses"].size();m++) {
+                    std::string coinbasetxoutputaddress = ccy + script["addresses"][m].getValStr() + "> ";
+                    if (withTypes)
+                        stream << coinbasetxoutputaddress << rdfs << "type> " << ccy << "Address> " << "." << std::endl;
+                    stream << coinbasetxoutput << ccy << "address> " << coinbasetxoutputaddress << "." << std::endl;
+                }
+            }
+        } else {
+
+            // create TransactionInput
+            for (size_t j=0;j<tx["vin"].size();j++) {
+                txi = tx["vin"][j];
+                std::string txinputid = ccyC + tx["txid"].getValStr() + "-0-" + std::to_string((int)j) + "> ";
+                if (withTypes)
+                    stream << txinputid << rdfs << "type> " << ccy << "TransactionInput> ." << std::endl;
+                stream << txid << ccy << "input> " << txinputid << "." << std::endl;
+                stream << txinputid << ccy + "txid> " << ccyC << txi["txid"].getValStr() << "> ." << std::endl;
+                stream << txinputid << ccy + "nvout> \"" << txi["vout"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#integer> ." << std::endl;
+                stream << txinputid << ccy + "ssasm> \"" << txi["scriptSig"]["asm"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
+                stream << txinputid << ccy + "sequence> \"" << txi["sequence"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#integer> ." << std::endl;
+                if (!txi["txinwitness"].isNull()) {
+                    for(size_t w=0; w<txi["txinwitness"].size();w++) {
+                        std::string txinputwitness = ccy + txi["txinwitness"][w].getValStr() + "> ";
+                        stream << txinputid << ccy << "witness> " << txinputwitness << " ." << std::endl;
+                    }
+                }
+                // Mark the txins as spent
+                std::string txspentid = ccyC + tx["txid"].getValStr() + "-1-" + txi["vout"].getValStr() + "> ";
+                stream << txspentid << ccy << "spent> \"true\"^^<http://www.w3.org/2001/XMLSchema#boolean> ." << std::endl;
+            }
+
+            // create TransactionOutput
+            for (size_t k=0;k<tx["vout"].size();k++) {
+                txo = tx["vout"][k];
+                script = txo["scriptPubKey"];
+                std::string txoutputid = ccyC + tx["txid"].getValStr() + "-1-" + std::to_string((int)k) + "> ";
+                if (withTypes)
+                    stream << txoutputid << rdfs << "type> " << ccy << "TransactionOutput> ." << std::endl;
+                stream << txid << ccy << "output> " << txoutputid << "." << std::endl;
+                stream << txoutputid << ccy << "spent> \"false\"^^<http://www.w3.org/2001/XMLSchema#boolean> ." << std::endl;
+                stream << txoutputid << ccy + "value> \"" << txo["value"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#decimal> ." << std::endl;
+                stream << txoutputid << ccy + "n> \"" << txo["n"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#integer> ." << std::endl;
+                stream << txoutputid << ccy + "pkasm> \"" << script["asm"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
+                stream << txoutputid << ccy + "type> \"" << script["type"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
+
+                // nonstandard, pubkey, pubkeyhash, scripthash, multisig, nulldata, 
+                // witness_v0_keyhash, witness_v0_scripthash, witness_unknown"
+
+                if (script["type"].getValStr() != "nulldata" && script["type"].getValStr() != "nonstandard") {
+                    stream << txoutputid << ccy + "reqSigs> \"" << script["reqSigs"].getValStr() << "\"^^<http://www.w3.org/2001/XMLSchema#string> ." << std::endl;
+                    for (size_t n=0; n<script["addresses"].size();n++) {
+                        std::string txoutputaddress = ccy + script["addresses"][n].getValStr() + "> ";
+                        if (withTypes)
+                            stream << txoutputid << rdfs << "type> " << ccy << "Address> " << "." << std::endl;
+                        stream << txoutputid << ccy << "address> " << txoutputaddress << "." << std::endl;
+                    }
+                }
+            }
+        }
+    }
+    return stream.str();
+}
+
+namespace {
+
+std::mutex cs_triples;
+CTriplesDumpStatus triplesStatus;
+std::thread threadTriples;
+std::atomic<bool> fStopTriples(false);
+
+class TriplesSink
+{
+public:
+    virtual ~TriplesSink() {}
+    virtual bool Write(const char* pch, size_t nSize) = 0;
+    bool Write(const std::string& str) { return Write(str.data(), str.size()); }
+    /** Flush and close the sink; false if anything written was lost */
+    virtual bool Close() = 0;
+};
+
+/**
+ * Writes straight to a descriptor. A FIFO is written without blocking,
+ * waiting for the reader to make room in short steps, so that a dump
+ * whose reader stalls can still be stopped.
+ */
+class TriplesFdSink : public TriplesSink
+{
+    int fd;
+
+public:
+    explicit TriplesFdSink(int fdIn) : fd(fdIn) {}
+    ~TriplesFdSink() { Close(); }
+
+    bool Write(const char* pch, size_t nSize) override
+    {
+        while (nSize > 0) {
+            ssize_t nWritten = write(fd, pch, nSize);
+            if (nWritten < 0) {
+                if (errno == EINTR)
+                    continue;
+                if ((errno != EAGAIN && errno != EWOULDBLOCK) || fStopTriples)
+                    return false;
+#ifndef WIN32
+                struct pollfd pollFd = {fd, POLLOUT, 0};
+                poll(&pollFd, 1, 100);
+#endif
+                continue;
+            }
+            pch += nWritten;
+            nSize -= nWritten;
+        }
+        return true;
+    }
+
+    bool Close() override
+    {
+        if (fd < 0)
+            return true;
+        bool ret = close(fd) == 0;
+        fd = -1;
+        return ret;
+    }
+};
+
+#if USE_ZLIB
+/** Compresses into the gzip format on the way to another sink */
+class TriplesGzipSink : public TriplesSink
+{
+    std::unique_ptr<TriplesSink> sink;
+    z_stream stream;
+    bool fOpen;
+    std::vector<char> vBuffer;
+
+    bool Deflate(const char* pch, size_t nSize, int nFlush)
+    {
+        stream.next_in = (Bytef*)pch;
+        stream.avail_in = nSize;
+        do {
+            stream.next_out = (Bytef*)vBuffer.data();
+            stream.avail_out = vBuffer.size();
+            if (deflate(&stream, nFlush) == Z_STREAM_ERROR)
+                return false;
+            const size_t nOut = vBuffer.size() - stream.avail_out;
+            if (nOut > 0 && !sink->Write(vBuffer.data(), nOut))
+                return false;
+        } while (stream.avail_out == 0);
+        return true;
+    }
+
+public:
+    explicit TriplesGzipSink(std::unique_ptr<TriplesSink> sinkIn) : sink(std::move(sinkIn)), vBuffer(1 << 16)
+    {
+        memset(&stream, 0, sizeof(stream));
+        // 16 on top of the window bits asks for a gzip header and trailer
+        fOpen = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+    ~TriplesGzipSink() { Close(); }
+
+    bool IsOpen() const { return fOpen; }
+
+    bool Write(const char* pch, size_t nSize) override
+    {
+        return fOpen && Deflate(pch, nSize, Z_NO_FLUSH);
+    }
+
+    bool Close() override
+    {
+        if (!fOpen)
+            return sink->Close();
+        fOpen = false;
+        bool ret = Deflate(nullptr, 0, Z_FINISH);
+        deflateEnd(&stream);
+        return sink->Close() && ret;
+    }
+};
+#endif
+
+/**
+ * Open the descriptor strSink is written through. A FIFO without a reader
+ * yet is retried until one shows up or the dump is stopped.
+ */
+int OpenTriplesFile(const std::string& strSink)
+{
+    if (strSink == "-") {
+        // Closing the sink closes the descriptor, so it gets its own
+        fflush(stdout);
+        return dup(fileno(stdout));
+    }
+#ifndef WIN32
+    while (true) {
+        int fd = open(strSink.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK, 0666);
+        if (fd >= 0 || errno != ENXIO || fStopTriples)
+            return fd;
+        MilliSleep(100);
+    }
+#else
+    FILE* file = fsbridge::fopen(strSink, "wb");
+    if (!file)
+        return -1;
+    int fd = dup(fileno(file));
+    fclose(file);
+    return fd;
+#endif
+}
+
+std::unique_ptr<TriplesSink> OpenTriplesSink(const std::string& strSink, TriplesCompression compression)
+{
+    int fd = OpenTriplesFile(strSink);
+    if (fd < 0)
+        return nullptr;
+    std::unique_ptr<TriplesSink> sink(new TriplesFdSink(fd));
+#if USE_ZLIB
+    if (compression == TriplesCompression::GZIP) {
+        std::unique_ptr<TriplesGzipSink> gzip(new TriplesGzipSink(std::move(sink)));
+        if (!gzip->IsOpen())
+            return nullptr;
+        sink = std::move(gzip);
+    }
+#endif
+    return sink;
+}
+
+/** Shards handed between the workers and the writer */
+struct TriplesShards
+{
+    std::mutex cs;
+    std::condition_variable cond;
+    //! Next shard to hand to a worker
+    int nNext = 0;
+    //! Next shard to be written
+    int nWritten = 0;
+    std::map<int, std::string> mapDone;
+    std::string strError;
+};
+
+void RenderTriplesShards(const std::vector<const CBlockIndex*>& vIndex, TriplesShards& shards, int nAhead)
+{
+    const int nShards = (vIndex.size() + TRIPLES_SHARD_SIZE - 1) / TRIPLES_SHARD_SIZE;
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    while (true) {
+        int nShard;
+        {
+            std::unique_lock<std::mutex> lock(shards.cs);
+            shards.cond.wait(lock, [&] { return fStopTriples || !shards.strError.empty() || shards.nNext < shards.nWritten + nAhead; });
+            if (fStopTriples || !shards.strError.empty() || shards.nNext >= nShards)
+                return;
+            nShard = shards.nNext++;
+        }
+
+        std::string str;
+        std::string strError;
+        const size_t nEnd = std::min(vIndex.size(), (size_t)(nShard + 1) * TRIPLES_SHARD_SIZE);
+        for (size_t i = (size_t)nShard * TRIPLES_SHARD_SIZE; i < nEnd && !fStopTriples; i++) {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, vIndex[i], consensusParams, false)) {
+                strError = strprintf("Block %d not found on disk", vIndex[i]->nHeight);
+                break;
+            }
+            str += BlockToTriples(block, vIndex[i]);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(shards.cs);
+            if (!strError.empty())
+                shards.strError = strError;
+            else
+                shards.mapDone[nShard] = std::move(str);
+        }
+        shards.cond.notify_all();
+    }
+}
+
+void ThreadDumpTriples(const std::vector<const CBlockIndex*>& vIndex, std::string strSink, TriplesCompression compression, int nThreads)
+{
+    std::string strError;
+    std::unique_ptr<TriplesSink> sink = OpenTriplesSink(strSink, compression);
+    if (!sink)
+        strError = fStopTriples ? "Interrupted" : "Could not open " + strSink + " for writing";
+
+    const int nShards = (vIndex.size() + TRIPLES_SHARD_SIZE - 1) / TRIPLES_SHARD_SIZE;
+    TriplesShards shards;
+    std::vector<std::thread> vWorkers;
+    if (sink) {
+        for (int i = 0; i < nThreads; i++)
+            vWorkers.emplace_back(&TraceThread<std::function<void()>>, "triples",
+                                  std::function<void()>(std::bind(&RenderTriplesShards, std::cref(vIndex), std::ref(shards), nThreads * TRIPLES_SHARDS_AHEAD)));
+    }
+
+    for (int nShard = 0; sink && nShard < nShards; nShard++) {
+        std::string str;
+        {
+            std::unique_lock<std::mutex> lock(shards.cs);
+            shards.cond.wait(lock, [&] { return fStopTriples || !shards.strError.empty() || shards.mapDone.count(nShard); });
+            if (!shards.strError.empty()) {
+                strError = shards.strError;
+                break;
+            }
+            if (fStopTriples) {
+                strError = "Interrupted";
+                break;
+            }
+            str = std::move(shards.mapDone[nShard]);
+            shards.mapDone.erase(nShard);
+        }
+
+        if (!sink->Write(str)) {
+            strError = "Failed to write to " + strSink;
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(shards.cs);
+            shards.nWritten = nShard + 1;
+        }
+        shards.cond.notify_all();
+
+        std::lock_guard<std::mutex> lock(cs_triples);
+        triplesStatus.nHeight = std::min(triplesStatus.nEndHeight + 1, triplesStatus.nHeight + TRIPLES_SHARD_SIZE);
+        triplesStatus.nBytes += str.size();
+    }
+
+    // Release the workers still waiting for room
+    {
+        std::lock_guard<std::mutex> lock(shards.cs);
+        if (shards.strError.empty() && !strError.empty())
+            shards.strError = strError;
+    }
+    shards.cond.notify_all();
+    for (std::thread& worker : vWorkers)
+        worker.join();
+    if (sink && !sink->Close() && strError.empty())
+        strError = "Failed to write to " + strSink;
+
+    std::lock_guard<std::mutex> lock(cs_triples);
+    triplesStatus.fRunning = false;
+    triplesStatus.nEndTime = GetTime();
+    triplesStatus.strError = strError;
+    if (strError.empty())
+        LogPrintf("Triples dump to %s done, %d blocks, %u bytes\n", strSink, triplesStatus.nHeight - triplesStatus.nStartHeight, triplesStatus.nBytes);
+    else
+        LogPrintf("Triples dump to %s stopped at height %d: %s\n", strSink, triplesStatus.nHeight, strError);
+}
+
+} // namespace
+
+bool ParseTriplesCompression(const std::string& str, TriplesCompression& compression)
+{
+    if (str == "none") {
+        compression = TriplesCompression::NONE;
+        return true;
+    }
+#if USE_ZLIB
+    if (str == "gzip") {
+        compression = TriplesCompression::GZIP;
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool StartTriplesDump(const std::string& strSink, int nStartHeight, int nEndHeight, TriplesCompression compression, int nThreads, std::string& strError)
+{
+    std::lock_guard<std::mutex> lock(cs_triples);
+    if (triplesStatus.fRunning) {
+        strError = "A triples dump is already running";
+        return false;
+    }
+    if (threadTriples.joinable())
+        threadTriples.join();
+
+    /* Prevent arbitrary files from being overwritten. There have been reports
+     * that users have overwritten wallet files this way:
+     * https://github.com/bitcoin/bitcoin/issues/9934
+     * A FIFO is left to whoever reads it.
+     */
+    if (strSink != "-" && fs::exists(strSink) && fs::status(strSink).type() != fs::fifo_file) {
+        strError = strSink + " already exists";
+        return false;
+    }
+    // The log would be interleaved with the triples
+    if (strSink == "-" && fPrintToConsole) {
+        strError = "Standard output is taken by -printtoconsole";
+        return false;
+    }
+
+    std::vector<const CBlockIndex*> vIndex;
+    {
+        LOCK(cs_main);
+        if (nStartHeight < 0 || nStartHeight > nEndHeight || nEndHeight > chainActive.Height()) {
+            strError = "Block height out of range";
+            return false;
+        }
+        for (int h = nStartHeight; h <= nEndHeight; h++) {
+            const CBlockIndex* pindex = chainActive[h];
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+                strError = strprintf("Block %d not available (pruned data)", h);
+                return false;
+            }
+            vIndex.push_back(pindex);
+        }
+    }
+
+    nThreads = std::max(1, nThreads);
+    triplesStatus = CTriplesDumpStatus();
+    triplesStatus.fRunning = true;
+    triplesStatus.strSink = strSink;
+    triplesStatus.nStartHeight = nStartHeight;
+    triplesStatus.nEndHeight = nEndHeight;
+    triplesStatus.nHeight = nStartHeight;
+    triplesStatus.nThreads = nThreads;
+    triplesStatus.nStartTime = GetTime();
+    LogPrintf("Dumping the triples of blocks %d to %d to %s with %d threads\n", nStartHeight, nEndHeight, strSink, nThreads);
+
+    fStopTriples = false;
+    threadTriples = std::thread(&TraceThread<std::function<void()>>, "triplesdump",
+                                std::function<void()>(std::bind(&ThreadDumpTriples, std::move(vIndex), strSink, compression, nThreads)));
+    return true;
+}
+
+CTriplesDumpStatus GetTriplesDumpStatus()
+{
+    std::lock_guard<std::mutex> lock(cs_triples);
+    return triplesStatus;
+}
+
+void StopTriplesDump()
+{
+    // Workers check the flag between blocks and wake the writer when they
+    // hand in their shard, which then releases the others
+    fStopTriples = true;
+    // The thread takes cs_triples on its way out, so join without it
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock(cs_triples);
+        thread = std::move(threadTriples);
+    }
+    if (thread.joinable())
+        thread.join();
+}
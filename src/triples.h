@@ -0,0 +1,67 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TRIPLES_H
+#define BITCOIN_TRIPLES_H
+
+#include <fs.h>
+
+#include <stdint.h>
+#include <string>
+
+class CBlock;
+class CBlockIndex;
+
+/** Blocks rendered together by one worker */
+static const int TRIPLES_SHARD_SIZE = 100;
+/** Shards rendered ahead of the writer per worker, bounding the memory held */
+static const int TRIPLES_SHARDS_AHEAD = 4;
+/** Maximum number of rendering workers */
+static const int MAX_TRIPLES_THREADS = 64;
+
+enum class TriplesCompression
+{
+    NONE,
+    GZIP,
+};
+
+/** Parse "none" or "gzip"; false if unknown or not compiled in */
+bool ParseTriplesCompression(const std::string& str, TriplesCompression& compression);
+
+/** Progress of the last triples dump */
+struct CTriplesDumpStatus
+{
+    bool fRunning = false;
+    std::string strSink;
+    int nStartHeight = 0;
+    int nEndHeight = 0;
+    //! Next height to be written
+    int nHeight = 0;
+    //! Uncompressed bytes written
+    uint64_t nBytes = 0;
+    int nThreads = 0;
+    int64_t nStartTime = 0;
+    int64_t nEndTime = 0;
+    std::string strError;
+};
+
+/** RDF serialization of a block as N-Triples; takes cs_main only briefly */
+std::string BlockToTriples(const CBlock& block, const CBlockIndex* pblockindex);
+
+/**
+ * Start writing the N-Triples of the active chain blocks
+ * nStartHeight..nEndHeight in the background. The range is cut into shards
+ * of TRIPLES_SHARD_SIZE blocks that nThreads workers render while the shards
+ * are written to the sink in order. The sink is a new file, an existing
+ * FIFO, or the node's standard output for "-", which is refused while the
+ * log is printed there. A FIFO is waited on for a reader and written
+ * without blocking, so the dump can be stopped while its reader stalls.
+ * Returns false with strError set if the dump cannot start.
+ */
+bool StartTriplesDump(const std::string& strSink, int nStartHeight, int nEndHeight, TriplesCompression compression, int nThreads, std::string& strError);
+CTriplesDumpStatus GetTriplesDumpStatus();
+/** Interrupt a running dump and wait for it to stop */
+void StopTriplesDump();
+
+#endif // BITCOIN_TRIPLES_H
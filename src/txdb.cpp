@@ -14,9 +14,12 @@
 #include <util.h>
 #include <ui_interface.h>
 #include <init.h>
+#include <warnings.h>
 
 #include <stdint.h>
 
+#include <functional>
+
 #include <boost/thread.hpp>
 
 static const char DB_COIN = 'C';
@@ -107,7 +110,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, old_tip});
 
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); ++it) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             CoinEntry entry(&it->first);
             if (it->second.coin.IsSpent())
@@ -117,8 +120,6 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -148,6 +149,160 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
+CCoinsViewFlusher::CCoinsViewFlusher(CCoinsView* viewIn) : CCoinsViewBacked(viewIn)
+{
+    thread = std::thread(&TraceThread<std::function<void()>>, "coinsflush",
+        std::function<void()>(std::bind(&CCoinsViewFlusher::ThreadWrite, this)));
+}
+
+CCoinsViewFlusher::~CCoinsViewFlusher()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStop = true;
+    }
+    cond.notify_all();
+    thread.join();
+}
+
+void CCoinsViewFlusher::ThreadWrite()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    while (true) {
+        cond.wait(lock, [this]{ return fWriting || fStop; });
+        // A batch handed over before shutdown is still written
+        if (!fWriting)
+            return;
+
+        lock.unlock();
+        // The batch is not modified until it is written, so its usage can be
+        // summed unlocked, once, rather than on every DynamicMemoryUsage call
+        size_t nUsage = memusage::DynamicUsage(mapWriting);
+        for (const auto& entry : mapWriting)
+            nUsage += entry.second.coin.DynamicMemoryUsage();
+        {
+            std::lock_guard<std::mutex> lockUsage(cs);
+            nWritingUsage = nUsage;
+        }
+        const int64_t nStart = GetTimeMicros();
+        bool fOk = false;
+        try {
+            fOk = base->BatchWrite(mapWriting, hashWriting);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+        const int64_t nTime = GetTimeMicros() - nStart;
+        lock.lock();
+
+        LogPrint(BCLog::COINDB, "Wrote %u coins in the background in %.2fms\n", mapWriting.size(), nTime * 0.001);
+        stats.nWrites++;
+        stats.nLastEntries = mapWriting.size();
+        stats.nLastWriteMicros = nTime;
+        stats.nTotalWriteMicros += nTime;
+        fWriting = false;
+        if (fOk) {
+            stats.nWritingEntries = 0;
+            mapWriting.clear();
+            nWritingUsage = 0;
+        } else {
+            // The database now lags the tip, which was synced on the
+            // assumption this batch lands. Keep answering lookups from it
+            // until the node is down, and take the node down now rather
+            // than at the next flush.
+            fFailed = true;
+            const std::string strMessage = "Failed to write to coin database";
+            SetMiscWarning(strMessage);
+            LogPrintf("*** %s\n", strMessage);
+            uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details"), "", CClientUIInterface::MSG_ERROR);
+            StartShutdown();
+        }
+        cond.notify_all();
+    }
+}
+
+bool CCoinsViewFlusher::GetCoin(const COutPoint &outpoint, Coin &coin) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (fWriting || fFailed) {
+            CCoinsMap::const_iterator it = mapWriting.find(outpoint);
+            if (it != mapWriting.end()) {
+                if (it->second.coin.IsSpent())
+                    return false;
+                coin = it->second.coin;
+                return true;
+            }
+        }
+    }
+    // Entries not in the batch are not touched by writing it
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewFlusher::HaveCoin(const COutPoint &outpoint) const
+{
+    Coin coin;
+    return GetCoin(outpoint, coin);
+}
+
+uint256 CCoinsViewFlusher::GetBestBlock() const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (fWriting || fFailed)
+            return hashWriting;
+    }
+    return base->GetBestBlock();
+}
+
+bool CCoinsViewFlusher::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    cond.wait(lock, [this]{ return !fWriting; });
+    if (fFailed)
+        return false;
+    mapWriting.swap(mapCoins);
+    hashWriting = hashBlock;
+    nWritingUsage = memusage::DynamicUsage(mapWriting);
+    fWriting = true;
+    stats.nWritingEntries = mapWriting.size();
+    cond.notify_all();
+    return true;
+}
+
+CCoinsViewCursor *CCoinsViewFlusher::Cursor() const
+{
+    Wait();
+    return base->Cursor();
+}
+
+bool CCoinsViewFlusher::Wait() const
+{
+    std::unique_lock<std::mutex> lock(cs);
+    cond.wait(lock, [this]{ return !fWriting; });
+    return !fFailed;
+}
+
+void CCoinsViewFlusher::RecordStall(int64_t nMicros)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    stats.nStalls++;
+    stats.nLastStallMicros = nMicros;
+    stats.nMaxStallMicros = std::max(stats.nMaxStallMicros, nMicros);
+    stats.nTotalStallMicros += nMicros;
+}
+
+CCoinsFlushStats CCoinsViewFlusher::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return stats;
+}
+
+size_t CCoinsViewFlusher::DynamicMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return nWritingUsage;
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
 }
 
@@ -286,7 +441,7 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
                 pindexNew->nDifficulty    = diskindex.nDifficulty;
                 pindexNew->nNonce         = diskindex.nNonce;
                 pindexNew->nShift         = diskindex.nShift;
-                pindexNew->nAdd.assign(diskindex.nAdd.begin(), diskindex.nAdd.end());
+                pindexNew->nAdd           = diskindex.nAdd;
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
 
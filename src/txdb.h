@@ -10,9 +10,12 @@
 #include <dbwrapper.h>
 #include <chain.h>
 
+#include <condition_variable>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -84,6 +87,70 @@ public:
     size_t EstimateSize() const override;
 };
 
+/** Counters of the coins flushes, for getcoinsflushinfo */
+struct CCoinsFlushStats
+{
+    //! Batches written
+    uint64_t nWrites = 0;
+    //! Entries in the last batch
+    uint64_t nLastEntries = 0;
+    int64_t nLastWriteMicros = 0;
+    int64_t nTotalWriteMicros = 0;
+    //! Flushes of the tip, with the time validation was held up by them
+    uint64_t nStalls = 0;
+    int64_t nLastStallMicros = 0;
+    int64_t nMaxStallMicros = 0;
+    int64_t nTotalStallMicros = 0;
+    //! Entries of the batch being written, 0 if none
+    uint64_t nWritingEntries = 0;
+};
+
+/**
+ * CCoinsView that writes the batches it is given to its base in a
+ * background thread, so flushing the tip does not wait for the database.
+ * Until a batch is written, lookups are answered from it, and the next
+ * BatchWrite waits for it. The base has to leave the batch unmodified, as
+ * CCoinsViewDB does, since lookups read it while it is being written.
+ * CCoinsViewDB marks the database as being in transition until the batch is
+ * complete, so a crash halfway is replayed at startup as before. A batch
+ * that fails to write keeps answering lookups, and the node is shut down.
+ */
+class CCoinsViewFlusher final : public CCoinsViewBacked
+{
+private:
+    mutable std::mutex cs;
+    mutable std::condition_variable cond;
+    //! The batch handed over by BatchWrite and not written yet, or that failed to
+    CCoinsMap mapWriting;
+    uint256 hashWriting;
+    //! Memory used by mapWriting, counting the coins once the writer got to it
+    size_t nWritingUsage = 0;
+    bool fWriting = false;
+    bool fFailed = false;
+    bool fStop = false;
+    CCoinsFlushStats stats;
+    std::thread thread;
+
+    void ThreadWrite();
+
+public:
+    explicit CCoinsViewFlusher(CCoinsView* viewIn);
+    ~CCoinsViewFlusher();
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    uint256 GetBestBlock() const override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    CCoinsViewCursor *Cursor() const override;
+
+    //! Wait for the batch being written. Returns false if a write failed.
+    bool Wait() const;
+    //! Account for a flush of the tip that held up validation for nMicros
+    void RecordStall(int64_t nMicros);
+    CCoinsFlushStats GetStats() const;
+    size_t DynamicMemoryUsage() const;
+};
+
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
 class CCoinsViewDBCursor: public CCoinsViewCursor
 {
@@ -35,6 +35,10 @@
 #include <sys/resource.h>
 #include <sys/stat.h>
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 #else
 
 #ifdef _MSC_VER
@@ -254,6 +258,7 @@ const CLogCategoryDesc LogCategories[] =
     {BCLog::QT, "qt"},
     {BCLog::LEVELDB, "leveldb"},
     {BCLog::DEVEL, "devel"},
+    {BCLog::MINING, "mining"},
     {BCLog::ALL, "1"},
     {BCLog::ALL, "all"},
 };
@@ -936,6 +941,68 @@ bool SetupNetworking()
     return true;
 }
 
+std::vector<int> GetAvailableCores()
+{
+    std::vector<int> vCores;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int nCore = 0; nCore < CPU_SETSIZE; nCore++) {
+            if (CPU_ISSET(nCore, &set))
+                vCores.push_back(nCore);
+        }
+    }
+#endif
+    return vCores;
+}
+
+bool PinThreadToCore(int nCore)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(nCore, &set);
+    // On Linux a pid of 0 is the calling thread, not the whole process
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)nCore;
+    return false;
+#endif
+}
+
+int GetCoreNumaNode(int nCore)
+{
+#ifdef __linux__
+    // The CPU's sysfs directory links to its node as "node<n>"
+    boost::system::error_code ec;
+    for (fs::directory_iterator it(strprintf("/sys/devices/system/cpu/cpu%d", nCore), ec), end; !ec && it != end; it.increment(ec)) {
+        const std::string name = it->path().filename().string();
+        int32_t nNode;
+        if (name.compare(0, 4, "node") == 0 && ParseInt32(name.substr(4), &nNode))
+            return nNode;
+    }
+#else
+    (void)nCore;
+#endif
+    return -1;
+}
+
+std::string GetTransparentHugePages()
+{
+#ifdef __linux__
+    // Reads like "always [madvise] never", with the selected mode in brackets
+    fs::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string line;
+    if (std::getline(file, line)) {
+        size_t nBegin = line.find('['), nEnd = line.find(']');
+        if (nBegin != std::string::npos && nEnd != std::string::npos && nBegin < nEnd)
+            return line.substr(nBegin + 1, nEnd - nBegin - 1);
+    }
+#endif
+    return "";
+}
+
 int GetNumCores()
 {
 #if BOOST_VERSION >= 105600
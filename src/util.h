@@ -115,6 +115,7 @@ namespace BCLog {
         QT          = (1 << 19),
         LEVELDB     = (1 << 20),
         DEVEL       = (1 << 22),
+        MINING      = (1 << 23),
         ALL         = ~(uint32_t)0,
     };
 }
@@ -352,6 +353,15 @@ inline void SetThreadPriority(int nPriority)
 
 void RenameThread(const char* name);
 
+/** CPUs the process may run on, or an empty vector where this can't be told */
+std::vector<int> GetAvailableCores();
+/** Pin the calling thread to one CPU. Returns false where unsupported or when it fails. */
+bool PinThreadToCore(int nCore);
+/** NUMA node a CPU belongs to, or -1 where unknown */
+int GetCoreNumaNode(int nCore);
+/** The selected transparent huge page mode ("always", "madvise", "never"), or "" where unknown */
+std::string GetTransparentHugePages();
+
 /**
  * .. and a wrapper that just calls func once
  */
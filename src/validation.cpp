@@ -12,6 +12,7 @@
 #include <chainparams.h>
 #include <checkpoints.h>
 #include <checkqueue.h>
+#include <coinsprefetch.h>
 #include <consensus/consensus.h>
 #include <consensus/merkle.h>
 #include <consensus/tx_verify.h>
@@ -20,6 +21,7 @@
 #include <cuckoocache.h>
 #include <hash.h>
 #include <init.h>
+#include <memusage.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <policy/rbf.h>
@@ -163,8 +165,8 @@ public:
 
     bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams, std::shared_ptr<const CBlock> pblock);
 
-    bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex);
-    bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock);
+    bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fCheckPoW = true);
+    bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock, bool fCheckPoW = true);
 
     // Block (dis)connection on a given view:
     DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view);
@@ -287,6 +289,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 std::unique_ptr<CCoinsViewDB> pcoinsdbview;
+std::unique_ptr<CCoinsViewFlusher> pcoinsflusher;
 std::unique_ptr<CCoinsViewCache> pcoinsTip;
 std::unique_ptr<CBlockTreeDB> pblocktree;
 
@@ -1701,6 +1704,39 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CPoWCheck> powcheckqueue(16);
+
+void ThreadPoWCheck() {
+    RenameThread("gapcoin-powch");
+    powcheckqueue.Thread();
+}
+
+/**
+ * Verify the proofs of work of a batch of headers on the PoW check threads.
+ * Returns true only if all of them were checked and are valid. Otherwise the
+ * caller has to check the headers one by one, which also tells it which one
+ * is at fault.
+ */
+static bool CheckProofOfWorkParallel(const std::vector<const CBlockHeader*>& vHeaders, const Consensus::Params& consensusParams)
+{
+    if (!nScriptCheckThreads || vHeaders.size() < 2)
+        return false;
+
+    std::atomic<int64_t> nMicros{0};
+    std::vector<CPoWCheck> vChecks;
+    vChecks.reserve(vHeaders.size());
+    for (const CBlockHeader* header : vHeaders)
+        vChecks.emplace_back(*header, consensusParams, &nMicros);
+
+    CCheckQueueControl<CPoWCheck> control(&powcheckqueue);
+    control.Add(vChecks);
+    bool fValid = control.Wait();
+
+    // Account the batch to the caller, as if it had checked the headers itself
+    AddPoWCheckMicros(nMicros);
+    return fValid;
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2067,6 +2103,9 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
         }
         int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
         int64_t cacheSize = pcoinsTip->DynamicMemoryUsage();
+        // A coins batch still being written in the background holds on to its memory too
+        if (pcoinsflusher)
+            cacheSize += pcoinsflusher->DynamicMemoryUsage();
         int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
         // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
         bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
@@ -2103,9 +2142,13 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                     return AbortNode(state, "Failed to write to block index database");
                 }
             }
-            // Finally remove any pruned files
-            if (fFlushForPrune)
+            // Finally remove any pruned files, once a coins batch still being
+            // written, which may need them replayed after a crash, is on disk
+            if (fFlushForPrune) {
+                if (pcoinsflusher && !pcoinsflusher->Wait())
+                    return AbortNode(state, "Failed to write to coin database");
                 UnlinkPrunedFiles(setFilesToPrune);
+            }
             nLastWrite = nNow;
         }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
@@ -2118,8 +2161,25 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
             // Flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
+            // The coins stay cached unless the cache and the batch written
+            // would be over the limit, in which case half of it is used, and
+            // the database is written in the background unless the caller
+            // needs it on disk now.
+            const int64_t nStallStart = GetTimeMicros();
+            const size_t nKeepUsage = (fCacheLarge || fCacheCritical) ? nTotalSpace / 2 : nTotalSpace;
+            // Coins read from the base while Sync runs may predate what it
+            // writes, so prefetches are invalidated on both sides of it
+            InvalidatePrefetchedCoins();
+            const bool fSynced = pcoinsTip->Sync(nKeepUsage);
+            InvalidatePrefetchedCoins();
+            if (!fSynced)
                 return AbortNode(state, "Failed to write to coin database");
+            if (mode == FLUSH_STATE_ALWAYS && pcoinsflusher && !pcoinsflusher->Wait())
+                return AbortNode(state, "Failed to write to coin database");
+            const int64_t nStall = GetTimeMicros() - nStallStart;
+            if (pcoinsflusher)
+                pcoinsflusher->RecordStall(nStall);
+            LogPrint(BCLog::BENCH, "  - Flush coins: %.2fms held up [%u coins cached]\n", nStall * 0.001, pcoinsTip->GetCacheSize());
             nLastFlush = nNow;
         }
     }
@@ -2365,6 +2425,7 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    ApplyPrefetchedCoins(blockConnecting, *pcoinsTip);
     {
         CCoinsViewCache view(pcoinsTip.get());
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
@@ -3260,7 +3321,7 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     return true;
 }
 
-bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fCheckPoW)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
@@ -3279,7 +3340,7 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), fCheckPoW))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -3323,11 +3384,24 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
     if (first_invalid != nullptr) first_invalid->SetNull();
+
+    // Check the proofs of work of the headers we don't know yet in parallel,
+    // without holding cs_main
+    std::vector<const CBlockHeader*> vNewHeaders;
+    {
+        LOCK(cs_main);
+        for (const CBlockHeader& header : headers) {
+            if (mapBlockIndex.count(header.GetHash()) == 0)
+                vNewHeaders.push_back(&header);
+        }
+    }
+    bool fPoWChecked = CheckProofOfWorkParallel(vNewHeaders, chainparams.GetConsensus());
+
     {
         LOCK(cs_main);
         for (const CBlockHeader& header : headers) {
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex, !fPoWChecked)) {
                 if (first_invalid) *first_invalid = header;
                 return false;
             }
@@ -3360,7 +3434,7 @@ static CDiskBlockPos SaveBlockToDisk(const CBlock& block, int nHeight, const CCh
 }
 
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
-bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock)
+bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock, bool fCheckPoW)
 {
     const CBlock& block = *pblock;
 
@@ -3370,7 +3444,8 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
     CBlockIndex *pindexDummy = nullptr;
     CBlockIndex *&pindex = ppindex ? *ppindex : pindexDummy;
 
-    if (!AcceptBlockHeader(block, state, chainparams, &pindex))
+    // A block that passed CheckBlock already had its proof of work verified
+    if (!AcceptBlockHeader(block, state, chainparams, &pindex, fCheckPoW && !block.fChecked))
         return false;
 
     // Try to process all requested blocks that we don't have, but only
@@ -3406,7 +3481,7 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
     }
     if (fNewBlock) *fNewBlock = true;
 
-    if (!CheckBlock(block, state, chainparams.GetConsensus()) ||
+    if (!CheckBlock(block, state, chainparams.GetConsensus(), fCheckPoW) ||
         !ContextualCheckBlock(block, state, chainparams.GetConsensus(), pindex->pprev)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
@@ -3449,6 +3524,9 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
         CBlockIndex *pindex = nullptr;
         if (fNewBlock) *fNewBlock = false;
         CValidationState state;
+        // Read the coins the block spends while its proof of work is checked
+        if (!pblock->fChecked)
+            PrefetchBlockCoins(pblock);
         // Ensure that CheckBlock() passes before calling AcceptBlock, as
         // belt-and-suspenders.
         bool ret = CheckBlock(*pblock, state, chainparams.GetConsensus());
@@ -3770,9 +3848,15 @@ bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlo
 
 bool static LoadBlockIndexDB(const CChainParams& chainparams)
 {
+    int64_t nStart = GetTimeMillis();
     if (!g_chainstate.LoadBlockIndex(chainparams.GetConsensus(), *pblocktree))
         return false;
 
+    size_t nIndexUsage = memusage::DynamicUsage(mapBlockIndex);
+    for (const BlockMap::value_type& entry : mapBlockIndex)
+        nIndexUsage += memusage::MallocUsage(sizeof(CBlockIndex)) + memusage::DynamicUsage(entry.second->nAdd);
+    LogPrintf("%s: loaded %u block index entries in %dms, using %.1fMiB\n", __func__, mapBlockIndex.size(), GetTimeMillis() - nStart, nIndexUsage * (1.0 / 1024 / 1024));
+
     // Load block file info
     pblocktree->ReadLastBlockFile(nLastBlockFile);
     vinfoBlockFile.resize(nLastBlockFile + 1);
@@ -3958,6 +4042,75 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
     return true;
 }
 
+bool CheckBlockIndexPoW(const CChainParams& chainparams, int nCheckDepth, bool fShowProgress)
+{
+    const Consensus::Params& consensusParams = chainparams.GetConsensus();
+
+    // Block index entries stay allocated while the node runs and their
+    // header fields don't change, so they are checked without cs_main
+    std::vector<const CBlockIndex*> vIndex;
+    {
+        LOCK(cs_main);
+        if (nCheckDepth < 0) {
+            vIndex.reserve(mapBlockIndex.size());
+            for (const BlockMap::value_type& entry : mapBlockIndex)
+                vIndex.push_back(entry.second);
+        } else {
+            for (const CBlockIndex* pindex = chainActive.Tip(); pindex && (int)vIndex.size() < nCheckDepth; pindex = pindex->pprev)
+                vIndex.push_back(pindex);
+        }
+    }
+
+    LogPrintf("Verifying the proofs of work of %u block index entries...\n", vIndex.size());
+    if (fShowProgress)
+        uiInterface.ShowProgress(_("Verifying block index..."), 0, false);
+
+    static const size_t nChunkSize = 256;
+    for (size_t nStart = 0; nStart < vIndex.size(); nStart += nChunkSize) {
+        boost::this_thread::interruption_point();
+
+        const size_t nEnd = std::min(vIndex.size(), nStart + nChunkSize);
+        std::vector<CBlockHeader> vHeaders;
+        vHeaders.reserve(nEnd - nStart);
+        for (size_t i = nStart; i < nEnd; i++) {
+            // As in AcceptBlockHeader, the genesis block is exempt
+            if (vIndex[i]->GetBlockHash() != consensusParams.hashGenesisBlock)
+                vHeaders.push_back(vIndex[i]->GetBlockHeader());
+        }
+
+        std::vector<const CBlockHeader*> vpHeaders;
+        vpHeaders.reserve(vHeaders.size());
+        for (const CBlockHeader& header : vHeaders)
+            vpHeaders.push_back(&header);
+
+        if (!CheckProofOfWorkParallel(vpHeaders, consensusParams)) {
+            // Single threaded, or something failed: go through the chunk one by one
+            for (const CBlockHeader& header : vHeaders) {
+                if (!CheckProofOfWork(header.GetHash(), header.nShift, &header.nAdd, header.nDifficulty, consensusParams)) {
+                    if (fShowProgress)
+                        uiInterface.ShowProgress("", 100, false);
+                    return error("%s: invalid proof of work in the block index for block %s", __func__, header.GetHash().ToString());
+                }
+            }
+        }
+
+        if (fShowProgress)
+            uiInterface.ShowProgress(_("Verifying block index..."), (int)(nEnd * 100 / vIndex.size()), false);
+    }
+
+    if (fShowProgress)
+        uiInterface.ShowProgress("", 100, false);
+    LogPrintf("Block index proofs of work verified\n");
+    return true;
+}
+
+void ThreadCheckBlockIndexPoW(int nCheckDepth)
+{
+    RenameThread("gapcoin-indexpow");
+    if (!CheckBlockIndexPoW(Params(), nCheckDepth, false))
+        AbortNode("Corrupted block index detected", _("Corrupted block database detected. Please restart with -reindex."));
+}
+
 /** Apply the effects of a block on the utxo cache, ignoring that it may already have been applied. */
 bool CChainState::RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs, const CChainParams& params)
 {
@@ -4182,6 +4335,7 @@ void UnloadBlockIndex()
         delete entry.second;
     }
     mapBlockIndex.clear();
+    ResetPoWSummaryCacheUsage();
     fHavePruned = false;
 
     g_chainstate.UnloadBlockIndex();
@@ -4248,109 +4402,151 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
     static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
+    // Blocks in mapBlocksUnknownParent whose proof of work was already checked
+    static std::set<uint256> setUnknownParentPoWChecked;
     int64_t nStart = GetTimeMillis();
 
+    // Blocks are read ahead in batches so their proofs of work can be checked in parallel
+    const size_t nBatchSize = nScriptCheckThreads ? 16 * nScriptCheckThreads : 1;
+
     int nLoaded = 0;
     try {
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                            block.hashPrevBlock.ToString());
-                    if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                    continue;
+        bool fDone = false;
+        while (!fDone && !blkdat.eof()) {
+            std::vector<std::pair<std::shared_ptr<CBlock>, CDiskBlockPos>> vBlocks;
+            while (vBlocks.size() < nBatchSize && !blkdat.eof()) {
+                boost::this_thread::interruption_point();
+
+                blkdat.SetPos(nRewind);
+                nRewind++; // start one byte further next time, in case of failure
+                blkdat.SetLimit(); // remove former limit
+                unsigned int nSize = 0;
+                try {
+                    // locate a header
+                    unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+                    blkdat.FindByte(chainparams.MessageStart()[0]);
+                    nRewind = blkdat.GetPos()+1;
+                    blkdat >> FLATDATA(buf);
+                    if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                        continue;
+                    // read size
+                    blkdat >> nSize;
+                    if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                        continue;
+                } catch (const std::exception&) {
+                    // no valid block header found; don't complain
+                    fDone = true;
+                    break;
                 }
+                try {
+                    // read block
+                    uint64_t nBlockPos = blkdat.GetPos();
+                    CDiskBlockPos pos;
+                    if (dbp) {
+                        pos = *dbp;
+                        pos.nPos = nBlockPos;
+                    }
+                    blkdat.SetLimit(nBlockPos + nSize);
+                    blkdat.SetPos(nBlockPos);
+                    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                    blkdat >> *pblock;
+                    nRewind = blkdat.GetPos();
+                    vBlocks.emplace_back(pblock, pos);
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+                }
+            }
 
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    LOCK(cs_main);
-                    CValidationState state;
-                    if (g_chainstate.AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr))
-                        nLoaded++;
-                    if (state.IsError())
-                        break;
-                } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
+            // Check the proofs of work of the blocks we don't have yet in parallel
+            std::vector<const CBlockHeader*> vNewBlocks;
+            {
+                LOCK(cs_main);
+                for (const auto& entry : vBlocks) {
+                    BlockMap::iterator mi = mapBlockIndex.find(entry.first->GetHash());
+                    if (mi == mapBlockIndex.end() || (mi->second->nStatus & BLOCK_HAVE_DATA) == 0)
+                        vNewBlocks.push_back(entry.first.get());
                 }
+            }
+            const bool fPoWChecked = CheckProofOfWorkParallel(vNewBlocks, chainparams.GetConsensus());
 
-                // Activate the genesis block so normal node progress can continue
-                if (hash == chainparams.GetConsensus().hashGenesisBlock) {
-                    CValidationState state;
-                    if (!ActivateBestChain(state, chainparams)) {
-                        break;
+            for (auto& entry : vBlocks) {
+                try {
+                    std::shared_ptr<CBlock> pblock = entry.first;
+                    CBlock& block = *pblock;
+                    CDiskBlockPos* pos = dbp ? &entry.second : nullptr;
+
+                    // detect out of order blocks, and store them for later
+                    uint256 hash = block.GetHash();
+                    if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+                        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                                block.hashPrevBlock.ToString());
+                        if (pos) {
+                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *pos));
+                            if (fPoWChecked)
+                                setUnknownParentPoWChecked.insert(hash);
+                        }
+                        continue;
                     }
-                }
 
-                NotifyHeaderTip();
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
-                        {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            CValidationState dummy;
-                            if (g_chainstate.AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr))
+                    // process in case the block isn't known yet
+                    if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+                        LOCK(cs_main);
+                        CValidationState state;
+                        if (g_chainstate.AcceptBlock(pblock, state, chainparams, nullptr, true, pos, nullptr, !fPoWChecked))
+                            nLoaded++;
+                        if (state.IsError()) {
+                            fDone = true;
+                            break;
+                        }
+                    } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
+                        LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
+                    }
+
+                    // Activate the genesis block so normal node progress can continue
+                    if (hash == chainparams.GetConsensus().hashGenesisBlock) {
+                        CValidationState state;
+                        if (!ActivateBestChain(state, chainparams)) {
+                            fDone = true;
+                            break;
+                        }
+                    }
+
+                    NotifyHeaderTip();
+
+                    // Recursively process earlier encountered successors of this block
+                    std::deque<uint256> queue;
+                    queue.push_back(hash);
+                    while (!queue.empty()) {
+                        uint256 head = queue.front();
+                        queue.pop_front();
+                        std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+                        while (range.first != range.second) {
+                            std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+                            std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+                            if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus(), false))
                             {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
+                                LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                                        head.ToString());
+                                bool fChildPoWChecked = setUnknownParentPoWChecked.erase(pblockrecursive->GetHash()) > 0;
+                                LOCK(cs_main);
+                                CValidationState dummy;
+                                if (g_chainstate.AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr, !fChildPoWChecked))
+                                {
+                                    nLoaded++;
+                                    queue.push_back(pblockrecursive->GetHash());
+                                }
                             }
+                            range.first++;
+                            mapBlocksUnknownParent.erase(it);
+                            NotifyHeaderTip();
                         }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip();
                     }
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
                 }
-            } catch (const std::exception& e) {
-                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
         }
     } catch (const std::runtime_error& e) {
@@ -36,6 +36,7 @@ class CBlockIndex;
 class CBlockTreeDB;
 class CChainParams;
 class CCoinsViewDB;
+class CCoinsViewFlusher;
 class CInv;
 class CConnman;
 class CScriptCheck;
@@ -211,6 +212,8 @@ static const unsigned int NODE_NETWORK_LIMITED_MIN_BLOCKS = 288;
 
 static const signed int DEFAULT_CHECKBLOCKS = 6;
 static const unsigned int DEFAULT_CHECKLEVEL = 3;
+/** -checkindexpow default: the most recent blocks whose proofs of work are re-verified in the background after startup */
+static const int DEFAULT_CHECKINDEXPOW = 2880;
 
 // Require that user allocate at least 550MB for block & undo files (blk???.dat and rev???.dat)
 // At 1MB per block, 288 blocks = 288MB.
@@ -275,6 +278,8 @@ bool LoadChainTip(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the proof of work checking thread, used for header batches and -reindex */
+void ThreadPoWCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
@@ -428,6 +433,15 @@ public:
     bool VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview, int nCheckLevel, int nCheckDepth);
 };
 
+/**
+ * Re-verify the proofs of work stored in the block index, for the nCheckDepth
+ * most recent blocks of the active chain, or for every entry if nCheckDepth
+ * is negative. Uses the -par verification threads.
+ */
+bool CheckBlockIndexPoW(const CChainParams& chainparams, int nCheckDepth, bool fShowProgress);
+/** Run CheckBlockIndexPoW in the background, shutting down if an invalid proof is found */
+void ThreadCheckBlockIndexPoW(int nCheckDepth);
+
 /** Replay blocks that aren't fully applied to the database. */
 bool ReplayBlocks(const CChainParams& params, CCoinsView* view);
 
@@ -449,6 +463,9 @@ extern CChain& chainActive;
 /** Global variable that points to the coins database (protected by cs_main) */
 extern std::unique_ptr<CCoinsViewDB> pcoinsdbview;
 
+/** Global variable that points to the view writing pcoinsTip flushes to pcoinsdbview in the background */
+extern std::unique_ptr<CCoinsViewFlusher> pcoinsflusher;
+
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern std::unique_ptr<CCoinsViewCache> pcoinsTip;
 
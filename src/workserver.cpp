@@ -0,0 +1,546 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <workserver.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/merkle.h>
+#include <crypto/common.h>
+#include <httpserver.h>
+#include <miner.h>
+#include <netbase.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <script/script.h>
+#include <streams.h>
+#include <sync.h>
+#include <util.h>
+#include <validation.h>
+#include <validationinterface.h>
+#include <version.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <event2/util.h>
+
+//! Submissions waiting for validation before new ones are turned away
+static const size_t MAX_WORK_SUBMIT_QUEUE = 64;
+
+namespace {
+
+class CWorkServer;
+
+/** The block template shared by every work unit handed out for one tip */
+struct CWorkTemplate
+{
+    CBlock block;
+    const CBlockIndex* pindexPrev;
+    //! Merkle branch of the coinbase, so each unit's root costs log(n) hashes
+    std::vector<uint256> vMerkleBranch;
+};
+
+/** A work unit as sent to one miner: the template with its own coinbase and header */
+struct CWorkUnit
+{
+    std::shared_ptr<const CWorkTemplate> tmpl;
+    CTransactionRef txCoinbase;
+    CBlockHeader header;
+};
+
+/** A solved block waiting to be validated off the event loop */
+struct CWorkSubmission
+{
+    uint64_t nConnection;
+    uint32_t nWorkId;
+    std::shared_ptr<const CBlock> block;
+};
+
+struct CWorkConnection
+{
+    CWorkServer* server;
+    uint64_t nId;
+    struct bufferevent* bev;
+    //! The unit last sent on this connection, dropped when the miner goes away
+    uint32_t nWorkId;
+};
+
+/**
+ * Pushes work to connected miners whenever the tip changes and validates
+ * their solutions. Connections live on the HTTP server's event loop; new
+ * templates are built on the validation interface thread and solutions are
+ * checked on a thread of their own, so neither ever blocks miner I/O.
+ */
+class CWorkServer final : public CValidationInterface
+{
+private:
+    struct event_base* base;
+    const CChainParams& chainparams;
+    const CScript scriptPubKey;
+    struct evconnlistener* listener;
+
+    //! Miner connections. Only touched from the event loop thread.
+    std::map<uint64_t, CWorkConnection> mapConnections;
+    uint64_t nNextConnection;
+
+    CCriticalSection cs;
+    std::shared_ptr<const CWorkTemplate> tmplCurrent;
+    std::map<uint32_t, CWorkUnit> mapWork;
+    uint32_t nNextWorkId;
+    //! First work id handed out for tmplCurrent; anything older is stale
+    uint32_t nFirstWorkId;
+    unsigned int nExtraNonce;
+
+    std::mutex csSubmit;
+    std::condition_variable condSubmit;
+    std::deque<CWorkSubmission> queueSubmit;
+    bool fStopSubmit;
+    std::thread threadSubmit;
+
+    static void AcceptCallback(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* addr, int socklen, void* ctx);
+    static void ReadCallback(struct bufferevent* bev, void* ctx);
+    static void EventCallback(struct bufferevent* bev, short what, void* ctx);
+
+    void Accept(evutil_socket_t fd);
+    void Disconnect(CWorkConnection& conn);
+    void Read(CWorkConnection& conn);
+    bool HandleSubmit(CWorkConnection& conn, CDataStream& payload);
+    void Send(CWorkConnection& conn, uint8_t nCommand, const CDataStream& payload);
+    void SendWork(CWorkConnection& conn);
+    void SendResult(CWorkConnection& conn, uint32_t nWorkId, bool fAccepted, const std::string& strReason);
+    void BroadcastWork();
+
+    void ThreadSubmit();
+    std::string ProcessSubmission(const std::shared_ptr<const CBlock>& block, bool& fAccepted);
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+
+public:
+    CWorkServer(struct event_base* baseIn, const CChainParams& chainparamsIn, const CScript& scriptPubKeyIn);
+    ~CWorkServer();
+
+    bool Listen(const CService& addrBind);
+    /** Build a new template for the current tip and push it to every miner */
+    void UpdateTemplate();
+    void StopSubmitThread();
+    /** Close the listener and all connections. Event loop thread only. */
+    void Close();
+
+    void RunInEventLoop(const std::function<void(void)>& func);
+};
+
+CWorkServer::CWorkServer(struct event_base* baseIn, const CChainParams& chainparamsIn, const CScript& scriptPubKeyIn) :
+    base(baseIn), chainparams(chainparamsIn), scriptPubKey(scriptPubKeyIn), listener(nullptr), nNextConnection(0),
+    nNextWorkId(1), nFirstWorkId(1), nExtraNonce(0), fStopSubmit(false)
+{
+    threadSubmit = std::thread(&TraceThread<std::function<void()> >, "worksubmit", std::function<void()>(std::bind(&CWorkServer::ThreadSubmit, this)));
+}
+
+CWorkServer::~CWorkServer()
+{
+    StopSubmitThread();
+    assert(listener == nullptr && mapConnections.empty());
+}
+
+void CWorkServer::RunInEventLoop(const std::function<void(void)>& func)
+{
+    // Deletes itself once the handler has run on the event loop thread
+    HTTPEvent* ev = new HTTPEvent(base, true, func);
+    ev->trigger(nullptr);
+}
+
+bool CWorkServer::Listen(const CService& addrBind)
+{
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!addrBind.GetSockAddr((struct sockaddr*)&sockaddr, &len))
+        return error("%s: bind address %s not supported", __func__, addrBind.ToString());
+
+    listener = evconnlistener_new_bind(base, AcceptCallback, this, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1, (struct sockaddr*)&sockaddr, len);
+    if (!listener)
+        return error("%s: unable to bind to %s", __func__, addrBind.ToString());
+    return true;
+}
+
+void CWorkServer::Close()
+{
+    if (listener) {
+        evconnlistener_free(listener);
+        listener = nullptr;
+    }
+    for (auto& entry : mapConnections)
+        bufferevent_free(entry.second.bev);
+    mapConnections.clear();
+}
+
+void CWorkServer::AcceptCallback(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* addr, int socklen, void* ctx)
+{
+    static_cast<CWorkServer*>(ctx)->Accept(fd);
+}
+
+void CWorkServer::ReadCallback(struct bufferevent* bev, void* ctx)
+{
+    CWorkConnection* conn = static_cast<CWorkConnection*>(ctx);
+    conn->server->Read(*conn);
+}
+
+void CWorkServer::EventCallback(struct bufferevent* bev, short what, void* ctx)
+{
+    CWorkConnection* conn = static_cast<CWorkConnection*>(ctx);
+    if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR))
+        conn->server->Disconnect(*conn);
+}
+
+void CWorkServer::Accept(evutil_socket_t fd)
+{
+    struct bufferevent* bev = bufferevent_socket_new(base, fd, BEV_OPT_CLOSE_ON_FREE);
+    if (!bev) {
+        evutil_closesocket(fd);
+        return;
+    }
+    // Stale work costs the miner its sieve, so do not sit on small writes
+    SetSocketNoDelay(fd);
+
+    uint64_t nId = ++nNextConnection;
+    CWorkConnection& conn = mapConnections[nId];
+    conn.server = this;
+    conn.nId = nId;
+    conn.bev = bev;
+    conn.nWorkId = 0;
+
+    bufferevent_setcb(bev, ReadCallback, nullptr, EventCallback, &conn);
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+    LogPrint(BCLog::MINING, "work server: miner %d connected\n", nId);
+
+    SendWork(conn);
+}
+
+void CWorkServer::Disconnect(CWorkConnection& conn)
+{
+    LogPrint(BCLog::MINING, "work server: miner %d disconnected\n", conn.nId);
+    {
+        LOCK(cs);
+        mapWork.erase(conn.nWorkId);
+    }
+    bufferevent_free(conn.bev);
+    mapConnections.erase(conn.nId);
+}
+
+void CWorkServer::Read(CWorkConnection& conn)
+{
+    struct evbuffer* input = bufferevent_get_input(conn.bev);
+
+    while (evbuffer_get_length(input) >= WORK_MESSAGE_HEADER_SIZE) {
+        unsigned char header[WORK_MESSAGE_HEADER_SIZE];
+        evbuffer_copyout(input, header, sizeof(header));
+
+        uint32_t nSize = ReadLE32(header);
+        if (nSize > MAX_WORK_MESSAGE_SIZE) {
+            LogPrint(BCLog::MINING, "work server: oversized message (%u bytes) from miner %d\n", nSize, conn.nId);
+            Disconnect(conn);
+            return;
+        }
+        if (evbuffer_get_length(input) < WORK_MESSAGE_HEADER_SIZE + nSize)
+            return;
+
+        evbuffer_drain(input, sizeof(header));
+        CDataStream payload(SER_NETWORK, PROTOCOL_VERSION);
+        payload.resize(nSize);
+        if (nSize > 0)
+            evbuffer_remove(input, payload.data(), nSize);
+
+        // Unknown commands are skipped so miners can probe for newer ones
+        if (header[4] == WORK_CMD_SUBMIT && !HandleSubmit(conn, payload)) {
+            LogPrint(BCLog::MINING, "work server: malformed submission from miner %d\n", conn.nId);
+            Disconnect(conn);
+            return;
+        }
+    }
+}
+
+bool CWorkServer::HandleSubmit(CWorkConnection& conn, CDataStream& payload)
+{
+    uint32_t nWorkId, nNonce;
+    uint16_t nShift;
+    try {
+        payload >> nWorkId >> nNonce >> nShift;
+    } catch (const std::ios_base::failure&) {
+        return false;
+    }
+    if (payload.empty())
+        return false;
+
+    std::shared_ptr<CBlock> block = std::make_shared<CBlock>();
+    {
+        LOCK(cs);
+        std::map<uint32_t, CWorkUnit>::const_iterator it = mapWork.find(nWorkId);
+        if (it == mapWork.end()) {
+            SendResult(conn, nWorkId, false, nWorkId < nFirstWorkId ? "stale" : "unknown-work");
+            return true;
+        }
+        const CWorkUnit& unit = it->second;
+        *block = unit.tmpl->block;
+        block->vtx[0] = unit.txCoinbase;
+        static_cast<CBlockHeader&>(*block) = unit.header;
+    }
+    block->nNonce = nNonce;
+    block->nShift = nShift;
+    block->nAdd.assign(payload.begin(), payload.end());
+
+    {
+        std::lock_guard<std::mutex> lock(csSubmit);
+        if (queueSubmit.size() >= MAX_WORK_SUBMIT_QUEUE) {
+            SendResult(conn, nWorkId, false, "busy");
+            return true;
+        }
+        queueSubmit.push_back(CWorkSubmission{conn.nId, nWorkId, block});
+    }
+    condSubmit.notify_one();
+    return true;
+}
+
+void CWorkServer::Send(CWorkConnection& conn, uint8_t nCommand, const CDataStream& payload)
+{
+    unsigned char header[WORK_MESSAGE_HEADER_SIZE];
+    WriteLE32(header, payload.size());
+    header[4] = nCommand;
+
+    struct evbuffer* output = bufferevent_get_output(conn.bev);
+    evbuffer_add(output, header, sizeof(header));
+    evbuffer_add(output, payload.data(), payload.size());
+}
+
+void CWorkServer::SendWork(CWorkConnection& conn)
+{
+    CDataStream payload(SER_NETWORK, PROTOCOL_VERSION);
+    {
+        LOCK(cs);
+        if (!tmplCurrent)
+            return;
+
+        // Only the latest unit of a connection is kept
+        mapWork.erase(conn.nWorkId);
+
+        CWorkUnit unit;
+        unit.tmpl = tmplCurrent;
+
+        unsigned int nHeight = tmplCurrent->pindexPrev->nHeight + 1;
+        CMutableTransaction txCoinbase(*tmplCurrent->block.vtx[0]);
+        txCoinbase.vin[0].scriptSig = (CScript() << nHeight << CScriptNum(++nExtraNonce)) + COINBASE_FLAGS;
+        assert(txCoinbase.vin[0].scriptSig.size() <= 100);
+        unit.txCoinbase = MakeTransactionRef(std::move(txCoinbase));
+
+        unit.header = tmplCurrent->block.GetBlockHeader();
+        UpdateTime(&unit.header, chainparams.GetConsensus(), tmplCurrent->pindexPrev);
+        unit.header.hashMerkleRoot = ComputeMerkleRootFromBranch(unit.txCoinbase->GetHash(), tmplCurrent->vMerkleBranch, 0);
+
+        conn.nWorkId = nNextWorkId++;
+        payload << conn.nWorkId << (uint32_t)nHeight << nMiningShift.load();
+        payload << unit.header.nVersion << unit.header.hashPrevBlock << unit.header.hashMerkleRoot << unit.header.nTime << unit.header.nDifficulty;
+        mapWork.emplace(conn.nWorkId, std::move(unit));
+    }
+    Send(conn, WORK_CMD_WORK, payload);
+}
+
+void CWorkServer::SendResult(CWorkConnection& conn, uint32_t nWorkId, bool fAccepted, const std::string& strReason)
+{
+    CDataStream payload(SER_NETWORK, PROTOCOL_VERSION);
+    payload << nWorkId << (uint8_t)fAccepted;
+    payload.write(strReason.data(), strReason.size());
+    Send(conn, WORK_CMD_RESULT, payload);
+}
+
+void CWorkServer::BroadcastWork()
+{
+    for (auto& entry : mapConnections)
+        SendWork(entry.second);
+}
+
+void CWorkServer::UpdateTemplate()
+{
+    std::shared_ptr<CWorkTemplate> tmpl = std::make_shared<CWorkTemplate>();
+    try {
+        std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKey);
+        if (!pblocktemplate)
+            return;
+        tmpl->block = pblocktemplate->block;
+    } catch (const std::exception& e) {
+        LogPrintf("%s: unable to create a block template: %s\n", __func__, e.what());
+        return;
+    }
+
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator mi = mapBlockIndex.find(tmpl->block.hashPrevBlock);
+        if (mi == mapBlockIndex.end())
+            return;
+        tmpl->pindexPrev = mi->second;
+    }
+    tmpl->vMerkleBranch = BlockMerkleBranch(tmpl->block, 0);
+
+    {
+        LOCK(cs);
+        tmplCurrent = tmpl;
+        mapWork.clear();
+        nFirstWorkId = nNextWorkId;
+    }
+    LogPrint(BCLog::MINING, "work server: new template for height %d\n", tmpl->pindexPrev->nHeight + 1);
+
+    RunInEventLoop([this] { BroadcastWork(); });
+}
+
+void CWorkServer::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+{
+    if (fInitialDownload)
+        return;
+    UpdateTemplate();
+}
+
+std::string CWorkServer::ProcessSubmission(const std::shared_ptr<const CBlock>& block, bool& fAccepted)
+{
+    fAccepted = false;
+
+    // Check the gap before anything takes cs_main, the same way CheckWork does
+    uint256 hash = block->GetHash();
+    std::vector<uint8_t> vHash(hash.begin(), hash.end());
+    PoW pow(&vHash, block->nShift, &block->nAdd, block->nDifficulty);
+    if (!pow.valid())
+        return "high-hash";
+
+    {
+        LOCK(cs_main);
+        if (block->hashPrevBlock != chainActive.Tip()->GetBlockHash())
+            return "stale";
+    }
+
+    bool fNewBlock = false;
+    if (!ProcessNewBlock(chainparams, block, true, &fNewBlock))
+        return "rejected";
+    if (!fNewBlock)
+        return "duplicate";
+
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end() || (mi->second->nStatus & BLOCK_FAILED_MASK))
+            return "rejected";
+    }
+
+    LogPrintf("%s: accepted block %s from an external miner\n", __func__, hash.ToString());
+    fAccepted = true;
+    return "";
+}
+
+void CWorkServer::ThreadSubmit()
+{
+    while (true) {
+        CWorkSubmission submission;
+        {
+            std::unique_lock<std::mutex> lock(csSubmit);
+            condSubmit.wait(lock, [this] { return fStopSubmit || !queueSubmit.empty(); });
+            if (fStopSubmit)
+                return;
+            submission = std::move(queueSubmit.front());
+            queueSubmit.pop_front();
+        }
+
+        bool fAccepted;
+        std::string strReason = ProcessSubmission(submission.block, fAccepted);
+
+        uint64_t nConnection = submission.nConnection;
+        uint32_t nWorkId = submission.nWorkId;
+        RunInEventLoop([this, nConnection, nWorkId, fAccepted, strReason] {
+            std::map<uint64_t, CWorkConnection>::iterator it = mapConnections.find(nConnection);
+            if (it != mapConnections.end())
+                SendResult(it->second, nWorkId, fAccepted, strReason);
+        });
+    }
+}
+
+void CWorkServer::StopSubmitThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(csSubmit);
+        fStopSubmit = true;
+    }
+    condSubmit.notify_all();
+    if (threadSubmit.joinable())
+        threadSubmit.join();
+}
+
+}
+
+static std::unique_ptr<CWorkServer> g_workserver;
+
+bool StartWorkServer(const CChainParams& chainparams, const CScript& scriptPubKey)
+{
+    struct event_base* base = EventBase();
+    if (!base)
+        return error("%s: the work server needs the HTTP server to be running", __func__);
+
+    int nPort = gArgs.GetArg("-workport", 0);
+    if (nPort <= 0 || nPort > 65535)
+        return error("%s: invalid -workport %d", __func__, nPort);
+
+    std::string strBind = gArgs.GetArg("-workbind", DEFAULT_WORKBIND);
+    CService addrBind;
+    if (!Lookup(strBind.c_str(), addrBind, nPort, false))
+        return error("%s: invalid -workbind address %s", __func__, strBind);
+
+    std::unique_ptr<CWorkServer> server(new CWorkServer(base, chainparams, scriptPubKey));
+    if (!server->Listen(addrBind))
+        return false;
+    LogPrintf("Work server listening on %s\n", addrBind.ToString());
+
+    g_workserver = std::move(server);
+    RegisterValidationInterface(g_workserver.get());
+
+    // Miners connecting before the next block should not have to wait for it
+    if (!IsInitialBlockDownload()) {
+        CWorkServer* server = g_workserver.get();
+        CallFunctionInValidationInterfaceQueue([server] { server->UpdateTemplate(); });
+    }
+    return true;
+}
+
+void StopWorkServer()
+{
+    if (!g_workserver)
+        return;
+
+    LogPrint(BCLog::MINING, "Stopping work server\n");
+    UnregisterValidationInterface(g_workserver.get());
+    // No template update may be in flight once the object is gone
+    SyncWithValidationInterfaceQueue();
+    g_workserver->StopSubmitThread();
+
+    // Events already posted to the loop run first, so nothing refers to the
+    // server after the one closing it
+    CWorkServer* server = g_workserver.get();
+    std::shared_ptr<std::promise<void> > closed = std::make_shared<std::promise<void> >();
+    std::future<void> future = closed->get_future();
+    server->RunInEventLoop([server, closed] {
+        server->Close();
+        closed->set_value();
+    });
+    if (future.wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+        // The loop is wedged; leaking is safer than freeing under it
+        LogPrintf("%s: event loop did not close the work server in time\n", __func__);
+        g_workserver.release();
+        return;
+    }
+    g_workserver.reset();
+}
@@ -0,0 +1,49 @@
+// Copyright (c) 2020 The Gapcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_WORKSERVER_H
+#define BITCOIN_WORKSERVER_H
+
+#include <stdint.h>
+
+class CChainParams;
+class CScript;
+
+/**
+ * Binary push protocol for external miners (-workport), replacing getwork
+ * polling. Every message is framed as
+ *
+ *   [uint32 payload length][uint8 command][payload]
+ *
+ * with all integers little-endian. Commands:
+ *
+ *   WORK   (node -> miner) uint32 workid, uint32 height, uint16 suggested shift,
+ *                          80 byte header prefix (nVersion, hashPrevBlock,
+ *                          hashMerkleRoot, nTime, nDifficulty, as in getwork)
+ *   SUBMIT (miner -> node) uint32 workid, uint32 nNonce, uint16 nShift, adder bytes
+ *   RESULT (node -> miner) uint32 workid, uint8 accepted, reason (rest of payload)
+ *
+ * A miner is sent a work unit with its own coinbase extranonce as soon as it
+ * connects and again whenever the tip changes. Work handed out for an
+ * earlier tip is answered with the reason "stale".
+ */
+enum WorkServerCommand : uint8_t {
+    WORK_CMD_WORK = 0x01,
+    WORK_CMD_SUBMIT = 0x02,
+    WORK_CMD_RESULT = 0x03,
+};
+
+//! Size of the framing in front of every payload
+static const unsigned int WORK_MESSAGE_HEADER_SIZE = 5;
+//! Largest payload accepted from a miner; anything bigger drops the connection
+static const unsigned int MAX_WORK_MESSAGE_SIZE = 1024;
+//! Default for -workbind
+static const char* const DEFAULT_WORKBIND = "127.0.0.1";
+
+/** Start listening on -workport, paying found blocks to scriptPubKey. Requires the HTTP server's event base. */
+bool StartWorkServer(const CChainParams& chainparams, const CScript& scriptPubKey);
+/** Stop the work server and close all miner connections. Must be called before StopHTTPServer. */
+void StopWorkServer();
+
+#endif // BITCOIN_WORKSERVER_H
@@ -5,6 +5,7 @@
 """Test mining RPCs
 
 - getmininginfo
+- getminingstats
 - getblocktemplate proposal mode
 - submitblock"""
 
@@ -43,6 +44,17 @@ class MiningTest(AltcoinTestFramework):
         assert_equal(mining_info['difficulty'], Decimal('4.656542373906925E-10'))
         assert_equal(mining_info['networkhashps'], Decimal('0.003333333333333334'))
         assert_equal(mining_info['pooledtx'], 0)
+        assert_equal(mining_info['placement'], [])
+        assert_equal(mining_info['autotune']['enabled'], False)
+        assert_equal(mining_info['autotune']['measurements'], [])
+
+        self.log.info('getminingstats')
+        # The internal miner isn't running on regtest
+        mining_stats = node.getminingstats(True)
+        assert_equal(mining_stats['threads'], 0)
+        assert_equal(mining_stats['passes'], 0)
+        assert_equal(mining_stats['gaps'], {})
+        assert_equal(mining_stats['perthread'], [])
 
         # Mine a block to leave initial block download
         node.generate(1)
@@ -2,12 +2,16 @@
 # Copyright (c) 2014-2017 The Bitcoin Core developers
 # Distributed under the MIT software license, see the accompanying
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
-"""Test longpolling with getblocktemplate."""
+"""Test longpolling with getblocktemplate and getwork."""
 
 from test_framework.test_framework import AltcoinTestFramework
 from test_framework.util import *
 
+import http.client
+import os
 import threading
+import time
+import urllib.parse
 
 class LongpollThread(threading.Thread):
     def __init__(self, node):
@@ -20,11 +24,22 @@ class LongpollThread(threading.Thread):
         self.node = get_rpc_proxy(node.url, 1, timeout=600, coveragedir=node.coverage_dir)
 
     def run(self):
-        self.node.getblocktemplate({'longpollid':self.longpollid})
+        self.result = self.node.getblocktemplate({'longpollid':self.longpollid})
+
+class GetworkLongpollThread(threading.Thread):
+    def __init__(self, node):
+        threading.Thread.__init__(self)
+        self.longpollid = node.getwork()['longpollid']
+        self.node = get_rpc_proxy(node.url, 1, timeout=600, coveragedir=node.coverage_dir)
+
+    def run(self):
+        self.node.getwork(None, self.longpollid)
 
 class GetBlockTemplateLPTest(AltcoinTestFramework):
     def set_test_params(self):
         self.num_nodes = 2
+        # Resumed longpolls count against the work queue like any request
+        self.extra_args = [["-rpcthreads=4", "-rpcworkqueue=64"], []]
 
     def run_test(self):
         self.log.info("Warning: this test will take about 70 seconds in the best case. Be patient.")
@@ -66,6 +81,44 @@ class GetBlockTemplateLPTest(AltcoinTestFramework):
         thr.join(60 + 20)
         assert(not thr.is_alive())
 
+        # Test 5: parked longpolls hold no RPC worker threads, so many more of
+        # them than -rpcthreads allows leave the node responsive
+        threads = [LongpollThread(self.nodes[0]) for _ in range(40)]
+        for thr in threads:
+            thr.start()
+        time.sleep(2)
+        assert(all(thr.is_alive() for thr in threads))
+        self.nodes[0].getnetworkinfo()
+        self.nodes[1].generate(1)
+        for thr in threads:
+            thr.join(10)
+            assert(not thr.is_alive())
+            assert('previousblockhash' in thr.result)
+
+        # Test 6: getwork longpolls end with the tip as well
+        thr = GetworkLongpollThread(self.nodes[0])
+        thr.start()
+        thr.join(5)
+        assert(thr.is_alive())
+        self.nodes[1].generate(1)
+        thr.join(5)
+        assert(not thr.is_alive())
+
+        # Test 7: a parked longpoll is dropped once its client disconnects
+        longpollid = self.nodes[0].getblocktemplate()['longpollid']
+        url = urllib.parse.urlparse(self.nodes[0].url)
+        headers = {"Authorization": "Basic " + str_to_b64str(url.username + ':' + url.password)}
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.request('POST', '/', '{"method": "getblocktemplate", "params": [{"longpollid": "%s"}]}' % longpollid, headers)
+        time.sleep(2)
+        conn.close()
+        debug_log = os.path.join(self.nodes[0].datadir, "regtest", "debug.log")
+        def dropped():
+            with open(debug_log, encoding="utf-8") as f:
+                return "Dropping parked request" in f.read()
+        wait_until(dropped, timeout=30)
+        self.nodes[0].getnetworkinfo()
+
 if __name__ == '__main__':
     GetBlockTemplateLPTest().main()
 
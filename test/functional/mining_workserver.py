@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Gapcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the work server (-workport) with a fake external miner.
+
+- work is pushed on connect and again as soon as the tip changes
+- every miner gets its own coinbase and so its own merkle root
+- bad, unknown and stale submissions are answered with a reason
+- oversized messages drop the connection"""
+
+import socket
+import struct
+import time
+
+from test_framework.test_framework import AltcoinTestFramework
+from test_framework.util import assert_equal, p2p_port
+
+WORK_CMD_WORK = 0x01
+WORK_CMD_SUBMIT = 0x02
+WORK_CMD_RESULT = 0x03
+MAX_WORK_MESSAGE_SIZE = 1024
+
+class FakeMiner:
+    def __init__(self, port):
+        self.sock = socket.create_connection(("127.0.0.1", port), timeout=30)
+
+    def recv_exact(self, size):
+        data = b''
+        while len(data) < size:
+            chunk = self.sock.recv(size - len(data))
+            if not chunk:
+                raise ConnectionError("work server closed the connection")
+            data += chunk
+        return data
+
+    def send_message(self, command, payload):
+        self.sock.sendall(struct.pack("<IB", len(payload), command) + payload)
+
+    def recv_message(self):
+        size, command = struct.unpack("<IB", self.recv_exact(5))
+        return command, self.recv_exact(size)
+
+    def recv_work(self, prevhash):
+        """Wait for the work unit building on prevhash, skipping older pushes"""
+        while True:
+            command, payload = self.recv_message()
+            assert_equal(command, WORK_CMD_WORK)
+            workid, height, shift = struct.unpack("<IIH", payload[:10])
+            header = payload[10:]
+            assert_equal(len(header), 80)
+            work = {
+                'workid': workid,
+                'height': height,
+                'shift': shift,
+                'prevhash': header[4:36][::-1].hex(),
+                'merkleroot': header[36:68][::-1].hex(),
+                'difficulty': struct.unpack("<Q", header[72:80])[0],
+            }
+            if work['prevhash'] == prevhash:
+                return work
+
+    def submit(self, workid, nonce, shift, adder):
+        self.send_message(WORK_CMD_SUBMIT, struct.pack("<IIH", workid, nonce, shift) + adder)
+        command, payload = self.recv_message()
+        assert_equal(command, WORK_CMD_RESULT)
+        result_workid, accepted = struct.unpack("<IB", payload[:5])
+        assert_equal(result_workid, workid)
+        return bool(accepted), payload[5:].decode('ascii')
+
+    def wait_for_close(self):
+        # Skip any work still in flight; a closed connection reads as EOF,
+        # one left open runs into the socket timeout
+        try:
+            while self.sock.recv(4096):
+                pass
+        except ConnectionResetError:
+            pass
+
+class WorkServerTest(AltcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+
+    def run_test(self):
+        node = self.nodes[0]
+        workport = p2p_port(self.num_nodes)
+
+        self.log.info("Restart with the work server enabled")
+        address = node.getnewaddress()
+        self.restart_node(0, ["-workport=%d" % workport, "-workaddress=%s" % address])
+        node.generate(1)
+
+        miner = FakeMiner(workport)
+        work = miner.recv_work(node.getbestblockhash())
+        assert_equal(work['height'], node.getblockcount() + 1)
+        assert work['difficulty'] > 0
+
+        self.log.info("Each miner gets its own work unit")
+        other = FakeMiner(workport)
+        other_work = other.recv_work(node.getbestblockhash())
+        assert work['workid'] != other_work['workid']
+        assert work['merkleroot'] != other_work['merkleroot']
+
+        self.log.info("Work is pushed when the tip changes")
+        start = time.time()
+        node.generate(1)
+        new_work = miner.recv_work(node.getbestblockhash())
+        other.recv_work(node.getbestblockhash())
+        assert_equal(new_work['height'], work['height'] + 1)
+        assert new_work['workid'] > work['workid']
+        self.log.info("New work arrived %.3fs after generate was called" % (time.time() - start))
+
+        self.log.info("Bad and unknown submissions are rejected")
+        # An adder of zero makes the gap start even, so it can never be prime
+        assert_equal(miner.submit(new_work['workid'], 0, new_work['shift'], b'\x00'), (False, 'high-hash'))
+        assert_equal(miner.submit(0xffffffff, 0, new_work['shift'], b'\x00'), (False, 'unknown-work'))
+        assert_equal(miner.submit(work['workid'], 0, work['shift'], b'\x00'), (False, 'stale'))
+
+        self.log.info("Oversized messages drop the connection")
+        other.send_message(WORK_CMD_SUBMIT, b'\x00' * (MAX_WORK_MESSAGE_SIZE + 1))
+        other.wait_for_close()
+
+        # The remaining miner is unaffected
+        assert_equal(miner.submit(0xffffffff, 0, new_work['shift'], b'\x00'), (False, 'unknown-work'))
+
+if __name__ == '__main__':
+    WorkServerTest().main()
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Gapcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Load test the socket events modes with many loopback peers.
+
+For each -socketevents mode this build supports:
+
+- Restart the node in that mode and connect NUM_PEERS p2p connections
+- Measure the CPU time the node uses while the peers are idle
+- Have every peer ping the node for PING_ROUNDS rounds and check all pongs
+  arrive, measuring the round trip times and CPU time used
+- Log the measurements so the modes can be compared
+
+Also check that an unknown mode is refused at startup.
+"""
+
+import os
+import subprocess
+import time
+
+from test_framework.mininode import *
+from test_framework.test_framework import AltcoinTestFramework
+from test_framework.util import *
+
+NUM_PEERS = 200
+PING_ROUNDS = 10
+IDLE_SECONDS = 5
+
+class PingPeer(P2PInterface):
+    def __init__(self):
+        super().__init__()
+        self.ping_sent = {}
+        self.round_trips = []
+
+    def send_ping(self, nonce):
+        self.ping_sent[nonce] = time.time()
+        self.send_message(msg_ping(nonce=nonce))
+
+    def on_pong(self, message):
+        if message.nonce in self.ping_sent:
+            self.round_trips.append(time.time() - self.ping_sent.pop(message.nonce))
+
+def process_cpu_seconds(pid):
+    """User plus system CPU time of a process, from /proc"""
+    with open("/proc/%d/stat" % pid, encoding="utf8") as f:
+        fields = f.read().rsplit(")", 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+class SocketEventsTest(AltcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+
+    def supported_modes(self):
+        help_text = subprocess.check_output([self.nodes[0].binary, "-help"], universal_newlines=True)
+        modes = help_text.split("-socketevents=<mode>", 1)[1].split("one of:", 1)[1].split("(default", 1)[0]
+        return [mode.strip() for mode in modes.split(",")]
+
+    def run_test(self):
+        if not os.path.exists("/proc/self/stat"):
+            self.log.info("No /proc to read CPU use from, skipping")
+            return
+
+        self.stop_node(0)
+        self.assert_start_raises_init_error(0, ["-socketevents=invalid"], "Unsupported -socketevents mode")
+
+        for mode in self.supported_modes():
+            self.run_mode(mode)
+
+    def run_mode(self, mode):
+        self.log.info("Connecting %d peers with -socketevents=%s" % (NUM_PEERS, mode))
+        self.start_node(0, ["-socketevents=%s" % mode, "-maxconnections=%d" % (NUM_PEERS + 50)])
+        node = self.nodes[0]
+        peers = [node.add_p2p_connection(PingPeer()) for _ in range(NUM_PEERS)]
+        network_thread_start()
+        for peer in peers:
+            peer.wait_for_verack()
+        wait_until(lambda: len(node.getpeerinfo()) == NUM_PEERS, timeout=60)
+
+        pid = node.process.pid
+        cpu_start = process_cpu_seconds(pid)
+        time.sleep(IDLE_SECONDS)
+        idle_cpu = process_cpu_seconds(pid) - cpu_start
+
+        cpu_start = process_cpu_seconds(pid)
+        time_start = time.time()
+        for nonce in range(1, PING_ROUNDS + 1):
+            for peer in peers:
+                peer.send_ping(nonce)
+            wait_until(lambda: all(len(peer.round_trips) == nonce for peer in peers), timeout=60, lock=mininode_lock)
+        load_time = time.time() - time_start
+        load_cpu = process_cpu_seconds(pid) - cpu_start
+
+        with mininode_lock:
+            round_trips = sorted(rtt for peer in peers for rtt in peer.round_trips)
+        assert_equal(len(round_trips), NUM_PEERS * PING_ROUNDS)
+        assert_equal(len(node.getpeerinfo()), NUM_PEERS)
+        self.log.info("%s: idle CPU %.1f%%, %d pings in %.2fs using %.2fs CPU, round trip median %.1fms, 99th percentile %.1fms, max %.1fms" % (
+            mode, 100 * idle_cpu / IDLE_SECONDS, len(round_trips), load_time, load_cpu,
+            1000 * round_trips[len(round_trips) // 2], 1000 * round_trips[len(round_trips) * 99 // 100], 1000 * round_trips[-1]))
+
+        node.disconnect_p2ps()
+        network_thread_join()
+        self.stop_node(0)
+
+if __name__ == '__main__':
+    SocketEventsTest().main()
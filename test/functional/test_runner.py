@@ -117,6 +117,7 @@ BASE_SCRIPTS= [
     'feature_nulldummy.py',
     'wallet_import_rescan.py',
     'mining_basic.py',
+    'mining_workserver.py',
     'wallet_bumpfee.py',
     'rpc_named_arguments.py',
     'wallet_listsinceblock.py',
@@ -152,6 +153,7 @@ EXTENDED_SCRIPTS = [
     'feature_bip68_sequence.py',
     'mining_getblocktemplate_longpoll.py',
     'p2p_timeouts.py',
+    'p2p_socketevents.py',
     # vv Tests less than 60s vv
     'feature_bip9_softforks.py',
     'p2p_feefilter.py',